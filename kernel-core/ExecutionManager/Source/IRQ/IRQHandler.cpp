@@ -27,6 +27,57 @@ IRQHandler::~IRQHandler()
 
 }
 
+ThreadedIRQHandler::ThreadedIRQHandler()
+{
+	this->bottomWork.init(&runBottomHalf, this);
+	this->events = 0;
+}
+
+ThreadedIRQHandler::~ThreadedIRQHandler()
+{
+	WorkQueue::cancel(&bottomWork);
+	WorkQueue::flush(&bottomWork);
+}
+
+///
+/// Runs the top-half of the handler, and queues the bottom-half on the
+/// current cpu if the top-half asks for it. Called in the interrupt, with
+/// interrupts disabled.
+///
+/// @return - whether the interrupt was raised by this device
+/// @version 1.0
+/// @since Silcos 3.05
+/// @author Shukant Pal
+///
+bool ThreadedIRQHandler::intrAction()
+{
+	switch(topHalf())
+	{
+	case IRQ_NONE:
+		return (false);
+	case IRQ_WAKE_THREAD:
+		__sync_fetch_and_add(&events, 1);
+		WorkQueue::queueIRQWork(GetProcessorById(PROCESSOR_ID),
+						&bottomWork);
+		return (true);
+	default:
+		return (true);
+	}
+}
+
+///
+/// Runs the bottom-half for all top-halves which have asked for it until
+/// now. Top-halves coming while it runs queue it again.
+///
+void ThreadedIRQHandler::runBottomHalf(void *handler)
+{
+	ThreadedIRQHandler *irq = (ThreadedIRQHandler*) handler;
+	unsigned long events = __sync_lock_test_and_set(&irq->events, 0);
+
+	if(events != 0)
+		irq->bottomHalf(events);
+}
+
 IRQ::IRQ() : lineHdlrs(4)
 {
 
@@ -0,0 +1,533 @@
+/**
+ * File: CompletelyFair.cpp
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <Executable/CompletelyFair.hpp>
+#include <Executable/RunqueueBalancer.hpp>
+#include <Executable/Scheduler.h>
+#include <HardwareAbstraction/LocalTimer.hpp>
+#include <HardwareAbstraction/Processor.h>
+#include <HardwareAbstraction/ProcessorTopology.hpp>
+#include <KERNEL.h>
+
+using namespace HAL;
+using namespace Executable;
+
+/*
+ * Weights for each nice-value (from -20 to 19). Each level differs by ~25%
+ * so that a task gets ~10% more cpu-time than another task with its
+ * nice-value one higher.
+ */
+static const unsigned long niceToWeight[40] = {
+ /* -20 */	88761,	71755,	56483,	46273,	36291,
+ /* -15 */	29154,	23254,	18705,	14949,	11916,
+ /* -10 */	9548,	7620,	6100,	4904,	3906,
+ /*  -5 */	3121,	2501,	1991,	1586,	1277,
+ /*   0 */	1024,	820,	655,	526,	423,
+ /*   5 */	335,	272,	215,	172,	137,
+ /*  10 */	110,	87,	70,	56,	45,
+ /*  15 */	36,	29,	23,	18,	15
+};
+
+/*
+ * Inverse weights (2^32 / weight), so that scaling the run-time of tasks
+ * doesn't need a 64-bit division.
+ */
+static const unsigned long niceToInvWeight[40] = {
+ /* -20 */	48388,		59856,		76040,		92818,		118348,
+ /* -15 */	147320,		184698,		229616,		287308,		360437,
+ /* -10 */	449829,		563644,		704093,		875809,		1099582,
+ /*  -5 */	1376151,	1717300,	2157191,	2708050,	3363326,
+ /*   0 */	4194304,	5237765,	6557202,	8165337,	10153587,
+ /*   5 */	12820798,	15790321,	19976592,	24970740,	31350126,
+ /*  10 */	39045157,	49367440,	61356676,	76695844,	95443717,
+ /*  15 */	119304647,	148102320,	186737708,	238609294,	286331153
+};
+
+/*
+ * Tree-keys are kept below this limit (relative to keyBase), after which
+ * the runqueue is rebased on the current minimum virtual run-time.
+ */
+#define CFS_KEY_LIMIT 0x80000000UL
+
+static inline unsigned long weightOf(Task *task)
+{
+	return (niceToWeight[task->niceValue - NICE_MIN]);
+}
+
+/*
+ * Scales the given run-time (in ms) into virtual run-time, which is kept
+ * in 1/1024-th's of a ms for a task of nice-value 0.
+ */
+static inline Time scaleRuntime(Time delta, Task *task)
+{
+	return ((delta * niceToInvWeight[task->niceValue - NICE_MIN]) >> 12);
+}
+
+/**
+ * Adds a new task into this runqueue, placing it at the minimum virtual
+ * run-time so that it runs soon, but without starving existing tasks. The
+ * task starts with nice-value 0.
+ *
+ * @param newTask - the task to add
+ * @return - the task added
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+Task *CompletelyFair::add(Task *newTask)
+{
+	Processor *host = GetProcessorById(PROCESSOR_ID);
+	Time now = getSystemTime();
+
+	__no_interrupts
+(
+		SpinLock(&lock);
+
+		newTask->schedClass = COMPLETELY_FAIR;
+		newTask->cpu = host;
+		newTask->niceValue = 0;
+		newTask->vruntime = minVruntime;
+		newTask->timeStamp = now;
+		newTask->loadAvg.init(now);
+		newTask->lastRan = 0;
+		newTask->rqKey = CFS_UNQUEUED;
+
+		enqueue(newTask);
+		AddCElement((CircularListNode*) newTask, CLAST, &allTasks);
+
+		++(this->load);
+
+		LocalTimer::kick(host);
+
+		SpinUnlock(&lock);
+)
+
+	return (newTask);
+}
+
+/**
+ * Allocates the leftmost task in the runqueue, when the cpu switches to
+ * this roller from another scheduling class.
+ *
+ * @param t - present time
+ * @param cpu - the cpu owning this runqueue
+ * @return - the task to run; null, if the runqueue is empty
+ */
+Task *CompletelyFair::allocate(Time t, Processor *cpu)
+{
+	return (pickNext(t));
+}
+
+/**
+ * Accounts the run-time of the current task, and lets it run until its
+ * time-slice expires. After that, the task with the least virtual run-time
+ * is picked.
+ *
+ * @param t - present time
+ * @param cpu - the cpu owning this runqueue
+ * @return - the task to run next
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+Task *CompletelyFair::update(Time t, Processor *cpu)
+{
+	Task *curr = currentTask;
+
+	if(curr != null && cpu->ctask == curr)
+	{
+		account(curr, t);
+
+		if(t - sliceStart < timeSlice(curr))
+			return (curr);
+	}
+
+	RunqueueBalancer::balanceWork(COMPLETELY_FAIR);
+	return (pickNext(t));
+}
+
+/**
+ * Accounts the run-time of the current task, when the cpu switches to
+ * another scheduling class.
+ *
+ * @param at - present time
+ * @param cpu - the cpu owning this runqueue
+ */
+void CompletelyFair::free(Time at, Processor *cpu)
+{
+	if(currentTask != null)
+	{
+		account(currentTask, at);
+		currentTask = null;
+	}
+}
+
+/*
+ * The current task isn't preempted before its time-slice expires, unless a
+ * task is added (which forces an update).
+ */
+unsigned long CompletelyFair::quantum(Time t, Processor *cpu)
+{
+	if(currentTask == null)
+		return (1);
+
+	Time ran = t - sliceStart;
+	unsigned long slice = timeSlice(currentTask);
+
+	return ((ran < slice) ? slice - (unsigned long) ran : 1);
+}
+
+/**
+ * Removes the task from this runqueue. Its virtual run-time is made
+ * relative to the minimum, like that of a sent task, so that it can be
+ * recieved back when it wakes up from a sleep.
+ *
+ * @param tTask - the task to remove
+ * @return - whether the task was on this runqueue; it may be asleep, or
+ * 		on its way to another cpu, otherwise.
+ * @version 1.2
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool CompletelyFair::remove(Task *tTask)
+{
+	Time now = getSystemTime();
+	bool queued;
+
+	__irq_save_func(
+		SpinLock(&lock);
+
+		queued = (tTask->rqKey != CFS_UNQUEUED &&
+				tTask->cpu->lschedTable[COMPLETELY_FAIR] == this);
+
+		if(queued)
+		{
+			if(tTask == currentTask)
+			{
+				account(tTask, now);
+				currentTask = null;
+			}
+
+			dequeue(tTask);
+			RemoveCElement((CircularListNode*) tTask, &allTasks);
+
+			tTask->vruntime = (tTask->vruntime > minVruntime) ?
+					tTask->vruntime - minVruntime : 0;
+
+			--(this->load);
+		}
+
+		SpinUnlock(&lock);
+	)
+
+	return (queued);
+}
+
+/**
+ * Changes the nice-value of a task in this runqueue. Its virtual run-time
+ * isn't changed, but it accumulates at the new rate from now on.
+ *
+ * @param task - the task whose nice-value is to change
+ * @param nice - the new nice-value (clamped to NICE_MIN..NICE_MAX)
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void CompletelyFair::renice(Task *task, long nice)
+{
+	if(nice < NICE_MIN)
+		nice = NICE_MIN;
+	else if(nice > NICE_MAX)
+		nice = NICE_MAX;
+
+	Time now = getSystemTime();
+
+	__no_interrupts
+(
+		SpinLock(&lock);
+
+		if(task == currentTask)
+			account(task, now);
+
+		totalWeight -= weightOf(task);
+		task->niceValue = nice;
+		totalWeight += weightOf(task);
+
+		SpinUnlock(&lock);
+)
+}
+
+/**
+ * Method: CompletelyFair::send
+ *
+ * Summary:
+ * Takes out upto 'delta' tasks from this runqueue, the ones with the most
+ * virtual run-time first (as they will run last here), and chains them in
+ * the circular-list given. The currently executing task is not sent. The
+ * virtual run-time of sent tasks is made relative to this runqueue's
+ * minimum, to be re-based by the reciever. Tasks which ran too recently to
+ * be worth migrating across the cpus' common domain, and tasks not allowed
+ * to run on the destination cpu, are held back.
+ *
+ * Since: Silcos 3.05
+ * Author: Shukant Pal
+ */
+void CompletelyFair::send(Processor *from, Processor *to, CircularList& list,
+		unsigned long delta)
+{
+	Task *task;
+	Task *held[MIGRATION_HOT_MAX];
+	unsigned long heldCount = 0;
+	Time now = XMilliTime;
+	Time cost = DomainBinding::migrationCost(from, to);
+
+	list.lMain = null;
+	list.count = 0;
+
+	while(delta && allTasks.count > 1)
+	{
+		task = (Task*) runqueue->getMaximum();
+
+		if(task == null)
+			break;
+
+		if(task == from->ctask || !task->allowedOn(to->hw.APICID) ||
+				isCacheHot(task, now, cost))
+		{
+			/* Move it out of the way until the others are sent. */
+			if(heldCount == MIGRATION_HOT_MAX)
+				break;
+
+			dequeue(task);
+			held[heldCount++] = task;
+			continue;
+		}
+
+		dequeue(task);
+		RemoveCElement((CircularListNode*) task, &allTasks);
+		task->vruntime -= minVruntime;
+
+		AddCElement((CircularListNode*) task, CLAST, &list);
+		--(delta);
+	}
+
+	while(heldCount)
+		enqueue(held[--heldCount]);
+
+	this->load -= list.count;
+}
+
+/**
+ * Method: CompletelyFair::recieve
+ *
+ * Summary:
+ * Adds the chain of incoming tasks to this runqueue, converting their
+ * relative virtual run-time back into an absolute one.
+ *
+ * Since: Silcos 3.05
+ * Author: Shukant Pal
+ */
+void CompletelyFair::recieve(Task *first, Task *last, unsigned long count, unsigned long load)
+{
+	Processor *host = GetProcessorById(PROCESSOR_ID);
+	Task *task = first, *nextTask;
+	Time now = getSystemTime();
+
+	SpinLock(&lock);
+
+	for(unsigned long idx = 0; idx < count; idx++)
+	{
+		nextTask = task->next;
+
+		task->cpu = host;
+		task->vruntime += minVruntime;
+		task->timeStamp = now;
+		task->rqKey = CFS_UNQUEUED;
+
+		enqueue(task);
+		AddCElement((CircularListNode*) task, CLAST, &allTasks);
+
+		task = nextTask;
+	}
+
+	this->load += count;
+
+	SpinUnlock(&lock);
+}
+
+CompletelyFair::CompletelyFair()
+{
+	this->runqueue = null;
+	this->allTasks.count = 0;
+	this->allTasks.lMain = null;
+	this->currentTask = null;
+	this->sliceStart = 0;
+	this->minVruntime = 0;
+	this->keyBase = 0;
+	this->totalWeight = 0;
+}
+
+CompletelyFair::~CompletelyFair(){}
+
+/*
+ * Adds the run-time of the task since it was last accounted to its virtual
+ * run-time, and re-positions it in the runqueue.
+ */
+void CompletelyFair::account(Task *task, Time t)
+{
+	Time delta = t - task->timeStamp;
+	task->timeStamp = t;
+
+	if(delta == 0)
+		return;
+
+	runqueue->remove(task->rqKey);
+	task->rqKey = CFS_UNQUEUED;
+	task->vruntime += scaleRuntime(delta, task);
+	insertKeyed(task);
+
+	updateMinVruntime();
+}
+
+/*
+ * Inserts the task in the runqueue-tree & adds its weight to the runqueue.
+ * The tree is created when the first task comes in, as the ModuleFramework
+ * isn't ready when the per-cpu rollers are constructed.
+ */
+void CompletelyFair::enqueue(Task *task)
+{
+	if(runqueue == null)
+		runqueue = new(tRBTree) RBTree();
+
+	if(task->vruntime < minVruntime)
+		task->vruntime = minVruntime;
+
+	insertKeyed(task);
+	totalWeight += weightOf(task);
+}
+
+void CompletelyFair::dequeue(Task *task)
+{
+	runqueue->remove(task->rqKey);
+	task->rqKey = CFS_UNQUEUED;
+	totalWeight -= weightOf(task);
+}
+
+/*
+ * Inserts the task in the tree, keyed by its virtual run-time relative to
+ * keyBase. Tasks with the same virtual run-time are placed one after the
+ * other, as the tree doesn't allow duplicate keys.
+ */
+void CompletelyFair::insertKeyed(Task *task)
+{
+	if(task->vruntime - keyBase >= CFS_KEY_LIMIT)
+		rebase();
+
+	ASSERT(task->rqKey == CFS_UNQUEUED,
+		(char*) "CompletelyFair: task inserted twice in the runqueue");
+
+	unsigned long key = (unsigned long) (task->vruntime - keyBase);
+
+	while(runqueue->get(key) != null)
+		++(key);
+
+	task->rqKey = key;
+	runqueue->insert(key, task);
+}
+
+/*
+ * Moves keyBase up to the minimum virtual run-time and re-keys all tasks,
+ * once the keys have grown too large. Rarely happens, as a task of
+ * nice-value 0 needs to run ~35 minutes for the keys to reach the limit.
+ *
+ * Tasks taken off the tree (the one being accounted, or ones held back by
+ * send()) are left alone, as they are keyed when put back.
+ */
+void CompletelyFair::rebase()
+{
+	Task *task = (Task*) allTasks.lMain;
+	unsigned long key;
+
+	for(unsigned long idx = 0; idx < allTasks.count; idx++)
+	{
+		if(task->rqKey != CFS_UNQUEUED)
+			runqueue->remove(task->rqKey);
+
+		task = task->next;
+	}
+
+	keyBase = minVruntime;
+
+	for(unsigned long idx = 0; idx < allTasks.count; idx++)
+	{
+		if(task->rqKey == CFS_UNQUEUED)
+		{
+			task = task->next;
+			continue;
+		}
+
+		key = (unsigned long) (task->vruntime - keyBase);
+
+		while(runqueue->get(key) != null)
+			++(key);
+
+		task->rqKey = key;
+		runqueue->insert(key, task);
+		task = task->next;
+	}
+}
+
+void CompletelyFair::updateMinVruntime()
+{
+	Task *leftmost = (Task*) runqueue->getMinimum();
+
+	if(leftmost != null && leftmost->vruntime > minVruntime)
+		minVruntime = leftmost->vruntime;
+}
+
+/*
+ * Picks the task with the least virtual run-time and starts its time-slice.
+ */
+Task *CompletelyFair::pickNext(Time t)
+{
+	if(runqueue == null)
+		return (null);
+
+	Task *next = (Task*) runqueue->getMinimum();
+
+	if(next != null)
+	{
+		next->timeStamp = t;
+		sliceStart = t;
+	}
+
+	currentTask = next;
+	return (next);
+}
+
+/*
+ * Gives the task's share (by weight) of the scheduling latency, which is
+ * atleast the minimum granularity.
+ */
+unsigned long CompletelyFair::timeSlice(Task *task)
+{
+	unsigned long slice = (totalWeight) ?
+			CFS_SCHED_LATENCY * weightOf(task) / totalWeight : 0;
+
+	return ((slice > CFS_MIN_GRANULARITY) ? slice : CFS_MIN_GRANULARITY);
+}
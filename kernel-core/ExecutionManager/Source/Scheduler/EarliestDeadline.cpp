@@ -0,0 +1,419 @@
+/**
+ * File: EarliestDeadline.cpp
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <Executable/EarliestDeadline.hpp>
+#include <Executable/RunqueueBalancer.hpp>
+#include <Executable/Scheduler.h>
+#include <HardwareAbstraction/LocalTimer.hpp>
+#include <HardwareAbstraction/Processor.h>
+#include <HardwareAbstraction/ProcessorTopology.hpp>
+#include <KERNEL.h>
+
+using namespace HAL;
+using namespace Executable;
+
+/*
+ * Tree-keys are kept below this limit (relative to keyBase), after which
+ * the runqueue is rebased on the present time.
+ */
+#define DL_KEY_LIMIT 0x80000000UL
+
+/**
+ * Deadline tasks can't be added without their runtime & period; this
+ * always fails.
+ *
+ * @return - null
+ */
+Task *EarliestDeadline::add(Task *newTask)
+{
+	return (null);
+}
+
+/**
+ * Admits a new task which requires the given runtime in each period. The
+ * task is rejected if the total bandwidth of deadline tasks on this cpu
+ * would exceed DL_BW_LIMIT.
+ *
+ * @param newTask - the task to add
+ * @param runtime - run-time (in ms) required in each period
+ * @param period - period (in ms), which is also the relative deadline
+ * @return - the task added; null, if the parameters were invalid or the
+ * 		task couldn't be admitted.
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+Task *EarliestDeadline::add(Task *newTask, unsigned long runtime,
+		unsigned long period)
+{
+	if(runtime == 0 || runtime > period || period > DL_PERIOD_MAX)
+		return (null);
+
+	Processor *host = GetProcessorById(PROCESSOR_ID);
+
+	Time now = getSystemTime();
+
+	newTask->dlRuntime = runtime;
+	newTask->dlPeriod = period;
+
+	__cli
+	SpinLock(&lock);
+
+	if(totalBandwidth + bandwidthOf(newTask) > DL_BW_LIMIT)
+	{
+		SpinUnlock(&lock);
+		__sti
+		return (null);
+	}
+
+	newTask->schedClass = EARLIEST_DEADLINE;
+	newTask->cpu = host;
+	newTask->dlDeadline = now + period;
+	newTask->dlBudget = runtime;
+	newTask->timeStamp = now;
+	newTask->loadAvg.init(now);
+	newTask->lastRan = 0;
+
+	enqueue(newTask);
+
+	++(this->load);
+
+	LocalTimer::kick(host);
+
+	SpinUnlock(&lock);
+	__sti
+	return (newTask);
+}
+
+Task *EarliestDeadline::allocate(Time t, Processor *cpu)
+{
+	return (pickNext(t));
+}
+
+/**
+ * Charges the run-time of the current task to its budget, and preempts it
+ * if another task now has an earlier deadline.
+ *
+ * @param t - present time
+ * @param cpu - the cpu owning this runqueue
+ * @return - the task to run next
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+Task *EarliestDeadline::update(Time t, Processor *cpu)
+{
+	Task *curr = currentTask;
+
+	if(curr != null && cpu->ctask == curr)
+	{
+		account(curr, t);
+
+		if(runqueue->getMinimum() == curr)
+			return (curr);
+	}
+
+	RunqueueBalancer::balanceWork(EARLIEST_DEADLINE);
+	return (pickNext(t));
+}
+
+void EarliestDeadline::free(Time at, Processor *cpu)
+{
+	if(currentTask != null)
+	{
+		account(currentTask, at);
+		currentTask = null;
+	}
+}
+
+/*
+ * The current task runs until its budget is exhausted, unless a task with
+ * an earlier deadline is added (which forces an update).
+ */
+unsigned long EarliestDeadline::quantum(Time t, Processor *cpu)
+{
+	if(currentTask == null || currentTask->dlBudget == 0)
+		return (1);
+
+	return (currentTask->dlBudget);
+}
+
+/*
+ * Removes the task from this runqueue, and releases its bandwidth. Tells
+ * whether the task was queued here.
+ */
+bool EarliestDeadline::remove(Task *tTask)
+{
+	Time now = getSystemTime();
+	bool queued;
+
+	__irq_save_func(
+		SpinLock(&lock);
+
+		queued = (tTask->rqKey != DL_UNQUEUED &&
+				tTask->cpu->lschedTable[EARLIEST_DEADLINE] == this);
+
+		if(queued)
+		{
+			if(tTask == currentTask)
+			{
+				account(tTask, now);
+				currentTask = null;
+			}
+
+			dequeue(tTask);
+
+			--(this->load);
+		}
+
+		SpinUnlock(&lock);
+	)
+
+	return (queued);
+}
+
+/**
+ * Method: EarliestDeadline::send
+ *
+ * Summary:
+ * Takes out upto 'delta' tasks with the latest deadlines from this runqueue,
+ * releasing their bandwidth here. The currently executing task, tasks
+ * which are still cache-hot, tasks not allowed to run on the destination
+ * cpu, and tasks whose bandwidth doesn't fit under the destination's
+ * DL_BW_LIMIT are not sent. The destination's bandwidth is read without
+ * its lock, as the balancer holds only this runqueue.
+ *
+ * Since: Silcos 3.05
+ * Author: Shukant Pal
+ */
+void EarliestDeadline::send(Processor *from, Processor *to, CircularList& list,
+		unsigned long delta)
+{
+	Task *task;
+	Task *held[MIGRATION_HOT_MAX];
+	unsigned long heldCount = 0;
+	Time now = XMilliTime;
+	Time cost = DomainBinding::migrationCost(from, to);
+	unsigned long destBandwidth = to->dlsched.getBandwidth();
+
+	list.lMain = null;
+	list.count = 0;
+
+	while(delta && allTasks.count > 1)
+	{
+		task = (Task*) runqueue->getMaximum();
+
+		if(task == null)
+			break;
+
+		if(task == from->ctask || !task->allowedOn(to->hw.APICID) ||
+				isCacheHot(task, now, cost) ||
+				destBandwidth + bandwidthOf(task) > DL_BW_LIMIT)
+		{
+			/* Move it out of the way until the others are sent. */
+			if(heldCount == MIGRATION_HOT_MAX)
+				break;
+
+			dequeue(task);
+			held[heldCount++] = task;
+			continue;
+		}
+
+		dequeue(task);
+		destBandwidth += bandwidthOf(task);
+		AddCElement((CircularListNode*) task, CLAST, &list);
+		--(delta);
+	}
+
+	while(heldCount)
+		enqueue(held[--heldCount]);
+
+	this->load -= list.count;
+}
+
+/**
+ * Method: EarliestDeadline::recieve
+ *
+ * Summary:
+ * Adds the chain of incoming tasks to this runqueue, keeping their absolute
+ * deadlines (as the system-time is global). Their bandwidth is reserved
+ * here without another admission check, as send() only picks tasks that
+ * fit and the tasks can't be refused at this point.
+ * A task whose deadline passed while it was away (e.g. sleeping) starts a
+ * new job, as the CBS does on wakeup.
+ *
+ * Since: Silcos 3.05
+ * Author: Shukant Pal
+ */
+void EarliestDeadline::recieve(Task *first, Task *last, unsigned long count, unsigned long load)
+{
+	Processor *host = GetProcessorById(PROCESSOR_ID);
+	Task *task = first, *nextTask;
+	Time now = getSystemTime();
+
+	SpinLock(&lock);
+
+	for(unsigned long idx = 0; idx < count; idx++)
+	{
+		nextTask = task->next;
+
+		task->cpu = host;
+
+		if(task->dlDeadline <= now)
+		{
+			task->dlDeadline = now + task->dlPeriod;
+			task->dlBudget = task->dlRuntime;
+		}
+
+		enqueue(task);
+
+		task = nextTask;
+	}
+
+	this->load += count;
+
+	SpinUnlock(&lock);
+}
+
+EarliestDeadline::EarliestDeadline()
+{
+	this->runqueue = null;
+	this->allTasks.count = 0;
+	this->allTasks.lMain = null;
+	this->currentTask = null;
+	this->keyBase = 0;
+	this->totalBandwidth = 0;
+}
+
+EarliestDeadline::~EarliestDeadline(){}
+
+/*
+ * Charges the run-time of the task since it was last accounted to its
+ * budget. Once the budget is exhausted, the CBS postpones the deadline by
+ * a period and refills the budget, for each period overrun.
+ */
+void EarliestDeadline::account(Task *task, Time t)
+{
+	Time delta = t - task->timeStamp;
+	task->timeStamp = t;
+
+	if(delta < task->dlBudget)
+	{
+		task->dlBudget -= (unsigned long) delta;
+		return;
+	}
+
+	dequeue(task);
+
+	delta -= task->dlBudget;
+	task->dlDeadline += task->dlPeriod;
+	task->dlBudget = task->dlRuntime;
+
+	while(delta >= task->dlBudget)
+	{
+		delta -= task->dlBudget;
+		task->dlDeadline += task->dlPeriod;
+	}
+
+	task->dlBudget -= (unsigned long) delta;
+	enqueue(task);
+}
+
+/*
+ * Inserts the task in the runqueue keyed by its deadline, and reserves its
+ * bandwidth. The tree is created when the first task comes in.
+ */
+void EarliestDeadline::enqueue(Task *task)
+{
+	if(runqueue == null)
+		runqueue = new(tRBTree) RBTree();
+
+	if(task->dlDeadline < keyBase ||
+			task->dlDeadline - keyBase >= DL_KEY_LIMIT)
+		rebase(task->dlDeadline);
+
+	unsigned long key = (unsigned long) (task->dlDeadline - keyBase);
+
+	while(runqueue->get(key) != null)
+		++(key);
+
+	task->rqKey = key;
+	runqueue->insert(key, task);
+
+	AddCElement((CircularListNode*) task, CLAST, &allTasks);
+	totalBandwidth += bandwidthOf(task);
+}
+
+void EarliestDeadline::dequeue(Task *task)
+{
+	runqueue->remove(task->rqKey);
+	task->rqKey = DL_UNQUEUED;
+	RemoveCElement((CircularListNode*) task, &allTasks);
+	totalBandwidth -= bandwidthOf(task);
+}
+
+/*
+ * Moves keyBase to the earliest deadline in the runqueue (or the given one,
+ * if earlier) and re-keys all tasks.
+ */
+void EarliestDeadline::rebase(Time t)
+{
+	Task *task = (Task*) allTasks.lMain;
+	unsigned long key;
+
+	for(unsigned long idx = 0; idx < allTasks.count; idx++)
+	{
+		runqueue->remove(task->rqKey);
+
+		if(task->dlDeadline < t)
+			t = task->dlDeadline;
+
+		task = task->next;
+	}
+
+	keyBase = t;
+
+	for(unsigned long idx = 0; idx < allTasks.count; idx++)
+	{
+		key = (unsigned long) (task->dlDeadline - keyBase);
+
+		while(runqueue->get(key) != null)
+			++(key);
+
+		task->rqKey = key;
+		runqueue->insert(key, task);
+		task = task->next;
+	}
+}
+
+/*
+ * Picks the task with the earliest deadline.
+ */
+Task *EarliestDeadline::pickNext(Time t)
+{
+	if(runqueue == null)
+		return (null);
+
+	Task *next = (Task*) runqueue->getMinimum();
+
+	if(next != null)
+		next->timeStamp = t;
+
+	currentTask = next;
+	return (next);
+}
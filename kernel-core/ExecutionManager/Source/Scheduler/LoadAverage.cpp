@@ -0,0 +1,60 @@
+/**
+ * File: LoadAverage.cpp
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <Executable/LoadAverage.hpp>
+
+using namespace Executable;
+
+/*
+ * y^n in 0.32 fixed-point, for n from 0 to 31 (where y^32 = 1/2).
+ */
+static const U32 decayFactor[LOAD_HALF_LIFE] = {
+	0xffffffff, 0xfa83b2da, 0xf5257d14, 0xefe4b99a,
+	0xeac0c6e6, 0xe5b906e6, 0xe0ccdeeb, 0xdbfbb796,
+	0xd744fcc9, 0xd2a81d91, 0xce248c14, 0xc9b9bd85,
+	0xc5672a10, 0xc12c4cc9, 0xbd08a39e, 0xb8fbaf46,
+	0xb504f333, 0xb123f581, 0xad583ee9, 0xa9a15ab4,
+	0xa5fed6a9, 0xa2704302, 0x9ef5325f, 0x9b8d39b9,
+	0x9837f050, 0x94f4efa8, 0x91c3d373, 0x8ea4398a,
+	0x8b95c1e3, 0x88980e80, 0x85aac367, 0x82cd8698
+};
+
+/**
+ * Decays the given value by y^periods, by halving it for each half-life
+ * and then scaling it by the remaining factor from the table.
+ *
+ * @param value - the value to decay
+ * @param periods - no. of ms for which it is to decay
+ * @return - the decayed value
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+unsigned long Executable::DecayLoad(unsigned long value, unsigned long periods)
+{
+	if(periods >= LOAD_DECAY_MAX)
+		return (0);
+
+	value >>= periods / LOAD_HALF_LIFE;
+	periods %= LOAD_HALF_LIFE;
+
+	if(periods)
+		value = (unsigned long) (((U64) value * decayFactor[periods]) >> 32);
+
+	return (value);
+}
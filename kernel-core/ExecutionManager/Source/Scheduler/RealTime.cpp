@@ -0,0 +1,355 @@
+/**
+ * File: RealTime.cpp
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <Executable/RealTime.hpp>
+#include <Executable/RunqueueBalancer.hpp>
+#include <Executable/Scheduler.h>
+#include <HardwareAbstraction/LocalTimer.hpp>
+#include <HardwareAbstraction/Processor.h>
+#include <HardwareAbstraction/ProcessorTopology.hpp>
+#include <KERNEL.h>
+
+using namespace HAL;
+using namespace Executable;
+
+/**
+ * Adds a new task at the lowest real-time priority, with the FIFO policy.
+ *
+ * @param newTask - the task to add
+ * @return - the task added
+ */
+Task *RealTime::add(Task *newTask)
+{
+	return (add(newTask, 0, RT_FIFO));
+}
+
+/**
+ * Adds a new task to the end of the queue for its priority. If it has a
+ * higher priority than the current task, it will preempt that task on the
+ * next tick.
+ *
+ * @param newTask - the task to add
+ * @param priority - real-time priority (0 to RT_PRIORITIES - 1), higher
+ * 			priorities run first
+ * @param policy - RT_FIFO or RT_ROUND_ROBIN
+ * @return - the task added; null, if the priority was invalid
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+Task *RealTime::add(Task *newTask, unsigned long priority, RealTimePolicy policy)
+{
+	if(priority >= RT_PRIORITIES)
+		return (null);
+
+	Processor *host = GetProcessorById(PROCESSOR_ID);
+	Time now = getSystemTime();
+
+	__no_interrupts
+(
+		SpinLock(&lock);
+
+		newTask->schedClass = REAL_TIME;
+		newTask->cpu = host;
+		newTask->rtPriority = priority;
+		newTask->rtPolicy = policy;
+		newTask->rtQuantum = RT_QUANTUM;
+		newTask->loadAvg.init(now);
+		newTask->lastRan = 0;
+
+		enqueue(newTask);
+
+		++(this->load);
+
+		LocalTimer::kick(host);
+
+		SpinUnlock(&lock);
+)
+
+	return (newTask);
+}
+
+Task *RealTime::allocate(Time t, Processor *cpu)
+{
+	return (pickNext());
+}
+
+/**
+ * Keeps running the current task unless a higher-priority task is queued,
+ * or its round-robin quantum has expired (in which case it goes to the end
+ * of its queue). The quantum is charged the ticks since the last update, as
+ * the timer interrupt doesn't update the roller on every tick.
+ *
+ * @param t - present time
+ * @param cpu - the cpu owning this runqueue
+ * @return - the task to run next
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+Task *RealTime::update(Time t, Processor *cpu)
+{
+	Task *curr = currentTask;
+
+	if(curr != null && cpu->ctask == curr)
+	{
+		ScheduleInfo *tsched = &cpu->crolStatus;
+		unsigned long ticks = tsched->CurrentQuanta - tsched->LeftQuanta;
+
+		if(curr->rtPolicy == RT_ROUND_ROBIN)
+			curr->rtQuantum -= (ticks < curr->rtQuantum) ?
+						ticks : curr->rtQuantum;
+
+		if(curr->rtPolicy == RT_ROUND_ROBIN && curr->rtQuantum == 0)
+		{
+			curr->rtQuantum = RT_QUANTUM;
+			dequeue(curr);
+			enqueue(curr);
+		}
+		else if(highestPriority() <= curr->rtPriority)
+		{
+			return (curr);
+		}
+	}
+
+	RunqueueBalancer::balanceWork(REAL_TIME);
+	return (pickNext());
+}
+
+void RealTime::free(Time at, Processor *cpu)
+{
+	currentTask = null;
+}
+
+/*
+ * A RT_FIFO task runs until a higher-priority task is added (which forces
+ * an update), and a RT_ROUND_ROBIN task for the rest of its quantum.
+ */
+unsigned long RealTime::quantum(Time t, Processor *cpu)
+{
+	if(currentTask == null)
+		return (1);
+
+	return ((currentTask->rtPolicy == RT_ROUND_ROBIN) ?
+			currentTask->rtQuantum : SCHED_QUANTUM_MAX);
+}
+
+/*
+ * Removes the task from the queue for its priority. Tells whether the task
+ * was queued here.
+ */
+bool RealTime::remove(Task *tTask)
+{
+	bool queued;
+
+	__irq_save_func(
+		SpinLock(&lock);
+
+		queued = (tTask->rqKey != RT_UNQUEUED &&
+				tTask->cpu->lschedTable[REAL_TIME] == this);
+
+		if(queued)
+		{
+			dequeue(tTask);
+
+			if(tTask == currentTask)
+				currentTask = null;
+
+			--(this->load);
+		}
+
+		SpinUnlock(&lock);
+	)
+
+	return (queued);
+}
+
+/**
+ * Method: RealTime::send
+ *
+ * Summary:
+ * Takes out upto 'delta' tasks from this runqueue, lowest priorities first
+ * (as they would wait the longest here). The currently executing task,
+ * tasks which are still cache-hot, and tasks not allowed to run on the
+ * destination cpu are not sent.
+ *
+ * Since: Silcos 3.05
+ * Author: Shukant Pal
+ */
+void RealTime::send(Processor *from, Processor *to, CircularList& list,
+		unsigned long delta)
+{
+	Task *task, *nextTask;
+	unsigned long count;
+	Time now = XMilliTime;
+	Time cost = DomainBinding::migrationCost(from, to);
+
+	list.lMain = null;
+	list.count = 0;
+
+	for(unsigned long prio = 0; prio < RT_PRIORITIES && delta; prio++)
+	{
+		task = (Task*) queues[prio].lMain;
+		count = queues[prio].count;
+
+		for(unsigned long idx = 0; idx < count && delta; idx++)
+		{
+			nextTask = task->next;
+
+			if(task != from->ctask && task->allowedOn(to->hw.APICID) &&
+					!isCacheHot(task, now, cost))
+			{
+				dequeue(task);
+				AddCElement((CircularListNode*) task, CLAST, &list);
+				--(delta);
+			}
+
+			task = nextTask;
+		}
+	}
+
+	this->load -= list.count;
+}
+
+/**
+ * Method: RealTime::recieve
+ *
+ * Summary:
+ * Adds the chain of incoming tasks to the queues for their priorities.
+ *
+ * Since: Silcos 3.05
+ * Author: Shukant Pal
+ */
+void RealTime::recieve(Task *first, Task *last, unsigned long count, unsigned long load)
+{
+	Processor *host = GetProcessorById(PROCESSOR_ID);
+	Task *task = first, *nextTask;
+
+	SpinLock(&lock);
+
+	for(unsigned long idx = 0; idx < count; idx++)
+	{
+		nextTask = task->next;
+
+		task->cpu = host;
+		enqueue(task);
+
+		task = nextTask;
+	}
+
+	this->load += count;
+
+	SpinUnlock(&lock);
+}
+
+unsigned long RealTime::urgency(Task *task)
+{
+	return (task->rtPriority);
+}
+
+/**
+ * Changes the real-time priority of the given task, which may be on any
+ * cpu. If the task is queued here, it is moved to the queue for its new
+ * priority, and its cpu is made to reschedule; otherwise, the priority is
+ * taken when the task is queued next (i.e. when it wakes up, or arrives at
+ * another cpu). A task queued on another cpu must be changed through the
+ * roller of that cpu.
+ *
+ * @param task - the task whose priority is to be changed
+ * @param urgency - new priority, clamped to RT_PRIORITIES - 1
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void RealTime::setUrgency(Task *task, unsigned long urgency)
+{
+	if(urgency >= RT_PRIORITIES)
+		urgency = RT_PRIORITIES - 1;
+
+	__irq_save_func(
+		Processor *cpu = task->cpu;
+		bool queued;
+
+		SpinLock(&lock);
+
+		queued = (task->rqKey != RT_UNQUEUED &&
+				cpu->lschedTable[REAL_TIME] == this);
+
+		if(queued)
+			dequeue(task);
+
+		task->rtPriority = urgency;
+
+		if(queued)
+			enqueue(task);
+
+		SpinUnlock(&lock);
+
+		if(queued)
+		{
+			if(cpu == GetProcessorById(PROCESSOR_ID))
+				LocalTimer::kick(cpu);
+			else
+				CPUDriver::wakeup(cpu);
+		}
+	)
+}
+
+RealTime::RealTime()
+{
+	this->queueBitmap = 0;
+	this->currentTask = null;
+
+	for(unsigned long prio = 0; prio < RT_PRIORITIES; prio++)
+	{
+		queues[prio].count = 0;
+		queues[prio].lMain = null;
+	}
+}
+
+RealTime::~RealTime(){}
+
+void RealTime::enqueue(Task *task)
+{
+	task->rqKey = task->rtPriority;
+	AddCElement((CircularListNode*) task, CLAST, &queues[task->rqKey]);
+	queueBitmap |= 1UL << task->rqKey;
+}
+
+void RealTime::dequeue(Task *task)
+{
+	CircularList *queue = &queues[task->rqKey];
+
+	RemoveCElement((CircularListNode*) task, queue);
+
+	if(queue->count == 0)
+		queueBitmap &= ~(1UL << task->rqKey);
+
+	task->rqKey = RT_UNQUEUED;
+}
+
+/*
+ * Picks the first task in the highest-priority non-empty queue.
+ */
+Task *RealTime::pickNext()
+{
+	currentTask = (queueBitmap) ?
+			(Task*) queues[highestPriority()].lMain : null;
+
+	return (currentTask);
+}
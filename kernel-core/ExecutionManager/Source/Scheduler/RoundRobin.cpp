@@ -18,6 +18,8 @@
  */
 #include <Executable/RoundRobin.h>
 #include <Executable/RunqueueBalancer.hpp>
+#include <Executable/Scheduler.h>
+#include <HardwareAbstraction/LocalTimer.hpp>
 #include <HardwareAbstraction/Processor.h>
 #include <HardwareAbstraction/ProcessorTopology.hpp>
 #include <KERNEL.h>
@@ -28,9 +30,18 @@ using namespace Executable;
 Task *RoundRobin::add(Executable::Task *newTask)
 {
 	Processor *host = GetProcessorById(PROCESSOR_ID);
+	Time now = getSystemTime();
 
 	__no_interrupts
 (
+		SpinLock(&lock);
+
+		newTask->loadAvg.init(now);
+		newTask->lastRan = 0;
+		newTask->cpu = host;
+		newTask->schedClass = ROUND_ROBIN;
+		newTask->rqKey = RR_QUEUED;
+
 		if(mainTask != null)
 		{
 			newTask->next = mainTask;
@@ -49,7 +60,9 @@ Task *RoundRobin::add(Executable::Task *newTask)
 		++(taskCount);
 		++(host->lschedTable[ROUND_ROBIN]->load);
 
-		ProcessorTopology::Iterator::toggleLoad(host, ROUND_ROBIN, 1);
+		LocalTimer::kick(host);
+
+		SpinUnlock(&lock);
 )
 
 	return (newTask);
@@ -57,189 +70,185 @@ Task *RoundRobin::add(Executable::Task *newTask)
 
 Executable::Task *RoundRobin::allocate(Time tstamp, Processor *proc)
 {
-	Executable::Task *ntask;
-
-	if(mostRecent == NULL)
-		ntask = mainTask;
+	if(mainTask == null)
+		currentTask = null;
+	else if(mostRecent == null)
+		currentTask = mainTask;
 	else
-		ntask = mostRecent->next;
+		currentTask = mostRecent->next;
 
-	return (ntask);
+	return (currentTask);
 }
 
 Executable::Task *RoundRobin::update(Time time, Processor *proc)
 {
-	mostRecent = proc->ctask;
+	if(currentTask != null && proc->ctask == currentTask)
+		mostRecent = currentTask;
 
 	RunqueueBalancer::balanceWork(ROUND_ROBIN);
-	return mostRecent->next;
+	return (allocate(time, proc));
 }
 
 void RoundRobin::free(Time tstamp, Processor *proc)
 {
-	mostRecent = (Executable::Task*) proc->ctask;
-}
-
-void RoundRobin::remove(Executable::Task *ttask) __no_interrupt_func
-(
-	if(mostRecent->next != ttask)
-	{
-		no_intr_ret;
-	}
-	else
-	{
-		if(ttask->next)
-			ttask->next->last = ttask->last;
+	if(currentTask != null && proc->ctask == currentTask)
+		mostRecent = currentTask;
 
-		if(ttask->last)
-			ttask->last->next = ttask->next;
-
-		if(ttask == mainTask)
-			mainTask = ttask->next;
-
-		if(ttask == mostRecent)
-			mostRecent = ttask->last;
-	}
+	currentTask = null;
+}
 
-	ProcessorTopology::Iterator::toggleLoad(NULL, ROUND_ROBIN, -1);
-)
+/*
+ * Each task runs for RR_QUANTUM ticks before the next one in the ring.
+ */
+unsigned long RoundRobin::quantum(Time t, Processor *proc)
+{
+	return ((currentTask != null) ? RR_QUANTUM : 1);
+}
 
 /**
- * Method: RoundRobin::send
- * Attributes: huge (really, really)
- *
- * Algorithm:
- * This function is supposed to fill the circular-list of tasks with 'delta'
- * count. The currently executing task cannot be transferred. It works by
- * following these steps ->
+ * Removes the task from the ring. If it is the most recently run task, its
+ * predecessor takes its place, so that the rotation continues after it.
  *
- * 1. If delta is 1, then we just need to remove on task out of the list. No
- *    need for isolating a chain of tasks. But if delta is greater then goto
- *    step 4.
- *
- * 2. To remove any one task, there must be atleast one task that is not
- *    executing. That task is to be removed and put in the list
- *
- * Since: Silcos 2.05
+ * @param ttask - the task to remove
+ * @return - whether the task was in the ring
+ * @version 2.1
+ * @since Silcos 2.05
+ * @author Shukant Pal
  */
-void RoundRobin::send(Processor *to, CircularList& list, unsigned long delta)
+bool RoundRobin::remove(Executable::Task *ttask)
 {
-	Processor *from = GetProcessorById(PROCESSOR_ID);
+	bool queued;
 
-	if(delta == 1)// just remove one
-	{
-		if(taskCount > 1 || from->ctask != mainTask)
-		{
-			Executable::Task *rem = mainTask;
-			if(rem == from->ctask)
-				rem = rem->next;
+	__irq_save_func(
+		SpinLock(&lock);
 
-			rem->last->next = rem->next;
-			rem->next->last = rem->last;
-			--(taskCount);
+		queued = (ttask->rqKey == RR_QUEUED &&
+				ttask->cpu->lschedTable[ROUND_ROBIN] == this);
 
-			if(taskCount == 0)
-				mainTask = null;
-			else if(rem == mainTask)
-				mainTask = rem->next;
-
-			--(this->load);
-			ProcessorTopology::Iterator::toggleLoad(from, ROUND_ROBIN, -1);
-
-			list.lMain = (CircularListNode*) rem;
-			rem->next = rem;
-			rem->last = rem;
-			list.count = 1;
-		}
-		else
+		if(queued)
 		{
-			list.lMain = null;
-			list.count = 0;
-		}
+			if(taskCount == 1)
+			{
+				mainTask = null;
+				mostRecent = null;
+			}
+			else
+			{
+				ttask->next->last = ttask->last;
+				ttask->last->next = ttask->next;
 
-		return;
-	}
+				if(ttask == mainTask)
+					mainTask = ttask->next;
 
-	unsigned long orgDelta = delta;
-	Executable::Task *first = mainTask;
-	Executable::Task *last = mainTask->next;
-	--delta;
+				if(ttask == mostRecent)
+					mostRecent = ttask->last;
+			}
 
-	Executable::Task *executor = NULL;
+			if(ttask == currentTask)
+				currentTask = null;
 
-	if(last == from->ctask)
-		executor = last;
+			ttask->rqKey = RR_UNQUEUED;
 
-	while(--delta && last != first)
-	{
-		if(last == from->ctask)
-		{
-			executor = last;
-			++delta;// executor ain't going to hell :)
+			--(taskCount);
+			--(this->load);
 		}
 
-		last = last->next;
-	}
+		SpinUnlock(&lock);
+	)
 
-	// 1. if ctask is in the chain, remove it.
+	return (queued);
+}
 
-	if(executor != null)
-	{
-		executor->last->next = executor->next;
-		executor->next->last = executor->last;
-	}
+/**
+ * Method: RoundRobin::send
+ *
+ * Summary:
+ * Takes out upto 'delta' tasks from the ring, and chains them in the
+ * circular-list given. Tasks ahead in the ring ran the longest time ago,
+ * and so the scan stops at the first cache-hot task. The currently
+ * executing task, and tasks not allowed to run on the destination cpu, are
+ * skipped.
+ *
+ * Since: Silcos 2.05
+ */
+void RoundRobin::send(Processor *from, Processor *to, CircularList& list,
+		unsigned long delta)
+{
+	Time now = XMilliTime;
+	Time cost = DomainBinding::migrationCost(from, to);
+	Executable::Task *probe = mainTask, *nextProbe;
+	unsigned long scan = taskCount;
 
-	// 2. now isolate the chain of outgoing tasks
+	list.lMain = null;
+	list.count = 0;
 
-	// if all tasks (other than executor) are getting out...
-	if(last == first->last)
+	while(scan-- && delta && probe != null)
 	{
-		if(executor != null)
-		{
-			executor->next = executor;
-			executor->last = executor;
-		}
-		else
+		nextProbe = probe->next;
+
+		if(probe == from->ctask || !probe->allowedOn(to->hw.APICID))
 		{
-			mainTask = null;
+			probe = nextProbe;
+			continue;
 		}
-	} // else if tasks really need to be isolated...
-	else
-	{
-		Executable::Task *newMain = first->last;
 
-		if(executor == null)
+		if(isCacheHot(probe, now, cost))
+			break;
+
+		if(taskCount == 1)
 		{
-			last->next->last = newMain;
-			newMain->next = last->next;
+			mainTask = null;
+			nextProbe = null;
 		}
 		else
 		{
-			newMain->next = executor;
-			executor->last = newMain;
+			probe->last->next = probe->next;
+			probe->next->last = probe->last;
 
-			executor->next = last->next;
-			last->next->last = executor;
+			if(probe == mainTask)
+				mainTask = probe->next;
 		}
 
-		first->last = last;
-		last->next = first;
-	}
+		--(taskCount);
+		--(this->load);
+
+		probe->rqKey = RR_UNQUEUED;
+		AddCElement((CircularListNode*) probe, CLAST, &list);
+		--(delta);
 
-	list.lMain = (CircularListNode*) first;
-	list.count = orgDelta - delta;
-	this->load -= list.count;
-	taskCount = load;
+		probe = nextProbe;
+	}
 
-	ProcessorTopology::Iterator::toggleLoad(NULL, ROUND_ROBIN, -list.count);
+	forgetSent(list);
 }
 
 RoundRobin::RoundRobin()
 {
 	this->mainTask = this->mostRecent = null;
+	this->currentTask = null;
 	this->taskCount = 0;
 }
 
+/*
+ * Resets mostRecent if it was sent away, as the rotation can't continue
+ * from a task that is no longer in the ring.
+ */
+void RoundRobin::forgetSent(CircularList& list)
+{
+	Executable::Task *task = (Executable::Task*) list.lMain;
+
+	for(unsigned long idx = 0; idx < list.count; idx++)
+	{
+		if(task == mostRecent)
+		{
+			mostRecent = null;
+			break;
+		}
+
+		task = task->next;
+	}
+}
+
 RoundRobin::~RoundRobin(){}
 
 /**
@@ -247,13 +256,25 @@ RoundRobin::~RoundRobin(){}
  *
  * Summary:
  * Connects the chain of incoming tasks to the mainTask, therefore adding them
- * to the runqueue.
+ * to the runqueue, and marks them as being in this cpu's ring.
  *
  * Since: Silcos 2.05
  * Author: Shukant Pal
  */
 void RoundRobin::recieve(Executable::Task *first, Executable::Task *last, unsigned long count, unsigned long load)
 {
+	Processor *host = GetProcessorById(PROCESSOR_ID);
+	Executable::Task *task = first;
+
+	SpinLock(&lock);
+
+	for(unsigned long idx = 0; idx < count; idx++)
+	{
+		task->cpu = host;
+		task->rqKey = RR_QUEUED;
+		task = task->next;
+	}
+
 	if(mainTask)
 	{
 		last->next = mainTask->next;
@@ -265,12 +286,12 @@ void RoundRobin::recieve(Executable::Task *first, Executable::Task *last, unsign
 	else
 	{
 		last->next = first;
-		first->next = last;
+		first->last = last;
 		mainTask = first;
 	}
 
 	taskCount += count;
 	this->load += count;
 
-	ProcessorTopology::Iterator::toggleLoad(NULL, ROUND_ROBIN, +load);
+	SpinUnlock(&lock);
 }
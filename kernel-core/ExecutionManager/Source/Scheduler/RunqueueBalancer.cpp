@@ -56,6 +56,9 @@ void RunqueueBalancer::init()
  * Checks whether any parent domain of the current cpu can be balanced by
  * evaluating the time until which the runqueue-balancer was stopped. If
  * the time has passed then the domain goes through the balancing routine.
+ * Inner domains are balanced first, and outer ones are not balanced once
+ * tasks have been requested - so that tasks move b/w SMT siblings & cores
+ * of the same package, rather than across packages, where possible.
  *
  * Args:
  * ScheduleClass cls - the scheduler-class for which the balancer should
@@ -77,8 +80,10 @@ void RunqueueBalancer::balanceWork(ScheduleClass cls)
 
 	while(rqholder->parent != NULL)
 	{
-		if(getSystemTime() > rqholder->taskInfo[cls].balanceDelta)
-			balanceWork(cls, rqholder);
+		if(getSystemTime() > rqholder->taskInfo[cls].balanceDelta &&
+				balanceWork(cls, rqholder))
+			break;// tasks are coming from the nearest domain possible
+
 		rqholder = rqholder->parent;
 	}
 }
@@ -100,16 +105,19 @@ void RunqueueBalancer::balanceWork(ScheduleClass cls)
  * ScheduleClass cls - schedule-class for which the domain is to get/give tasks
  * Domain *client - the domain undergoing balancing
  *
+ * Returns: whether a renounce request was sent
+ *
  * Since: Silcos 2.05
  * Author: Shukant Pal
  */
-void RunqueueBalancer::balanceWork(ScheduleClass cls, Domain *client)
+bool RunqueueBalancer::balanceWork(ScheduleClass cls, Domain *client)
 {
 	Domain *busiest = DomainBinding::findBusiestGroup(cls, client);
+	bool requested = false;
 
 	if(!busiest)
 	{
-		return;// TODO: Implement shutting off the CPUs
+		return (false);// TODO: Implement shutting off the CPUs
 	}
 	else if(busiest != client)
 	{
@@ -119,9 +127,80 @@ void RunqueueBalancer::balanceWork(ScheduleClass cls, Domain *client)
 
 		Renounce *req = new(tRunqueueBalancer_Renounce) Renounce(cls, *busiest, *client, *srcCPU, *dstCPU);
 		CPUDriver::writeRequest(*req, srcCPU);
+		requested = true;
 	}
 
 	SpinLock(&client->queueLock);
-	client->taskInfo[cls].balanceDelta += (client->level + 1) * (client->level + 1) * 8;
+	client->taskInfo[cls].balanceDelta = getSystemTime() +
+			(client->level + 1) * (client->level + 1) * BALANCE_INTERVAL;
 	SpinUnlock(&client->queueLock);
+
+	return (requested);
+}
+
+/**
+ * Pulls a batch of tasks of the given class from the busiest cpu nearby,
+ * when the runqueue of this cpu has emptied. The innermost domain is
+ * searched first (so that tasks stay near their caches), and then outer
+ * domains, until a victim is found.
+ *
+ * The victim's roller is only try-locked, and it is skipped if it is busy,
+ * so that an idle cpu never spins on a contended runqueue. No IPI is sent
+ * to the victim, unlike the renounce/accept protocol used by balanceWork.
+ *
+ * @param cls - scheduling class from which tasks are to be stolen
+ * @return - whether any task was stolen
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool RunqueueBalancer::steal(ScheduleClass cls)
+{
+	Processor *self = GetProcessorById(PROCESSOR_ID);
+	ScheduleRoller *roller;
+	Processor *victim;
+	CircularList stolen;
+	unsigned long batch;
+
+	if(self->lschedTable[cls] == NULL || self->domlink == NULL)
+		return (false);
+
+	Domain *level = self->domlink->parent;
+
+	while(level != NULL)
+	{
+		victim = DomainBinding::getBusiest(cls, level);
+
+		if(victim != NULL && victim != self)
+		{
+			roller = victim->lschedTable[cls];
+
+			/* One task is left for the victim (it may be running) */
+			if(roller->load > 1 && TestLock(&roller->lock))
+			{
+				batch = roller->load / 2;
+				if(batch > STEAL_BATCH_MAX)
+					batch = STEAL_BATCH_MAX;
+
+				roller->send(victim, self, stolen, batch);
+				roller->detachLoad(stolen);
+				SpinUnlock(&roller->lock);
+
+				if(stolen.count != 0)
+				{
+					self->lschedTable[cls]->attachLoad(
+						(Task*) stolen.lMain, stolen.count);
+					self->lschedTable[cls]->recieve(
+						(Task*) stolen.lMain,
+						(Task*) stolen.lMain->last,
+						stolen.count, stolen.count);
+					return (true);
+				}
+			}
+		}
+
+		level = level->parent;
+	}
+
+	return (false);
 }
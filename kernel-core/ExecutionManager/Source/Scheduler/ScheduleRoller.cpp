@@ -27,6 +27,8 @@ ScheduleRoller::ScheduleRoller()
 	this->load = 0;
 	this->loadRequested = 0;
 	this->transferDelta = 0;
+	this->loadAvg.init(0);
+	this->foldedLoad = 0;
 	SpinUnlock(&lock);
 }
 
@@ -1,21 +1,159 @@
 /* Copyright (C) 2017 - Shukant Pal */
 
 #include <Debugging.h>
+#include <Executable/RCU.hpp>
+#include <Executable/RunqueueBalancer.hpp>
 #include <Executable/Scheduler.h>
 #include <Executable/ScheduleRoller.h>
+#include <Executable/Tickless.hpp>
+#include <Executable/WaitQueue.hpp>
+#include <HardwareAbstraction/FPU.hpp>
+#include <HardwareAbstraction/ProcessorTopology.hpp>
 #include <Memory/Pager.h>
 #include "../../../Interface/Utils/AVLTree.hpp"
 
 using namespace HAL;
 using namespace Executable;
 
-Time XMilliTime; /* Maintain 64-bit kernel time. */
+MonotonicAtomic<Time> XMilliTime; /* Maintain 64-bit kernel time. */
+
+/*
+ * Gives the roller of the highest-precedence class having runnable tasks on
+ * the cpu. Classes with a higher index take precedence, and round-robin
+ * (the batch class) is used if no other class has tasks.
+ */
+static inline Executable::ScheduleRoller *PickRoller(Processor *tproc)
+{
+	Executable::ScheduleRoller *roller;
+
+	for(unsigned long cls = SCHED_ROLLER_TYPES - 1; cls > ROUND_ROBIN; cls--)
+	{
+		roller = tproc->lschedTable[cls];
+
+		if(roller != NULL && roller->getLoad() != 0)
+			return (roller);
+	}
+
+	return (tproc->lschedTable[ROUND_ROBIN]);
+}
+
+/*
+ * Tries to steal work for an idle cpu, from the highest-precedence class
+ * first.
+ */
+static inline bool StealWork()
+{
+	for(unsigned long cls = SCHED_ROLLER_TYPES; cls-- > 0; )
+	{
+		if(RunqueueBalancer::steal(cls))
+			return (true);
+	}
+
+	return (false);
+}
+
+/*
+ * Accounts the time since the last tick in the load-averages of all the
+ * runqueues on the cpu, and folds them into its domains every
+ * LOAD_FOLD_INTERVAL ms.
+ */
+static inline void UpdateLoad(Processor *tproc, Executable::ScheduleRoller *running,
+					Time now)
+{
+	ScheduleInfo *tsched = &tproc->crolStatus;
+	Executable::ScheduleRoller *roller;
+
+	for(unsigned long cls = 0; cls < SCHED_ROLLER_TYPES; cls++)
+	{
+		roller = tproc->lschedTable[cls];
+
+		if(roller != NULL)
+			roller->loadAvg.update(now, roller == running, roller->load);
+	}
+
+	if(now >= tsched->loadFoldTime)
+	{
+		for(unsigned long cls = 0; cls < SCHED_ROLLER_TYPES; cls++)
+			ProcessorTopology::Iterator::foldLoad(tproc, (ScheduleClass) cls);
+
+		tsched->loadFoldTime = now + LOAD_FOLD_INTERVAL;
+	}
+}
+
+/*
+ * Sets the no. of ticks for which the timer interrupt returns without
+ * calling the scheduler (KiClockRespond counts them down in LeftQuanta).
+ * The next task runs for the quantum given by its roller, but the ticks
+ * are cut short for any timed-event requested on the cpu. In one-shot mode,
+ * no tick is skipped - ProgramTick() fires the timer when the quantum (kept
+ * in CurrentQuanta) ends instead.
+ */
+static inline void SetQuantum(Processor *tproc, Executable::ScheduleRoller *roller,
+					Executable::Task *ntask, Time now)
+{
+	ScheduleInfo *tsched = &tproc->crolStatus;
+	unsigned long quanta = 1;
+
+	if(ntask != (Executable::Task*) tproc->IdlerThread)
+	{
+		quanta = roller->quantum(now, tproc);
+
+		if(quanta > SCHED_QUANTUM_MAX)
+			quanta = SCHED_QUANTUM_MAX;
+		else if(quanta == 0)
+			quanta = 1;
+
+		if(tsched->nextEvent - now < quanta)
+			quanta = (unsigned long) (tsched->nextEvent - now);
+	}
+
+	tsched->CurrentQuanta = quanta;
+	tsched->LeftQuanta = (oneShotTimerEnabled) ? 0 : quanta - 1;
+}
+
+/*
+ * Counts a millisecond of system time, on the boot-strap cpu's periodic
+ * tick (called by KiClockRespond). The time is 64-bit, and so its carry
+ * must not be lost b/w the halves.
+ */
+export_asm void KiTickClock()
+{
+	XMilliTime.fetchAdd(1, MEMORY_RELAXED);
+}
 
 export_asm void Schedule(Processor *tproc)
 {
 	ScheduleInfo *tsched = &tproc->crolStatus;
 	Executable::ScheduleRoller *lrol = tsched->presRoll;
-	Executable::ScheduleRoller *nrol = tproc->lschedTable[0];
+	Executable::Task *ltask = tproc->ctask;
+
+	/* An interrupt which woke idle() may switch away before it clears this */
+	tproc->polling = 0;
+	tsched->needResched = 0;
+
+	if(oneShotTimerEnabled)
+		UpdateSystemTime();
+
+	/* XMilliTime is read once, so that this run sees a single time */
+	Time now = XMilliTime.load(MEMORY_RELAXED);
+
+	if(now >= tsched->nextEvent)
+		tsched->nextEvent = LOCAL_TIMER_NEVER;
+
+	EnforceAffinity(tproc);
+	RcuQuiescent(tproc);
+	WakeupExpiredWaiters(tproc);
+	FlushWakeups(tproc);
+	FlushClassChanges(tproc);
+	tproc->irqWorkQueue.poll(tproc);
+	tproc->workQueue.poll(tproc);
+
+	UpdateLoad(tproc, lrol, now);
+
+	Executable::ScheduleRoller *nrol = PickRoller(tproc);
+
+	if(nrol->getLoad() == 0 && StealWork())
+		nrol = PickRoller(tproc);
 
 	tsched->presRoll = nrol;
 	Executable::Task *ntask;
@@ -24,17 +162,48 @@ export_asm void Schedule(Processor *tproc)
 	{
 		if(lrol != NULL)
 		{
-			lrol->free(XMilliTime, tproc);
+			SpinLock(&lrol->lock);
+			lrol->free(now, tproc);
+			SpinUnlock(&lrol->lock);
 		}
 
-		ntask = nrol->allocate(XMilliTime, tproc);
+		SpinLock(&nrol->lock);
+		ntask = nrol->allocate(now, tproc);
 	}
 	else
 	{
-		ntask = nrol->update(XMilliTime, tproc);
+		SpinLock(&nrol->lock);
+		ntask = nrol->update(now, tproc);
+	}
+
+	/* The idle task runs when no class has a runnable task */
+	if(ntask == NULL)
+		ntask = (Executable::Task*) tproc->IdlerThread;
+
+	/* ctask is changed under the lock, as thieves must not take it */
+	if(ntask != NULL)
+		tproc->ctask = ntask;
+
+	SetQuantum(tproc, nrol, ntask, now);
+	SpinUnlock(&nrol->lock);
+	ProgramTick(tproc);
+
+	if(ntask == NULL)
+		return;
+
+	if(ntask != ltask)
+	{
+		FPU::switchOut(tproc, ltask);
+
+		if(ltask != NULL)
+		{
+			ltask->loadAvg.update(now, true, 1);
+			ltask->lastRan = now;
+		}
+
+		ntask->loadAvg.update(now, false, 1);
 	}
 
-	tproc->ctask = ntask;
 	if(ntask->mmu != NULL)
 		Pager::switchSpace(ntask->mmu);
 }
@@ -0,0 +1,130 @@
+/**
+ * File: Tickless.cpp
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <Executable/Scheduler.h>
+#include <Executable/ScheduleRoller.h>
+#include <Executable/Tickless.hpp>
+
+using namespace HAL;
+using namespace Executable;
+
+/**
+ * Brings XMilliTime up to the system clock, in one-shot mode. As cpus
+ * read the clock-source independently, the time is only moved forward;
+ * a cpu which loses the race to another with a later time gives up.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void UpdateSystemTime()
+{
+	Time now = LocalTimer::readClock();
+	Time then = XMilliTime.load(MEMORY_RELAXED);
+
+	while(now > then && !XMilliTime.compareExchange(then, now));
+}
+
+/**
+ * Programs the local timer of the current cpu for the next time its
+ * scheduler must run, after a scheduling decision. While more than one
+ * task is runnable, the timer fires when the quantum set for the current
+ * task ends (which is already cut short for the earliest event); with one
+ * task, it is deferred upto NOHZ_BUSY_DEFER ms; and when idle, it fires
+ * only for the earliest event requested on the cpu (or not at all).
+ *
+ * This does nothing if the local timers are periodic.
+ *
+ * @param cpu - the current cpu
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Executable::ProgramTick(Processor *cpu)
+{
+	if(!oneShotTimerEnabled)
+		return;
+
+	ScheduleInfo *tsched = &cpu->crolStatus;
+	ScheduleRoller *roller;
+	unsigned long runnable = 0;
+	Time now = XMilliTime.load(MEMORY_RELAXED);
+	Time expiry;
+
+	for(unsigned long cls = 0; cls < SCHED_ROLLER_TYPES; cls++)
+	{
+		roller = cpu->lschedTable[cls];
+
+		if(roller != NULL)
+			runnable += roller->getLoad();
+	}
+
+	if(runnable > 1)
+	{
+		expiry = now + tsched->CurrentQuanta;
+	}
+	else
+	{
+		expiry = (runnable) ? now + NOHZ_BUSY_DEFER
+				: LOCAL_TIMER_NEVER;
+
+		if(tsched->nextEvent < expiry)
+			expiry = tsched->nextEvent;
+	}
+
+	LocalTimer::fireAt(cpu, expiry);
+}
+
+/**
+ * Requests the scheduler of the current cpu to run at the given time, even
+ * if the tick is deferred or stopped (or, with periodic timers, skipped for
+ * the current task's quantum). The request is forgotten once that time has
+ * passed, and so the requester must check for its events then.
+ *
+ * Interrupts must be disabled by the caller.
+ *
+ * @param cpu - the current cpu
+ * @param at - system-time at which the scheduler must run
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Executable::RequestTickAt(Processor *cpu, Time at)
+{
+	ScheduleInfo *tsched = &cpu->crolStatus;
+
+	if(at < tsched->nextEvent)
+		tsched->nextEvent = at;
+
+	if(oneShotTimerEnabled)
+	{
+		if(at < tsched->tickExpiry)
+			LocalTimer::fireAt(cpu, at);
+	}
+	else
+	{
+		Time now = XMilliTime.load(MEMORY_RELAXED);
+		Time left = (at > now) ? at - now - 1 : 0;
+
+		if(left < tsched->LeftQuanta)
+		{
+			tsched->CurrentQuanta -= tsched->LeftQuanta - (unsigned long) left;
+			tsched->LeftQuanta = (unsigned long) left;
+		}
+	}
+}
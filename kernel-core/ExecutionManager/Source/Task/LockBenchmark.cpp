@@ -0,0 +1,181 @@
+/**
+ * @file LockBenchmark.cpp
+ *
+ * Runs the lock benchmark - every online cpu takes the same lock in a loop,
+ * from work queued on it, and the cycles taken are reported for the
+ * Spinlock, TicketLock and MCSLock.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <Executable/Task.hpp>
+#include <Executable/WorkQueue.hpp>
+#include <HardwareAbstraction/CpuSet.hpp>
+#include <HardwareAbstraction/Processor.h>
+#include <Synch/LockBenchmark.hpp>
+#include <Synch/MCSLock.hpp>
+#include <Synch/TicketLock.hpp>
+#include <Debugging.h>
+#include <KERNEL.h>
+
+using namespace HAL;
+using namespace Executable;
+
+enum BenchLock
+{
+	BENCH_SPINLOCK,
+	BENCH_TICKET_LOCK,
+	BENCH_MCS_LOCK,
+	BENCH_LOCK_TYPES
+};
+
+static const char *benchLockNames[BENCH_LOCK_TYPES] = {
+	"Spinlock", "TicketLock", "MCSLock"
+};
+
+static Spinlock benchSpinlock;
+static TicketLock benchTicketLock;
+static MCSLock benchMCSLock;
+
+static volatile unsigned long benchCounter;// guarded by the lock measured
+static volatile unsigned long benchWaiting;// cpus yet to start the run
+static U64 benchCycles[CPUSET_MAX];// cycles taken by each cpu
+
+static Work benchWork[CPUSET_MAX];
+static unsigned long benchLock;// BenchLock being measured
+
+static inline U64 ReadTSC()
+{
+	U64 tsc;
+	asm volatile("rdtsc" : "=A"(tsc));
+	return (tsc);
+}
+
+template<class Lock>
+static U64 Hammer(Lock *lock)
+{
+	U64 start = ReadTSC();
+
+	for(unsigned long round = 0; round < LOCK_BENCH_ROUNDS; round++)
+	{
+		SpinLock(lock);
+		benchCounter = benchCounter + 1;
+		SpinUnlock(lock);
+	}
+
+	return (ReadTSC() - start);
+}
+
+/*
+ * Runs on each cpu. All cpus start hammering together, so that the lock
+ * stays contended for the whole run.
+ */
+static void BenchOnCpu(void *cpuId)
+{
+	__sync_fetch_and_sub(&benchWaiting, 1);
+
+	while(benchWaiting != 0)
+		asm volatile("pause");
+
+	U64 cycles = 0;
+
+	switch(benchLock)
+	{
+	case BENCH_SPINLOCK:
+		cycles = Hammer(&benchSpinlock);
+		break;
+	case BENCH_TICKET_LOCK:
+		cycles = Hammer(&benchTicketLock);
+		break;
+	case BENCH_MCS_LOCK:
+		cycles = Hammer(&benchMCSLock);
+		break;
+	}
+
+	benchCycles[(unsigned long) cpuId] = cycles;
+}
+
+/**
+ * Runs the lock benchmark on all online cpus, and prints the cycles taken
+ * for each acquisition of the lock (by the slowest cpu), for each type of
+ * lock. A lost update in the guarded counter is also reported, as the lock
+ * isn't exclusive then. Must be called in task context.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void RunLockBenchmark()
+{
+	unsigned long cpus = onlineCpus.count();
+	unsigned long cpuId;
+
+	for(benchLock = 0; benchLock < BENCH_LOCK_TYPES; benchLock++)
+	{
+		benchCounter = 0;
+		benchWaiting = cpus;
+
+		for(cpuId = onlineCpus.first(); cpuId < CPUSET_MAX;
+				cpuId = onlineCpus.next(cpuId))
+		{
+			benchCycles[cpuId] = 0;
+			benchWork[cpuId].init(&BenchOnCpu, (void*) cpuId);
+			WorkQueue::queueWork(GetProcessorById(cpuId),
+						&benchWork[cpuId]);
+		}
+
+		U64 slowest = 0;
+
+		for(cpuId = onlineCpus.first(); cpuId < CPUSET_MAX;
+				cpuId = onlineCpus.next(cpuId))
+		{
+			WorkQueue::flush(&benchWork[cpuId]);
+
+			if(benchCycles[cpuId] > slowest)
+				slowest = benchCycles[cpuId];
+		}
+
+		Dbg("Lock-benchmark: ");
+		Dbg(benchLockNames[benchLock]);
+		Dbg(", cpus: ");
+		DbgInt(cpus);
+		Dbg(", cycles/lock: ");
+		DbgInt((unsigned long) (slowest / (cpus * LOCK_BENCH_ROUNDS)));
+
+		if(benchCounter != cpus * LOCK_BENCH_ROUNDS)
+			Dbg(" (LOST UPDATES)");
+
+		DbgLine("");
+	}
+}
+
+/**
+ * Entry of the kernel thread which runs the lock benchmark once, after the
+ * APs have come online. Threads can't exit, and so it sleeps thereafter.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void LockBenchmarkThread()
+{
+	Task *self = GetProcessorById(PROCESSOR_ID)->ctask;
+
+	self->sleep(LOCK_BENCH_DELAY);
+	RunLockBenchmark();
+
+	while(TRUE)
+		self->sleep(LOCK_BENCH_DELAY);
+}
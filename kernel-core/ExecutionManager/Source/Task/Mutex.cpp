@@ -0,0 +1,439 @@
+/**
+ * @file Mutex.cpp
+ *
+ * Implements the sleeping mutex, with adaptive spinning & priority
+ * inheritance.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <Executable/Scheduler.h>
+#include <Executable/ScheduleRoller.h>
+#include <Executable/WaitQueue.hpp>
+#include <HardwareAbstraction/Processor.h>
+#include <Synch/Mutex.hpp>
+#include <KERNEL.h>
+
+using namespace HAL;
+using namespace Executable;
+
+static inline unsigned long UrgencyOf(Task *task)
+{
+	return (task->cpu->lschedTable[task->schedClass]->urgency(task));
+}
+
+/*
+ * Tasks of higher classes are more urgent, as they are picked first by the
+ * scheduler.
+ */
+static inline bool MoreUrgent(Task *task, Task *other)
+{
+	return (task->schedClass > other->schedClass ||
+			(task->schedClass == other->schedClass &&
+			UrgencyOf(task) > UrgencyOf(other)));
+}
+
+/*
+ * The class the task is in, or is being moved into by its cpu.
+ */
+static inline unsigned long ClassOf(Task *task)
+{
+	return ((task->piMoving) ? task->piMoveClass : task->schedClass);
+}
+
+/*
+ * The task must be changed through the roller of its cpu, and so this is
+ * retried if it moves to another cpu meanwhile.
+ */
+static void SetUrgency(Task *task, unsigned long urgency)
+{
+	Processor *cpu;
+
+	do
+	{
+		cpu = task->cpu;
+		cpu->lschedTable[task->schedClass]->setUrgency(task, urgency);
+	} while(task->cpu != cpu);
+}
+
+/**
+ * Acquires the mutex, waiting for it if it is locked. The current task
+ * spins while the owner is running on another cpu, and sleeps otherwise,
+ * lending its priority to the owner.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Mutex::lock()
+{
+	Task *self = GetProcessorById(PROCESSOR_ID)->ctask;
+
+	if(__sync_bool_compare_and_swap(&ownerWord, 0, (unsigned long) self))
+		return;
+
+	if(spinOnOwner(self))
+		return;
+
+	__cli
+	SpinLock(&waitLock);
+
+	/*
+	 * Once the waiters-bit is set, the owner can't unlock without taking
+	 * the wait-lock, and so it can't miss this task.
+	 */
+	while(TRUE)
+	{
+		unsigned long word = ownerWord;
+
+		if(word == 0)
+		{
+			if(__sync_bool_compare_and_swap(&ownerWord, 0,
+					(unsigned long) self))
+			{
+				SpinUnlock(&waitLock);
+				__sti
+				return;
+			}
+		}
+		else if((word & MUTEX_WAITERS) ||
+				__sync_bool_compare_and_swap(&ownerWord, word,
+						word | MUTEX_WAITERS))
+		{
+			break;
+		}
+	}
+
+	Task *owner = getOwner();
+
+	if(waiters == null)
+		attachTo(owner);
+
+	addWaiter(self);
+	self->blockedOn = this;
+	lendPriority(owner);
+
+	/*
+	 * The task is marked as sleeping before the wait-lock is released, so
+	 * that a hand-over b/w the two only makes commitWait() return at once.
+	 */
+	do
+	{
+		self->prepareWait(null, WAIT_FOREVER);
+		SpinUnlock(&waitLock);
+		self->commitWait();
+
+		__cli
+		SpinLock(&waitLock);
+	} while(getOwner() != self);
+
+	self->blockedOn = null;
+
+	SpinUnlock(&waitLock);
+	__sti
+}
+
+/**
+ * Acquires the mutex only if it is unlocked.
+ *
+ * @return - whether the mutex was acquired
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool Mutex::tryLock()
+{
+	Task *self = GetProcessorById(PROCESSOR_ID)->ctask;
+
+	return (__sync_bool_compare_and_swap(&ownerWord, 0,
+			(unsigned long) self));
+}
+
+/**
+ * Releases the mutex, which must be held by the current task. If tasks are
+ * waiting for it, the most urgent one is made the owner and woken up, and
+ * the priority lent by it is given up.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Mutex::unlock()
+{
+	Task *self = getOwner();
+
+	if(__sync_bool_compare_and_swap(&ownerWord, (unsigned long) self, 0))
+		return;
+
+	__cli
+	SpinLock(&waitLock);
+
+	Task *next = takeWaiter();
+
+	detachFrom(self);
+
+	if(next != null)
+	{
+		ownerWord = (unsigned long) next |
+				((waiters != null) ? MUTEX_WAITERS : 0);
+
+		if(waiters != null)
+		{
+			attachTo(next);
+			lendPriority(next);
+		}
+
+		WakeupTask(next, false);
+	}
+	else
+	{
+		ownerWord = 0;
+	}
+
+	SpinUnlock(&waitLock);
+	__sti
+}
+
+/*
+ * Spins while the owner is running on another cpu, until the mutex is
+ * acquired. Gives up if the owner is switched out, if other tasks are
+ * already sleeping on the mutex, or if this cpu has to reschedule.
+ */
+bool Mutex::spinOnOwner(Task *self)
+{
+	Processor *host = GetProcessorById(PROCESSOR_ID);
+
+	for(unsigned long spin = 0; spin < MUTEX_SPIN_MAX; spin++)
+	{
+		unsigned long word = ownerWord;
+
+		if(word == 0)
+		{
+			if(__sync_bool_compare_and_swap(&ownerWord, 0,
+					(unsigned long) self))
+				return (true);
+
+			continue;
+		}
+
+		if(word & MUTEX_WAITERS)
+			return (false);
+
+		Task *owner = (Task*) word;
+		Processor *ownerCpu = owner->cpu;
+
+		if(ownerCpu == host || ownerCpu->ctask != owner ||
+				host->crolStatus.needResched)
+			return (false);
+
+		asm volatile("pause");
+	}
+
+	return (false);
+}
+
+/*
+ * Inserts the task behind the waiters which are at least as urgent, with
+ * the wait-lock held. Waiters are linked by waitNext & waitLast, as they
+ * don't sleep on a wait-queue.
+ */
+void Mutex::addWaiter(Task *waiter)
+{
+	Task *prev = null;
+	Task *succ = waiters;
+
+	while(succ != null && !MoreUrgent(waiter, succ))
+	{
+		prev = succ;
+		succ = succ->waitNext;
+	}
+
+	waiter->waitLast = prev;
+	waiter->waitNext = succ;
+
+	if(prev != null)
+		prev->waitNext = waiter;
+	else
+		waiters = waiter;
+
+	if(succ != null)
+		succ->waitLast = waiter;
+
+	refreshTop();
+}
+
+/*
+ * Takes the most urgent waiter off the mutex, with the wait-lock held.
+ */
+Task *Mutex::takeWaiter()
+{
+	Task *first = waiters;
+
+	if(first != null)
+	{
+		waiters = first->waitNext;
+
+		if(waiters != null)
+			waiters->waitLast = null;
+
+		first->waitNext = null;
+	}
+
+	refreshTop();
+	return (first);
+}
+
+/*
+ * Caches the class & urgency of the first waiter, so that the owner can
+ * find the priority it inherits without taking the wait-lock.
+ */
+void Mutex::refreshTop()
+{
+	if(waiters != null)
+	{
+		topClass = waiters->schedClass;
+		topUrgency = UrgencyOf(waiters);
+	}
+	else
+	{
+		topClass = ROUND_ROBIN;
+		topUrgency = 0;
+	}
+}
+
+/*
+ * Raises the owner to the priority of the first waiter, if it is more
+ * urgent. An owner in a lower class is moved into the waiter's class, with
+ * a copy of the waiter's class-parameters; one in the same class only takes
+ * its urgency. The owner's own class & urgency are saved at the first boost.
+ */
+void Mutex::lendPriority(Task *owner)
+{
+	SpinLock(&owner->piLock);
+
+	unsigned long cls = ClassOf(owner);
+
+	if(topClass > cls)
+	{
+		if(!owner->piBoosted)
+		{
+			/* Its own class is still saved, if it is moving back */
+			if(!owner->piMoving)
+			{
+				owner->piClass = owner->schedClass;
+				owner->piBase = UrgencyOf(owner);
+			}
+
+			owner->piBoosted = true;
+		}
+
+		ChangeClass(owner, topClass, waiters->schedParams, topUrgency);
+	}
+	else if(topClass == cls && owner->piMoving)
+	{
+		if(owner->piMoveUrgency < topUrgency)
+		{
+			owner->piMoveUrgency = topUrgency;
+			owner->piBoosted = true;
+		}
+	}
+	else if(topClass == cls)
+	{
+		unsigned long current = UrgencyOf(owner);
+
+		if(current < topUrgency)
+		{
+			if(!owner->piBoosted)
+			{
+				owner->piClass = owner->schedClass;
+				owner->piBase = current;
+				owner->piBoosted = true;
+			}
+
+			SetUrgency(owner, topUrgency);
+		}
+	}
+
+	SpinUnlock(&owner->piLock);
+}
+
+/*
+ * Puts the mutex on the list of contended mutexes held by the owner, as
+ * its first waiter arrives (or it is handed over with waiters left).
+ */
+void Mutex::attachTo(Task *owner)
+{
+	SpinLock(&owner->piLock);
+
+	piNext = owner->piHeld;
+	owner->piHeld = this;
+
+	SpinUnlock(&owner->piLock);
+}
+
+/*
+ * Takes the mutex off the list of the owner, which is releasing it, and
+ * drops the owner to the highest urgency still lent in its own class by
+ * its other mutexes (or its own). An owner boosted into another class is
+ * moved back, unless another mutex still lends it a class above its own -
+ * then, it keeps the boost until that mutex is released too.
+ */
+void Mutex::detachFrom(Task *owner)
+{
+	SpinLock(&owner->piLock);
+
+	Mutex **link = &owner->piHeld;
+
+	while(*link != null && *link != this)
+		link = &(*link)->piNext;
+
+	if(*link == this)
+		*link = piNext;
+
+	piNext = null;
+
+	if(owner->piBoosted)
+	{
+		unsigned long effective = owner->piBase;
+		bool lentAbove = false;
+
+		for(Mutex *held = owner->piHeld; held != null;
+				held = held->piNext)
+		{
+			if(held->topClass > owner->piClass)
+				lentAbove = true;
+			else if(held->topClass == owner->piClass &&
+					held->topUrgency > effective)
+				effective = held->topUrgency;
+		}
+
+		if(ClassOf(owner) == owner->piClass)
+		{
+			if(owner->piMoving)
+				owner->piMoveUrgency = effective;
+			else
+				SetUrgency(owner, effective);
+
+			owner->piBoosted = (effective != owner->piBase);
+		}
+		else if(!lentAbove)
+		{
+			ChangeClass(owner, owner->piClass, null, effective);
+			owner->piBoosted = (effective != owner->piBase);
+		}
+	}
+
+	SpinUnlock(&owner->piLock);
+}
@@ -0,0 +1,290 @@
+/**
+ * @file RCU.cpp
+ *
+ * Tracks grace periods, and invokes the callbacks queued by callRcu() on
+ * each cpu once their grace period has completed. Cpus report quiescent
+ * states from the scheduler and the idle loop.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <Executable/RCU.hpp>
+#include <HardwareAbstraction/Processor.h>
+#include <KERNEL.h>
+
+using namespace HAL;
+using namespace Executable;
+
+static RcuState rcuState;
+
+/*
+ * Appends a list of callbacks to another. An empty list's tail isn't used,
+ * and so a zeroed list is valid.
+ */
+static inline void Splice(RcuHead **list, RcuHead ***tail, RcuHead *from,
+				RcuHead **fromTail)
+{
+	if(*list == null)
+		*list = from;
+	else
+		**tail = from;
+
+	*tail = fromTail;
+}
+
+/*
+ * Starts a new grace period, which waits for all online cpus. Idle cpus
+ * are woken up to report their quiescent state, as they may otherwise
+ * sleep until their next event. Called with the RCU state locked.
+ */
+static void StartGracePeriod()
+{
+	unsigned long self = PROCESSOR_ID;
+
+	rcuState.gpPending = onlineCpus;
+	rcuState.gpRequested = false;
+	__sync_add_and_fetch(&rcuState.gpNumber, 1);
+
+	for(unsigned long cpuId = rcuState.gpPending.first();
+			cpuId < CPUSET_MAX;
+			cpuId = rcuState.gpPending.next(cpuId))
+	{
+		Processor *cpu = GetProcessorById(cpuId);
+
+		if(cpuId != self && cpu->ctask == (Task*) cpu->IdlerThread)
+			CPUDriver::wakeup(cpu);
+	}
+}
+
+/*
+ * Gives the grace period which the callbacks queued until now must wait
+ * for - the current one has already started, and may have readers that
+ * began before they were queued, so it is the next one.
+ */
+static unsigned long RequestGracePeriod()
+{
+	unsigned long gp;
+
+	SpinLock(&rcuState.lock);
+
+	if(rcuState.gpCompleted == rcuState.gpNumber)
+	{
+		StartGracePeriod();
+		gp = rcuState.gpNumber;
+	}
+	else
+	{
+		rcuState.gpRequested = true;
+		gp = rcuState.gpNumber + 1;
+	}
+
+	SpinUnlock(&rcuState.lock);
+
+	return (gp);
+}
+
+/*
+ * Reports that the cpu has passed a quiescent state in the given grace
+ * period, and ends the grace period if it was the last cpu.
+ */
+static void ReportQuiescent(Processor *cpu, unsigned long gp)
+{
+	unsigned long cpuId = cpu->hw.APICID;
+
+	SpinLock(&rcuState.lock);
+
+	if(gp == rcuState.gpNumber && gp != rcuState.gpCompleted &&
+			rcuState.gpPending.contains(cpuId))
+	{
+		rcuState.gpPending.remove(cpuId);
+
+		if(rcuState.gpPending.count() == 0)
+		{
+			rcuState.gpCompleted = gp;
+
+			if(rcuState.gpRequested)
+				StartGracePeriod();
+		}
+	}
+
+	SpinUnlock(&rcuState.lock);
+}
+
+/*
+ * Invokes the callbacks whose grace period has completed, on the cpu's
+ * worker-thread. Callbacks queued in b/w are picked up in the next round.
+ */
+static void InvokeCallbacks(void *cpuArg)
+{
+	RcuData *rcu = &((Processor*) cpuArg)->rcu;
+	RcuHead *head;
+
+	__irq_save_func(
+		head = rcu->doneList;
+		rcu->doneList = null;
+	)
+
+	while(head != null)
+	{
+		RcuHead *next = head->next;
+
+		head->callback(head);
+		head = next;
+	}
+}
+
+/* Adds a callback to the current cpu's batch, with interrupts disabled */
+static void Enqueue(RcuHead *head)
+{
+	RcuData *rcu = &GetProcessorById(PROCESSOR_ID)->rcu;
+
+	Splice(&rcu->nextList, &rcu->nextTail, head, &head->next);
+}
+
+/**
+ * Queues a callback to be invoked after a grace period, i.e. once all the
+ * read-side critical sections which may hold a reference to the object
+ * have exited. The callback runs on the worker-thread of the current cpu.
+ * It may be called from any context.
+ *
+ * @param head - the head embedded in the object
+ * @param callback - function to call after the grace period
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Executable::callRcu(RcuHead *head, RcuCallback callback)
+{
+	head->next = null;
+	head->callback = callback;
+
+	__irq_save_func(
+		Enqueue(head);
+	)
+}
+
+/*
+ * Grace period waited for by a task in synchronizeRcu(). The lock orders
+ * the callback's wakeup after the task has prepared to sleep.
+ */
+struct RcuSync
+{
+	RcuHead head;
+	Task *waiter;
+	Spinlock lock;
+	volatile bool done;
+};
+
+static void FinishSync(RcuHead *head)
+{
+	RcuSync *sync = (RcuSync*) head;
+
+	/* The waiter's stack holds the sync, so it isn't touched after this */
+	__irq_save_func(
+		SpinLock(&sync->lock);
+		sync->done = true;
+		sync->waiter->wakeup();
+		SpinUnlock(&sync->lock);
+	)
+}
+
+/**
+ * Waits for a grace period to elapse, after which no reader holds a
+ * reference to data unpublished before the call. Must be called in task
+ * context, and not from an RCU callback (as the callback which ends the
+ * wait may be queued behind it).
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Executable::synchronizeRcu()
+{
+	RcuSync sync;
+
+	sync.waiter = GetProcessorById(PROCESSOR_ID)->ctask;
+	sync.lock = 0;
+	sync.done = false;
+
+	callRcu(&sync.head, &FinishSync);
+
+	while(true)
+	{
+		__cli
+		SpinLock(&sync.lock);
+
+		if(sync.done)
+			break;
+
+		sync.waiter->prepareWait(null, WAIT_FOREVER);
+		SpinUnlock(&sync.lock);
+		sync.waiter->commitWait();
+	}
+
+	SpinUnlock(&sync.lock);
+	__sti
+}
+
+/**
+ * Notes that the current cpu is in a quiescent state - no read-side
+ * critical section is running on it. Called by the scheduler and the idle
+ * loop, with interrupts disabled.
+ *
+ * The callbacks of the cpu are advanced here too - completed ones are
+ * handed to the worker-thread, and new ones start waiting for a grace
+ * period, if the previous batch isn't still waiting.
+ *
+ * @param cpu - the current cpu
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Executable::RcuQuiescent(Processor *cpu)
+{
+	RcuData *rcu = &cpu->rcu;
+
+	if(rcu->waitList != null &&
+			(long) (rcuState.gpCompleted - rcu->waitGp) >= 0)
+	{
+		Splice(&rcu->doneList, &rcu->doneTail, rcu->waitList,
+				rcu->waitTail);
+		rcu->waitList = null;
+	}
+
+	if(rcu->waitList == null && rcu->nextList != null)
+	{
+		rcu->waitList = rcu->nextList;
+		rcu->waitTail = rcu->nextTail;
+		rcu->nextList = null;
+		rcu->waitGp = RequestGracePeriod();
+	}
+
+	/* This cpu is quiescent in any grace period that has started by now */
+	unsigned long gp = rcuState.gpNumber;
+
+	if(gp != rcu->gpSeen)
+	{
+		rcu->gpSeen = gp;
+		ReportQuiescent(cpu, gp);
+	}
+
+	if(rcu->doneList != null)
+	{
+		if(rcu->work.function == null)
+			rcu->work.init(&InvokeCallbacks, cpu);
+
+		WorkQueue::queueWork(cpu, &rcu->work);
+	}
+}
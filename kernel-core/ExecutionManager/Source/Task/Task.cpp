@@ -20,13 +20,593 @@
  *
  * Copyright (C) 2017 - Shukant Pal
  */
+#include <Executable/ScheduleRoller.h>
+#include <Executable/Scheduler.h>
 #include <Executable/Task.hpp>
+#include <Executable/Tickless.hpp>
+#include <Executable/WaitQueue.hpp>
+#include <HardwareAbstraction/LocalTimer.hpp>
+#include <HardwareAbstraction/Processor.h>
 
 #include "../../../Interface/Utils/AVLTree.hpp"
 
+using namespace HAL;
 using namespace Executable;
 
+static inline Task *TaskOfTimeout(AVLNode *node)
+{
+	return ((Task*) ((unsigned long) node -
+			(unsigned long) &((Task*) 0)->timeoutNode));
+}
+
+/*
+ * Inserts the task in the timeout-tree of the current cpu, to be woken up
+ * at the given time. As tree-keys (the low 32-bits of the wakeup-time)
+ * must be unique, the task is delayed by a ms for each key taken.
+ */
+static void ArmTimeout(Task *task, Processor *cpu, Time wakeupTime)
+{
+	task->wakeupTime = wakeupTime;
+	task->left = NULL;
+	task->right = NULL;
+	task->timeoutHeight = 0;
+
+	while(AVLInsert(&task->timeoutNode, &cpu->timeoutTree) == NODE_FOUND)
+		++(task->wakeupTime);
+
+	RequestTickAt(cpu, task->wakeupTime);
+}
+
+/*
+ * Hands a runnable task, which isn't on any runqueue, over to the given cpu
+ * through its wake-list. The task is requeued when that cpu next runs its
+ * scheduler (or its IPI handler).
+ */
+static void HandOver(Task *task, Processor *target)
+{
+	ScheduleInfo *tsched = &target->crolStatus;
+
+	task->cpu = target;
+
+	SpinLock(&tsched->wakeLock);
+	task->waitNext = tsched->wakeList;
+	tsched->wakeList = task;
+	SpinUnlock(&tsched->wakeLock);
+
+	CPUDriver::wakeup(target);
+}
+
+/*
+ * Picks the online cpu, allowed by the task's affinity, whose runqueue for
+ * the task's class is the least loaded. The current cpu is given if the
+ * affinity holds no online cpu.
+ */
+static Processor *PickAllowedCpu(Task *task)
+{
+	if(task->pinnedCpu != CPU_UNPINNED &&
+			onlineCpus.contains(task->pinnedCpu))
+		return (GetProcessorById(task->pinnedCpu));
+
+	Processor *best = GetProcessorById(PROCESSOR_ID), *cand;
+	unsigned long bestLoad = ~0UL;
+
+	for(unsigned long cpuId = task->affinity.first(); cpuId < CPUSET_MAX;
+			cpuId = task->affinity.next(cpuId))
+	{
+		if(!onlineCpus.contains(cpuId))
+			continue;
+
+		cand = GetProcessorById(cpuId);
+
+		if(cand->lschedTable[task->schedClass]->getLoad() < bestLoad)
+		{
+			best = cand;
+			bestLoad = cand->lschedTable[task->schedClass]->getLoad();
+		}
+	}
+
+	return (best);
+}
+
+/*
+ * Puts a woken task back on the runqueue of its class, on the current cpu
+ * (which must be the one it slept on). Its class-parameters are kept, as
+ * the rollers take it in like a migrating task. If the task's affinity was
+ * changed while it slept, it is handed over to an allowed cpu instead.
+ */
+static void Requeue(Task *task, Processor *cpu)
+{
+	if(task->wakeupTime != 0)
+	{
+		AVLDelete(task->timeoutNode.sortValue, &cpu->timeoutTree);
+		task->wakeupTime = 0;
+	}
+
+	if(!task->allowedOn(cpu->hw.APICID))
+	{
+		Processor *target = PickAllowedCpu(task);
+
+		if(target != cpu)
+		{
+			HandOver(task, target);
+			return;
+		}
+	}
+
+	task->loadAvg.update(XMilliTime, false, 0);
+	task->next = task;
+	task->last = task;
+
+	cpu->lschedTable[task->schedClass]->recieve(task, task, 1, 1);
+}
+
+/**
+ * Makes the given task runnable, if it is sleeping. The task is requeued
+ * directly if it slept on the current cpu; otherwise, it is handed over to
+ * its cpu through the wake-list, as that cpu may still be running on the
+ * task's stack.
+ *
+ * Interrupts must be disabled by the caller.
+ *
+ * @param task - the task to wake up
+ * @param timedOut - whether the task's timeout has expired
+ * @return - whether the task was woken up by this call
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool Executable::WakeupTask(Task *task, bool timedOut)
+{
+	if(!__sync_bool_compare_and_swap(&task->state, SleepInterruptible,
+			Runnable))
+		return (false);
+
+	task->timedOut = timedOut;
+
+	if(task->waitQueue != null)
+		task->waitQueue->unlink(task);
+
+	Processor *target = task->cpu;
+
+	if(target == GetProcessorById(PROCESSOR_ID))
+	{
+		Requeue(task, target);
+		target->crolStatus.needResched = 1;
+		LocalTimer::kick(target);
+	}
+	else
+	{
+		HandOver(task, target);
+	}
+
+	return (true);
+}
+
+/**
+ * Requeues the tasks which were woken up on other cpus, after having slept
+ * on the given one. Called by the scheduler and the IPI handler of the
+ * cpu, with interrupts disabled.
+ *
+ * @param cpu - the current cpu
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Executable::FlushWakeups(Processor *cpu)
+{
+	ScheduleInfo *tsched = &cpu->crolStatus;
+	Task *task, *nextTask;
+
+	if(tsched->wakeList == null)
+		return;
+
+	SpinLock(&tsched->wakeLock);
+	task = tsched->wakeList;
+	tsched->wakeList = null;
+	SpinUnlock(&tsched->wakeLock);
+
+	while(task != null)
+	{
+		nextTask = task->waitNext;
+		Requeue(task, cpu);
+		task = nextTask;
+	}
+}
+
+/**
+ * Moves tasks which aren't allowed to run on the given cpu (after their
+ * affinity was changed) off it. The current task is taken off its runqueue
+ * and held on the leave-list, as its stack is in use until the scheduler
+ * switches away from it; the tasks held back by the last run are handed
+ * over to allowed cpus. Queued tasks are not searched for, and are moved
+ * after they next run.
+ *
+ * Called by the scheduler, with interrupts disabled, before it picks the
+ * next task.
+ *
+ * @param cpu - the current cpu
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Executable::EnforceAffinity(Processor *cpu)
+{
+	ScheduleInfo *tsched = &cpu->crolStatus;
+	Task *task = tsched->leaveList, *nextTask;
+
+	tsched->leaveList = null;
+
+	while(task != null)
+	{
+		nextTask = task->waitNext;
+		HandOver(task, PickAllowedCpu(task));
+		task = nextTask;
+	}
+
+	task = cpu->ctask;
+
+	if(task == null || task == (Task*) cpu->IdlerThread ||
+			task->state != Runnable ||
+			task->allowedOn(cpu->hw.APICID) ||
+			PickAllowedCpu(task) == cpu)
+		return;
+
+	cpu->lschedTable[task->schedClass]->remove(task);
+
+	task->waitNext = null;
+	tsched->leaveList = task;
+	RequestTickAt(cpu, XMilliTime + 1);
+}
+
+/*
+ * Puts the task on the move-list of the given cpu, and makes that cpu run
+ * its scheduler. Called with the task's pi-lock held.
+ */
+static void ListMove(Task *task, Processor *cpu)
+{
+	ScheduleInfo *tsched = &cpu->crolStatus;
+
+	SpinLock(&tsched->moveLock);
+	task->piMoveNext = tsched->moveList;
+	tsched->moveList = task;
+	SpinUnlock(&tsched->moveLock);
+
+	if(cpu == GetProcessorById(PROCESSOR_ID))
+	{
+		tsched->needResched = 1;
+		LocalTimer::kick(cpu);
+	}
+	else
+	{
+		CPUDriver::wakeup(cpu);
+	}
+}
+
+/*
+ * Switches the task's class-parameters to those of the class it is moving
+ * into. Its own parameters are saved as it leaves its own class (piClass),
+ * and put back as it returns.
+ */
+static void SwapClassParams(Task *task)
+{
+	const unsigned long *params = (task->piMoveClass == task->piClass) ?
+			task->piParams : task->piMoveParams;
+
+	if(task->schedClass == task->piClass)
+		for(unsigned long idx = 0; idx < SCHED_PARAMS; idx++)
+			task->piParams[idx] = task->schedParams[idx];
+
+	for(unsigned long idx = 0; idx < SCHED_PARAMS; idx++)
+		task->schedParams[idx] = params[idx];
+
+	task->schedClass = task->piMoveClass;
+}
+
+/**
+ * Moves the task into another scheduling class, as it inherits the priority
+ * of a waiter in that class, or back into its own class (piClass). As only
+ * its cpu can take it off the runqueue, the move is done by that cpu's
+ * scheduler; a request replaces the one still pending, if any.
+ *
+ * Called with the task's pi-lock held, and interrupts disabled.
+ *
+ * @param task - the task to move
+ * @param cls - the class to move into
+ * @param params - class-parameters to take in that class; not used when
+ * 			the task returns to its own class.
+ * @param urgency - urgency to be set in that class, after the move
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Executable::ChangeClass(Task *task, unsigned long cls,
+		const unsigned long *params, unsigned long urgency)
+{
+	task->piMoveClass = cls;
+	task->piMoveUrgency = urgency;
+
+	if(cls != task->piClass)
+		for(unsigned long idx = 0; idx < SCHED_PARAMS; idx++)
+			task->piMoveParams[idx] = params[idx];
+
+	if(!task->piMoving)
+	{
+		task->piMoving = true;
+		ListMove(task, task->cpu);
+	}
+}
+
+/**
+ * Does the class-changes requested for tasks on the given cpu. A runnable
+ * task is taken off the runqueue of its old class, and put on that of the
+ * new one; a sleeping task only takes its new class, which it is queued in
+ * when woken up. A task which isn't on this cpu's runqueues (being stolen,
+ * or woken up elsewhere) is passed on to its new cpu, or tried again at the
+ * next tick.
+ *
+ * Called by the scheduler, with interrupts disabled, before it picks the
+ * next task.
+ *
+ * @param cpu - the current cpu
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Executable::FlushClassChanges(Processor *cpu)
+{
+	ScheduleInfo *tsched = &cpu->crolStatus;
+	Task *task, *nextTask;
+	bool retry = false;
+
+	if(tsched->moveList == null)
+		return;
+
+	SpinLock(&tsched->moveLock);
+	task = tsched->moveList;
+	tsched->moveList = null;
+	SpinUnlock(&tsched->moveLock);
+
+	while(task != null)
+	{
+		nextTask = task->piMoveNext;
+		SpinLock(&task->piLock);
+
+		if(task->cpu != cpu)
+		{
+			ListMove(task, task->cpu);
+		}
+		else if(task->state == SleepInterruptible)
+		{
+			SwapClassParams(task);
+			cpu->lschedTable[task->schedClass]->setUrgency(task,
+					task->piMoveUrgency);
+			task->piMoving = false;
+		}
+		else if(cpu->lschedTable[task->schedClass]->remove(task))
+		{
+			SwapClassParams(task);
+			task->next = task;
+			task->last = task;
+			cpu->lschedTable[task->schedClass]->recieve(task, task, 1, 1);
+			cpu->lschedTable[task->schedClass]->setUrgency(task,
+					task->piMoveUrgency);
+			task->piMoving = false;
+		}
+		else
+		{
+			SpinLock(&tsched->moveLock);
+			task->piMoveNext = tsched->moveList;
+			tsched->moveList = task;
+			SpinUnlock(&tsched->moveLock);
+			retry = true;
+		}
+
+		SpinUnlock(&task->piLock);
+		task = nextTask;
+	}
+
+	if(retry)
+		RequestTickAt(cpu, XMilliTime + 1);
+}
+
+/**
+ * Wakes up the tasks whose timed sleeps have expired on the given cpu, and
+ * requests the scheduler to run when the next one expires. Called by the
+ * scheduler, with interrupts disabled.
+ *
+ * @param cpu - the current cpu
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+export_asm void WakeupExpiredWaiters(Processor *cpu)
+{
+	AVLNode *node;
+	Task *task;
+
+	while((node = MinValueNode(cpu->timeoutTree.treeRoot)) != NULL)
+	{
+		task = TaskOfTimeout(node);
+
+		if(task->wakeupTime > XMilliTime)
+		{
+			RequestTickAt(cpu, task->wakeupTime);
+			break;
+		}
+
+		AVLDelete(node->sortValue, &cpu->timeoutTree);
+		task->wakeupTime = 0;
+
+		WakeupTask(task, true);
+	}
+}
+
+/**
+ * Puts the current task to sleep, optionally on a wait-queue, until it is
+ * woken up or its timeout expires. The task is put on the queue (and its
+ * timeout armed) before it leaves its runqueue, so that it can't miss a
+ * wakeup; then, it switches away at once.
+ *
+ * Must be called on the current task.
+ *
+ * @param queue - the wait-queue to sleep on; null, if the task is only
+ * 			woken up explicitly or by its timeout.
+ * @param timeout - time (in ms) after which the task is woken up, or
+ * 			WAIT_FOREVER.
+ * @return - true, if woken up; false, if the timeout expired
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool Task::wait(WaitQueue *queue, Time timeout)
+{
+	__cli
+	prepareWait(queue, timeout);
+	return (commitWait());
+}
+
+/**
+ * Marks the current task as sleeping, and puts it on the wait-queue (and
+ * arms its timeout), without leaving its runqueue. From here on, a wakeup
+ * isn't lost - it only makes commitWait() return at once. This lets the
+ * caller register the task as a waiter under its own lock, and release it
+ * before the task actually sleeps.
+ *
+ * Interrupts must be disabled by the caller, and stay disabled until
+ * commitWait() is called.
+ *
+ * @param queue - the wait-queue to sleep on; null, if the task is only
+ * 			woken up explicitly or by its timeout.
+ * @param timeout - time (in ms) after which the task is woken up, or
+ * 			WAIT_FOREVER.
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Task::prepareWait(WaitQueue *queue, Time timeout)
+{
+	timedOut = false;
+	waitQueue = null;
+	wakeupTime = 0;
+	state = SleepInterruptible;
+
+	if(queue != null)
+		queue->add(this);
+
+	if(timeout != WAIT_FOREVER)
+		ArmTimeout(this, GetProcessorById(PROCESSOR_ID),
+				getSystemTime() + timeout);
+}
+
+/**
+ * Takes the current task, prepared by prepareWait(), off its runqueue and
+ * switches away from it, through the scheduler, until it is woken up.
+ * Interrupts are enabled on return.
+ *
+ * @return - true, if woken up; false, if the timeout expired
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool Task::commitWait()
+{
+	Processor *host = GetProcessorById(PROCESSOR_ID);
+
+	host->lschedTable[schedClass]->remove(this);
+
+	__cli
+	while(state == SleepInterruptible)
+	{
+		KiYield();
+		__cli
+	}
+	__sti
+
+	return (!timedOut);
+}
+
+/**
+ * Puts the current task to sleep for the given time, unless it is woken
+ * up explicitly before that.
+ *
+ * @param waitPeriod - time (in ms) to sleep for
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
 void Task::sleep(Time waitPeriod)
 {
+	if(waitPeriod != 0)
+		wait(null, waitPeriod);
+}
 
+/**
+ * Wakes up the task, if it is sleeping.
+ *
+ * @return - whether the task was sleeping
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool Task::wakeup()
+{
+	bool woken;
+
+	__cli
+	woken = WakeupTask(this, false);
+	__sti
+
+	return (woken);
+}
+
+/**
+ * Restricts the task to the given cpus. If the task is running, or is
+ * runnable, on a cpu which isn't allowed anymore, that cpu is made to
+ * reschedule, so that the task is moved off when it is switched out. A
+ * sleeping task is moved when it is woken up.
+ *
+ * @param cpus - cpus on which the task is allowed to run
+ * @return - false, if none of the cpus given is online; the affinity is
+ * 			not changed then.
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool Task::setAffinity(const CpuSet& cpus)
+{
+	if(!cpus.intersects(onlineCpus))
+		return (false);
+
+	__cli
+	pinnedCpu = CPU_UNPINNED;
+	affinity = cpus;
+
+	if(cpus.count() == 1)
+		pinnedCpu = cpus.first();
+
+	Processor *host = cpu;
+
+	if(host != null && state == Runnable && !allowedOn(host->hw.APICID))
+	{
+		CPUDriver::wakeup(host);
+
+		if(host == GetProcessorById(PROCESSOR_ID))
+			LocalTimer::kick(host);
+	}
+	__sti
+
+	return (true);
+}
+
+/**
+ * Gives the cpus on which the task is allowed to run.
+ *
+ * @param cpus - set to be filled
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Task::getAffinity(CpuSet& cpus)
+{
+	cpus = affinity;
 }
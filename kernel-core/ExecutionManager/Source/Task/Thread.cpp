@@ -18,6 +18,7 @@
 #include <Memory/Address.h>
 #include <Memory/Pager.h>
 #include <Memory/KMemorySpace.h>
+#include <Memory/KernelStack.hpp>
 #include <Memory/KMemoryManager.h>
 #include <Memory/KObjectManager.h>
 #include <KernelRoutine/Init.h>
@@ -48,6 +49,27 @@ void KiThreadConstruct(void *kthreadPtr)
 	thread->Gate.userStack = &thread->UserStack;
 	thread->Gate.kernelStack = &thread->KernelStack;
 	thread->Gate.run = NULL;
+	thread->Gate.fpuState = NULL;
+	thread->Gate.fpuCpu = NULL;
+	thread->Gate.affinity.fill();
+	thread->Gate.pinnedCpu = CPU_UNPINNED;
+	thread->Gate.blockedOn = NULL;
+	thread->Gate.piHeld = NULL;
+	thread->Gate.piLock = 0;
+	thread->Gate.piBase = 0;
+	thread->Gate.piBoosted = false;
+	thread->Gate.piMoving = false;
+	thread->Gate.piMoveNext = NULL;
+}
+
+/*
+ * Binds a per-cpu thread to its cpu, before it is put on a runqueue.
+ */
+static void PinThread(Thread *thread, unsigned long cpuId)
+{
+	thread->Gate.affinity.clear();
+	thread->Gate.affinity.add(cpuId);
+	thread->Gate.pinnedCpu = cpuId;
 }
 
 char *msgInitThread = "Setting up kInitThread...";
@@ -84,18 +106,52 @@ void InitTTable(void)
 	cpu->ctask = (Executable::Task*) kIdlerThread;
 	kIdlerThread->Gate.next = (Executable::Task*) kInitThread;
 
+	/*
+	 * The boot context becomes the idler thread, and starts in Idle()
+	 * when first dispatched (on the stack saved when it is switched out).
+	 */
+	kIdlerThread->Gate.taskFlags = (1 << 0) | (1 << 1);
+	kIdlerThread->Gate.eip = (void*) &Idle;
+	kIdlerThread->Gate.mmu = NULL;
+	cpu->IdlerThread = kIdlerThread;
+	cpu->SetupThread = kInitThread;
+	PinThread(kIdlerThread, PROCESSOR_ID);
+
 	KSCHEDINFO *bspSched = &cpu->crolStatus;
-	bspSched->CurrentQuanta = 10;
-	bspSched->LeftQuanta = 10;
+	bspSched->CurrentQuanta = 1;
+	bspSched->LeftQuanta = 0;
 
 	cpu->lschedTable[0]->add((Executable::Task*) kInitThread);
 }
 
+/**
+ * Runs on each cpu when it has no runnable task. The cpu sleeps (using
+ * MWAIT on its need-resched flag, if possible) until it is woken by an
+ * interrupt or another cpu; if it was woken to reschedule, the local
+ * timer is fired at once, instead of waiting for the next tick.
+ *
+ * @version 2.0
+ * @since Circuit 2.03
+ * @author Shukant Pal
+ */
 void Idle()
 {
-	DbgLine("SMP:: AP::IDLE");
-	while (TRUE)
-		;
+	Processor *cpu = GetProcessorById(PROCESSOR_ID);
+
+	while (TRUE) {
+		/* Nothing runs here, so the cpu needn't hold up grace periods */
+		__cli
+		RcuQuiescent(cpu);
+		__sti
+
+		CPUDriver::idle(&cpu->crolStatus.needResched);
+
+		if (cpu->crolStatus.needResched && oneShotTimerEnabled) {
+			__cli
+			LocalTimer::fireAt(cpu, 0);
+			__sti
+		}
+	}
 }
 
 void APThreadMain()
@@ -104,17 +160,25 @@ void APThreadMain()
 	DbgInt(PROCESSOR_ID);
 	DbgLine(" ");
 
-	while (TRUE) {
-		asm volatile("nop");
-	};
+	Idle();
 }
 
-#include <Executable/RunqueueBalancer.hpp>
+/**
+ * Initialization thread of application processors. It has nothing to do
+ * after the cpu is set up, and so leaves the runqueue for the idle task.
+ *
+ * @version 2.0
+ * @since Circuit 2.03
+ * @author Shukant Pal
+ */
 void APInitService()
 {
-	while (TRUE) {
-		asm volatile("nop");
-	};
+	Processor *cpu = GetProcessorById(PROCESSOR_ID);
+
+	cpu->lschedTable[ROUND_ROBIN]->remove(cpu->ctask);
+	cpu->crolStatus.needResched = 1;
+
+	Idle();// only until the scheduler switches to the idler thread
 }
 
 void SetupRunqueue()
@@ -135,6 +199,10 @@ void SetupRunqueue()
 	setupThread->Status = Thread_Runnable;
 	setupThread->ParentID = (ID) NULL;
 
+	idlerThread->Gate.taskFlags = (1 << 0) | (1 << 1);
+	idlerThread->Gate.eip = (void*) &Idle;
+	idlerThread->Gate.mmu = NULL;
+
 	CPUStack *idlerStack = &(idlerThread->KernelStack);
 	idlerStack->base = ap->ProcessorStack;
 	idlerStack->pointer = ap->ProcessorStack - 64;
@@ -148,18 +216,25 @@ void SetupRunqueue()
 	DbgLine("--t");
 
 	ap->ctask = (Executable::Task*) idlerThread;
+	ap->IdlerThread = idlerThread;
+	ap->SetupThread = setupThread;
+	PinThread(idlerThread, PROCESSOR_ID);
+	PinThread(setupThread, PROCESSOR_ID);
 	idlerThread->Gate.next = (Executable::Task*) setupThread;
 
 	KSCHEDINFO *apSched = &ap->crolStatus;
-	apSched->CurrentQuanta = 10;
-	apSched->LeftQuanta = 10;
+	apSched->CurrentQuanta = 1;
+	apSched->LeftQuanta = 0;
 
 	ap->lschedTable[0]->add((Executable::Task*) setupThread);
 }
 
-Thread *KThreadCreate(void *entry)
+/*
+ * Allocates a kernel thread, with its kernel-stack, which starts at the
+ * given entry. It isn't put on any runqueue.
+ */
+static Thread *NewThread(void *entry)
 {
-	Processor *currentProcessor = GetProcessorById(PROCESSOR_ID);
 	Thread *newThread = (Thread*) KNew(tdInfo, KM_SLEEP);
 	newThread->Gate.taskFlags = (1 << 0) | (1 << 1);
 	newThread->Gate.eip = entry;
@@ -169,16 +244,51 @@ Thread *KThreadCreate(void *entry)
 	newThread->ParentID = (NULL);
 
 	CPUStack *threadStack = &(newThread->KernelStack);
-	unsigned long stackAddress = KiPagesAllocate(3, ZONE_KMODULE, FLG_ATOMIC);
-	threadStack->base = stackAddress + 8 * KPGSIZE - 4;
-	threadStack->pointer = stackAddress + 8 * KPGSIZE - 64;
-
-	unsigned long offset = 0;
-	while (offset < 8) {
-		Pager::use(stackAddress + offset * KPGSIZE, FLG_ATOMIC, KernelData);
-		++offset;
+	unsigned long stackAddress = Memory::KernelStack::allocate();
+
+	if(stackAddress == 0) {
+		KDelete(newThread, tdInfo);
+		return (NULL);
+	}
+
+	threadStack->base = stackAddress + KSTACK_SIZE - 4;
+	threadStack->pointer = stackAddress + KSTACK_SIZE - 64;
+
+	return (newThread);
+}
+
+Thread *KThreadCreate(void *entry, ScheduleClass cls)
+{
+	Processor *currentProcessor = GetProcessorById(PROCESSOR_ID);
+	Thread *newThread = NewThread(entry);
+
+	if(newThread != NULL)
+		currentProcessor->lschedTable[cls]->add((Executable::Task*) newThread);
+
+	return (newThread);
+}
+
+/**
+ * Creates a kernel thread which is bound to the current cpu, like its idle
+ * task. It is pinned before it is put on the runqueue, so that it can't be
+ * balanced off the cpu in b/w.
+ *
+ * @param entry - function at which the thread starts
+ * @param cls - scheduling class of the thread
+ * @return - the new thread; null, if no kernel-stack was left
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+Thread *KCpuThreadCreate(void *entry, ScheduleClass cls)
+{
+	Processor *currentProcessor = GetProcessorById(PROCESSOR_ID);
+	Thread *newThread = NewThread(entry);
+
+	if(newThread != NULL) {
+		PinThread(newThread, PROCESSOR_ID);
+		currentProcessor->lschedTable[cls]->add((Executable::Task*) newThread);
 	}
 
-	currentProcessor->lschedTable[0]->add((Executable::Task*) newThread);
 	return (newThread);
 }
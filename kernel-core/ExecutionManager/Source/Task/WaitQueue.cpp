@@ -0,0 +1,186 @@
+/**
+ * File: WaitQueue.cpp
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <Executable/WaitQueue.hpp>
+#include <HardwareAbstraction/Processor.h>
+#include <KERNEL.h>
+
+using namespace HAL;
+using namespace Executable;
+
+static inline Task *CurrentTask()
+{
+	Task *task;
+
+	__cli
+	task = GetProcessorById(PROCESSOR_ID)->ctask;
+	__sti
+
+	return (task);
+}
+
+WaitQueue::WaitQueue()
+{
+	this->head = null;
+	this->tail = null;
+	this->count = 0;
+	this->lock = 0;
+}
+
+/**
+ * Puts the current task to sleep on this queue, until it is woken up.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void WaitQueue::sleepOn()
+{
+	CurrentTask()->wait(this, WAIT_FOREVER);
+}
+
+/**
+ * Puts the current task to sleep on this queue, until it is woken up or
+ * the timeout expires.
+ *
+ * @param timeout - time (in ms) after which the task wakes up anyway
+ * @return - true, if woken up; false, if the timeout expired
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool WaitQueue::sleepOn(Time timeout)
+{
+	return (CurrentTask()->wait(this, timeout));
+}
+
+/**
+ * Wakes up the task which has been sleeping on this queue the longest.
+ * Tasks whose timeouts are expiring at the same time are skipped.
+ *
+ * @return - the task woken up; null, if no task was waiting
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+Task *WaitQueue::wakeOne()
+{
+	Task *task;
+
+	__cli
+	SpinLock(&lock);
+
+	while((task = head) != null)
+	{
+		detach(task);
+
+		if(WakeupTask(task, false))
+			break;
+	}
+
+	SpinUnlock(&lock);
+	__sti
+
+	return (task);
+}
+
+/**
+ * Wakes up all tasks sleeping on this queue.
+ *
+ * @return - the no. of tasks woken up
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+unsigned long WaitQueue::wakeAll()
+{
+	Task *task;
+	unsigned long woken = 0;
+
+	__cli
+	SpinLock(&lock);
+
+	while((task = head) != null)
+	{
+		detach(task);
+
+		if(WakeupTask(task, false))
+			++(woken);
+	}
+
+	SpinUnlock(&lock);
+	__sti
+
+	return (woken);
+}
+
+/*
+ * Appends the task at the tail of this queue. Interrupts must be disabled
+ * by the caller.
+ */
+void WaitQueue::add(Task *task)
+{
+	SpinLock(&lock);
+
+	task->waitQueue = this;
+	task->waitNext = null;
+	task->waitLast = tail;
+
+	if(tail != null)
+		tail->waitNext = task;
+	else
+		head = task;
+
+	tail = task;
+	++(count);
+
+	SpinUnlock(&lock);
+}
+
+/*
+ * Takes the task off this queue, with the lock held.
+ */
+void WaitQueue::detach(Task *task)
+{
+	if(task->waitLast != null)
+		task->waitLast->waitNext = task->waitNext;
+	else
+		head = task->waitNext;
+
+	if(task->waitNext != null)
+		task->waitNext->waitLast = task->waitLast;
+	else
+		tail = task->waitLast;
+
+	task->waitQueue = null;
+	--(count);
+}
+
+/*
+ * Takes the task off this queue, if it is still on it. Used when the task
+ * is woken up without the queue, i.e. by its timeout.
+ */
+void WaitQueue::unlink(Task *task)
+{
+	SpinLock(&lock);
+
+	if(task->waitQueue == this)
+		detach(task);
+
+	SpinUnlock(&lock);
+}
@@ -0,0 +1,496 @@
+/**
+ * @file WorkQueue.cpp
+ *
+ * Implements the per-cpu work-queues and their worker-threads.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <Executable/Scheduler.h>
+#include <Executable/Thread.h>
+#include <Executable/Tickless.hpp>
+#include <Executable/WorkQueue.hpp>
+#include <HardwareAbstraction/Processor.h>
+#include <Memory/KObjectManager.h>
+#include <KERNEL.h>
+
+using namespace HAL;
+using namespace Executable;
+
+static ObjectInfo *tWork = NULL;
+
+/* Queued by flushAll(), behind the work pending at that time */
+static void Barrier(void *)
+{
+}
+
+WorkQueue::WorkQueue()
+{
+	this->head = null;
+	this->tail = null;
+	this->delayed = null;
+	this->current = null;
+	this->worker = null;
+	this->lock = 0;
+}
+
+/**
+ * Queues the given work on the cpu, to be run by its worker-thread after
+ * the work already pending there. The work is not queued again if it is
+ * already pending (or delayed), on any cpu.
+ *
+ * @param cpu - the cpu on which the work should run
+ * @param work - the work to queue
+ * @return - whether the work was queued by this call
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool WorkQueue::queueWork(Processor *cpu, Work *work)
+{
+	return (queueOn(&cpu->workQueue, cpu, work));
+}
+
+/**
+ * Queues the given work on the interrupt work-queue of the cpu, whose
+ * real-time worker runs it before other tasks. It is meant for the bottom
+ * halves of interrupt handlers.
+ *
+ * @param cpu - the cpu on which the work should run
+ * @param work - the work to queue
+ * @return - whether the work was queued by this call
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool WorkQueue::queueIRQWork(Processor *cpu, Work *work)
+{
+	return (queueOn(&cpu->irqWorkQueue, cpu, work));
+}
+
+/**
+ * Queues a call to the given function on the cpu. The work-item is
+ * allocated without sleeping, and so this may be called from interrupt
+ * handlers; it is freed after the function returns.
+ *
+ * @param cpu - the cpu on which the function should be called
+ * @param function - the function to call
+ * @param argument - argument for the function
+ * @return - whether the call was queued; false, if no memory was left
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool WorkQueue::queueWork(Processor *cpu, WorkFunction function,
+		void *argument)
+{
+	if(tWork == NULL)
+		return (false);
+
+	Work *work = (Work*) KNew(tWork, KM_NOSLEEP);
+
+	if(work == NULL)
+		return (false);
+
+	work->init(function, argument);
+	work->flags = WORK_AUTOFREE;
+
+	return (queueWork(cpu, work));
+}
+
+/**
+ * Queues the given work on the cpu after a delay. Until then, the work is
+ * held by the cpu, which expires it when it runs its scheduler (the tick
+ * for its fire-time is requested then).
+ *
+ * @param cpu - the cpu on which the work should run
+ * @param work - the work to queue
+ * @param delay - time (in ms) after which the work is queued
+ * @return - whether the work was delayed by this call; false, if it was
+ * 			already pending or delayed.
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool WorkQueue::queueDelayedWork(Processor *cpu, Work *work, Time delay)
+{
+	if(delay == 0)
+		return (queueWork(cpu, work));
+
+	WorkQueue *queue = &cpu->workQueue;
+	Time fireTime = getSystemTime() + delay;
+	bool queued = false;
+
+	__irq_save_func(
+		SpinLock(&queue->lock);
+
+		if(__sync_bool_compare_and_swap(&work->state, WORK_IDLE,
+				WORK_DELAYED))
+		{
+			work->queue = queue;
+			work->owner = queue;
+			work->fireTime = fireTime;
+
+			Work *prev = null;
+			Work *succ = queue->delayed;
+
+			while(succ != null && succ->fireTime <= work->fireTime)
+			{
+				prev = succ;
+				succ = succ->next;
+			}
+
+			work->last = prev;
+			work->next = succ;
+
+			if(prev != null)
+				prev->next = work;
+			else
+				queue->delayed = work;
+
+			if(succ != null)
+				succ->last = work;
+
+			queued = true;
+		}
+
+		SpinUnlock(&queue->lock);
+
+		if(queued && queue->delayed == work)
+		{
+			if(cpu == GetProcessorById(PROCESSOR_ID))
+				RequestTickAt(cpu, work->fireTime);
+			else
+				CPUDriver::wakeup(cpu);
+		}
+	)
+
+	return (queued);
+}
+
+/**
+ * Takes the given work off its queue, if it is pending or delayed. Work
+ * which has already started running is not waited for; flush() should be
+ * used for that.
+ *
+ * @param work - the work to cancel
+ * @return - whether the work was taken off its queue
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool WorkQueue::cancel(Work *work)
+{
+	WorkQueue *queue = work->owner;
+	bool cancelled = false;
+
+	if(queue == null)
+		return (false);
+
+	__irq_save_func(
+		SpinLock(&queue->lock);
+
+		if(work->owner == queue)
+		{
+			queue->unlink(work);
+			cancelled = true;
+		}
+
+		SpinUnlock(&queue->lock);
+	)
+
+	if(cancelled && queue->flushers.getCount() != 0)
+		queue->flushers.wakeAll();
+
+	return (cancelled);
+}
+
+/**
+ * Waits until the given work is neither queued nor running. Delayed work
+ * is waited for until it has run (or is cancelled). Must be called in task context, and not
+ * by work running on the same cpu.
+ *
+ * @param work - the work to wait for
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void WorkQueue::flush(Work *work)
+{
+	WorkQueue *queue;
+	Task *self;
+
+	while((queue = work->queue) != null)
+	{
+		__cli
+		self = GetProcessorById(PROCESSOR_ID)->ctask;
+
+		SpinLock(&queue->lock);
+
+		if(work->state == WORK_IDLE && queue->current != work)
+		{
+			SpinUnlock(&queue->lock);
+			__sti
+			return;
+		}
+
+		/*
+		 * The worker finishes the work under the lock, so it can't be
+		 * missed b/w the check and the sleep.
+		 */
+		self->prepareWait(&queue->flushers, WAIT_FOREVER);
+		SpinUnlock(&queue->lock);
+		self->commitWait();
+	}
+}
+
+/**
+ * Waits until all work pending on the given cpu has run. Delayed work,
+ * and work queued after this call, is not waited for.
+ *
+ * @param cpu - the cpu whose work-queue is to be flushed
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void WorkQueue::flushAll(Processor *cpu)
+{
+	Work barrier;
+
+	barrier.init(&Barrier, null);
+
+	if(queueWork(cpu, &barrier))
+		flush(&barrier);
+}
+
+/**
+ * Creates the type for work allocated by queueWork(). Called on the
+ * boot-strap cpu, before any worker-thread is started.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void WorkQueue::init()
+{
+	tWork = KiCreateType("Executable::Work", sizeof(Work),
+				sizeof(unsigned long), NULL, NULL);
+}
+
+/**
+ * Starts the worker-threads of the current cpu, which are bound to it. The
+ * worker of the interrupt work-queue is a real-time thread.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void WorkQueue::startWorker()
+{
+	Processor *cpu = GetProcessorById(PROCESSOR_ID);
+
+	cpu->workQueue.worker = (Task*) KCpuThreadCreate((void*) &run);
+	cpu->irqWorkQueue.worker = (Task*) KCpuThreadCreate((void*) &runIRQ,
+			REAL_TIME);
+}
+
+/**
+ * Queues the delayed work which has expired, wakes up the worker-thread if
+ * any work is pending, and requests a tick for the next delayed work. Called
+ * by the scheduler and the IPI handler of the cpu, with interrupts disabled.
+ *
+ * @param cpu - the current cpu
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void WorkQueue::poll(Processor *cpu)
+{
+	if(!hasWork())
+		return;
+
+	Time nextFire = 0;
+	bool pending;
+
+	SpinLock(&lock);
+
+	while(delayed != null && delayed->fireTime <= XMilliTime)
+	{
+		Work *work = delayed;
+
+		delayed = work->next;
+
+		if(delayed != null)
+			delayed->last = null;
+
+		work->state = WORK_PENDING;
+		enqueue(work);
+	}
+
+	if(delayed != null)
+		nextFire = delayed->fireTime;
+
+	pending = (head != null);
+
+	SpinUnlock(&lock);
+
+	if(nextFire != 0)
+		RequestTickAt(cpu, nextFire);
+
+	if(pending)
+		wakeWorker();
+}
+
+/*
+ * Appends the work at the tail of the pending list, with the lock held.
+ */
+void WorkQueue::enqueue(Work *work)
+{
+	work->next = null;
+	work->last = tail;
+
+	if(tail != null)
+		tail->next = work;
+	else
+		head = work;
+
+	tail = work;
+}
+
+/*
+ * Takes the pending or delayed work off this queue, with the lock held.
+ */
+void WorkQueue::unlink(Work *work)
+{
+	if(work->last != null)
+		work->last->next = work->next;
+	else if(work->state == WORK_DELAYED)
+		delayed = work->next;
+	else
+		head = work->next;
+
+	if(work->next != null)
+		work->next->last = work->last;
+	else if(work->state == WORK_PENDING)
+		tail = work->last;
+
+	work->owner = null;
+	work->state = WORK_IDLE;
+}
+
+/*
+ * Wakes up the worker-thread, which must be on the current cpu. Interrupts
+ * must be disabled by the caller.
+ */
+bool WorkQueue::wakeWorker()
+{
+	return (worker != null && WakeupTask(worker, false));
+}
+
+/*
+ * Queues the work on the given queue of the cpu, and wakes up its worker.
+ */
+bool WorkQueue::queueOn(WorkQueue *queue, Processor *cpu, Work *work)
+{
+	bool queued = false;
+
+	__irq_save_func(
+		SpinLock(&queue->lock);
+
+		if(__sync_bool_compare_and_swap(&work->state, WORK_IDLE,
+				WORK_PENDING))
+		{
+			work->queue = queue;
+			work->owner = queue;
+			queue->enqueue(work);
+			queued = true;
+		}
+
+		SpinUnlock(&queue->lock);
+
+		if(queued)
+		{
+			if(cpu == GetProcessorById(PROCESSOR_ID))
+				queue->wakeWorker();
+			else
+				CPUDriver::wakeup(cpu);
+		}
+	)
+
+	return (queued);
+}
+
+/*
+ * Runs the work on the given queue, forever. The work is taken off the
+ * queue before it runs, so that it can be queued again by its function.
+ */
+void WorkQueue::drain(WorkQueue *queue)
+{
+	Processor *cpu = GetProcessorById(PROCESSOR_ID);
+	Task *self;
+	Work *work;
+
+	while(TRUE)
+	{
+		__cli
+		self = cpu->ctask;
+
+		SpinLock(&queue->lock);
+
+		if((work = queue->head) != null)
+		{
+			queue->unlink(work);
+			queue->current = work;
+		}
+
+		SpinUnlock(&queue->lock);
+
+		if(work == null)
+		{
+			self->wait(null, WAIT_FOREVER);
+			continue;
+		}
+		__sti
+
+		bool autoFree = (work->flags & WORK_AUTOFREE);
+
+		work->function(work->argument);
+
+		if(autoFree)
+			KDelete(work, tWork);
+
+		__cli
+		SpinLock(&queue->lock);
+		queue->current = null;
+		SpinUnlock(&queue->lock);
+		__sti
+
+		if(queue->flushers.getCount() != 0)
+			queue->flushers.wakeAll();
+	}
+}
+
+/*
+ * Entries of the worker-threads
+ */
+void WorkQueue::run()
+{
+	drain(&GetProcessorById(PROCESSOR_ID)->workQueue);
+}
+
+void WorkQueue::runIRQ()
+{
+	drain(&GetProcessorById(PROCESSOR_ID)->irqWorkQueue);
+}
@@ -13,6 +13,8 @@
 
 #define NAMESPACE_IA32_IDT
 
+#include <Executable/Scheduler.h>
+#include <HardwareAbstraction/LocalTimer.hpp>
 #include <IA32/APIC.h>
 #include <IA32/IDT.h>
 #include <KERNEL.h>
@@ -62,6 +64,10 @@ void APIC::setupEarlyTimer(void)
  * non-tickless kernel configurations. When the boot-strap processor calls
  * this, then the KiClockRespond irq is also mapped.
  *
+ * If the local timers are used in one-shot mode, the timer is instead
+ * armed to fire once after a millisecond; the scheduler programs it for
+ * the next event after that.
+ *
  * @version 1.0
  * @since Silcos 2.05
  * @author Shukant Pal
@@ -73,9 +79,19 @@ void APIC::setupScheduleTicks(void)
 		MapHandler(0x20, (unsigned int) &KiClockRespond,
 						(IDTEntry*) &defaultIDT);
 	xAPICDriver::write(SpurIntrVector, 0xFE | (1 << 8));
-	xAPICDriver::write(DivideConfig, 32);
-	xAPICDriver::write(LVT_Timer, (1 << 17) | 0x20);
-	xAPICDriver::write(InitialCount, 1 << 28);
+	xAPICDriver::write(DivideConfig, APIC_TIMER_DIVIDER);
+
+	if(oneShotTimerEnabled)
+	{
+		xAPICDriver::write(LVT_Timer, 0x20);
+		HAL::LocalTimer::fireAt(GetProcessorById(PROCESSOR_ID),
+				XMilliTime + 1);
+	}
+	else
+	{
+		xAPICDriver::write(LVT_Timer, (1 << 17) | 0x20);
+		xAPICDriver::write(InitialCount, 1 << 28);
+	}
 }
 
 /**
@@ -17,12 +17,28 @@
  * Copyright (C) 2017 - Shukant Pal
  */
 
+#include <HardwareAbstraction/CPUID.h>
+#include <HardwareAbstraction/CpuSet.hpp>
 #include <HardwareAbstraction/Processor.h>
 #include <IA32/APIC.h>
+#include <Memory/Address.h>
+#include <Memory/KMemorySpace.h>
 #include <KERNEL.h>
 
 using namespace HAL;
 
+/* Whether MONITOR/MWAIT can be used for idling; -1 until it is checked */
+static int mwaitUsable = -1;
+
+/* The TLB shootdown in progress; only one is sent at a time */
+static struct
+{
+	Spinlock lock;
+	volatile unsigned long base;
+	volatile unsigned long pageCount;
+	volatile unsigned long pending;// cpus yet to flush the range
+} tlbShootdown;
+
 /**
  * Method: HAL::CPUDriver::readRequest
  *
@@ -111,3 +127,177 @@ void CPUDriver::writeRequest(IPIRequest &req, Processor *proc)
 	SpinUnlock(&proc->migrlock);
 	APIC::triggerIPI(proc->hw.APICID, 0xFD);
 }
+
+/**
+ * Puts the current cpu to sleep until an interrupt occurs or the given
+ * flag is written to. If the cpu supports MONITOR/MWAIT, the cache-line
+ * holding the flag is monitored, so that other cpus can wake it without
+ * an IPI; otherwise, it halts. Returns immediately if the flag is already
+ * set.
+ *
+ * Interrupts are enabled on return.
+ *
+ * @param wakeFlag - flag which is set to wake this cpu
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void CPUDriver::idle(volatile unsigned long *wakeFlag)
+{
+	if(mwaitUsable == -1)
+	{
+		U32 cpuidBuffer[4];
+		__cpuid(1, 0, cpuidBuffer);
+		mwaitUsable = (cpuidBuffer[2] & CpuId::CPUID_FEAT_ECX_MONITOR) ? 1 : 0;
+	}
+
+	__cli
+
+	if(*wakeFlag)
+	{
+		__sti
+		return;
+	}
+
+	if(mwaitUsable)
+	{
+		Processor *self = GetProcessorById(PROCESSOR_ID);
+
+		/* Written before the flag is checked, which wakeup() does reverse */
+		self->polling = 1;
+		__mfence
+
+		asm volatile("monitor" : : "a"(wakeFlag), "c"(0), "d"(0));
+
+		if(!*wakeFlag)
+		{
+			/* STI takes effect after MWAIT, so no interrupt is missed */
+			asm volatile("sti; mwait" : : "a"(0), "c"(0));
+		}
+
+		self->polling = 0;
+		__sti
+	}
+	else
+	{
+		asm volatile("sti; hlt");
+	}
+}
+
+/**
+ * Wakes the given cpu, so that it reschedules. The IPI (on the 0xFD vector)
+ * is not sent if the cpu is polling its needResched flag in idle(), as
+ * writing to the flag wakes it.
+ *
+ * @param proc - the cpu to wake up
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void CPUDriver::wakeup(Processor *proc)
+{
+	proc->crolStatus.needResched = 1;
+	__mfence
+
+	if(proc == GetProcessorById(PROCESSOR_ID))
+		return;
+
+	if(!proc->polling)
+		APIC::triggerIPI(proc->hw.APICID, 0xFD);
+}
+
+/**
+ * Invalidates the TLB entries for the given range of pages on all online
+ * cpus, and waits until they have done so. This must be done after changing
+ * or removing mappings which other cpus may have cached, before the page-
+ * frames (or page-tables) which were mapped are freed.
+ *
+ * The caller shouldn't hold a lock which may be taken with interrupts off,
+ * as the other cpus must be able to take the IPI. Shootdowns sent to this
+ * cpu are accepted while it waits, so that two cpus don't wait on each
+ * other.
+ *
+ * @param base - address of the first page
+ * @param pageCount - no. of pages to invalidate
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void CPUDriver::shootdown(unsigned long base, unsigned long pageCount)
+{
+	PreemptDisable();
+
+	for(unsigned long pidx = 0; pidx < pageCount; pidx++)
+		FlushTLB(base + (pidx << KPGOFFSET));
+
+	if(onlineCpus.count() <= 1)
+	{
+		PreemptEnable();
+		return;
+	}
+
+	Processor *self = GetProcessorById(PROCESSOR_ID);
+
+	while(!TestLock(&tlbShootdown.lock))
+	{
+		acceptShootdown(self);
+		asm volatile("pause");
+	}
+
+	unsigned long cpuId, targets = 0;
+
+	for(cpuId = onlineCpus.first(); cpuId < CPUSET_MAX;
+			cpuId = onlineCpus.next(cpuId))
+	{
+		if(cpuId != self->hw.APICID)
+			++(targets);
+	}
+
+	tlbShootdown.base = base;
+	tlbShootdown.pageCount = pageCount;
+	tlbShootdown.pending = targets;
+	__mfence
+
+	for(cpuId = onlineCpus.first(); cpuId < CPUSET_MAX;
+			cpuId = onlineCpus.next(cpuId))
+	{
+		if(cpuId == self->hw.APICID)
+			continue;
+
+		GetProcessorById(cpuId)->tlbShootdown = 1;
+		__mfence
+		APIC::triggerIPI(cpuId, 0xFD);
+	}
+
+	while(tlbShootdown.pending != 0)
+	{
+		acceptShootdown(self);
+		asm volatile("pause");
+	}
+
+	SpinUnlock(&tlbShootdown.lock);
+	PreemptEnable();
+}
+
+/**
+ * Flushes the range being shot down from the TLB of the given (current)
+ * cpu, if a shootdown is pending on it. Called by the IPI handler, and by
+ * cpus waiting to send their own shootdown.
+ *
+ * @param proc - the current cpu
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void CPUDriver::acceptShootdown(Processor *proc)
+{
+	if(!__sync_lock_test_and_set(&proc->tlbShootdown, 0))
+		return;
+
+	unsigned long base = tlbShootdown.base;
+
+	for(unsigned long pidx = 0; pidx < tlbShootdown.pageCount; pidx++)
+		FlushTLB(base + (pidx << KPGOFFSET));
+
+	__sync_sub_and_fetch(&tlbShootdown.pending, 1);
+}
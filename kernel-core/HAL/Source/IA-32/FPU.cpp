@@ -0,0 +1,252 @@
+/**
+ * @file FPU.cpp
+ *
+ * Enables the x87, SSE & AVX units on each cpu and switches their state
+ * b/w tasks lazily. The save-areas are allocated when a task first uses
+ * the FPU, and so tasks which never do so don't need one.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <Executable/Task.hpp>
+#include <HardwareAbstraction/CPUID.h>
+#include <HardwareAbstraction/FPU.hpp>
+#include <HardwareAbstraction/Processor.h>
+#include <Memory/KObjectManager.h>
+#include <KERNEL.h>
+#include "../../../Interface/Utils/CtPrim.h"
+
+using namespace HAL;
+using namespace HAL::CpuId;
+using namespace Executable;
+
+FPUSaveMode FPU::saveMode = FPU_NONE;
+unsigned long FPU::stateSize = 0;
+
+static ObjectInfo *tFPUState = NULL;
+
+#define CR0_MP (1 << 1)// WAIT/FWAIT honour CR0.TS
+#define CR0_EM (1 << 2)// x87 instructions are emulated
+#define CR0_TS (1 << 3)// task switched - FPU use raises #NM
+#define CR0_NE (1 << 5)// native x87 error-reporting
+
+#define CR4_OSFXSR (1 << 9)
+#define CR4_OSXMMEXCPT (1 << 10)
+#define CR4_OSXSAVE (1 << 18)
+
+/* CPUID.(EAX=0DH,ECX=1):EAX[0] - XSAVEOPT is supported */
+#define CPUID_XSAVEOPT (1 << 0)
+
+/* Initial values of the x87 control-word & MXCSR, as set by FNINIT */
+#define FCW_DEFAULT 0x037F
+#define MXCSR_DEFAULT 0x1F80
+
+/* Offset of MXCSR in the legacy region of the save-area */
+#define MXCSR_OFFSET 24
+
+static inline U32 ReadCR0()
+{
+	U32 cr0;
+	asm volatile("movl %%cr0, %0" : "=r"(cr0));
+	return (cr0);
+}
+
+static inline void WriteCR0(U32 cr0)
+{
+	asm volatile("movl %0, %%cr0" : : "r"(cr0));
+}
+
+static inline U32 ReadCR4()
+{
+	U32 cr4;
+	asm volatile("movl %%cr4, %0" : "=r"(cr4));
+	return (cr4);
+}
+
+static inline void WriteCR4(U32 cr4)
+{
+	asm volatile("movl %0, %%cr4" : : "r"(cr4));
+}
+
+/**
+ * Enables the FPU on the current cpu and leaves CR0.TS set, so that the
+ * first task to use it takes the #NM exception. On the boot-strap cpu,
+ * the save-mode and the size of save-areas are also chosen (from CPUID
+ * leaf 0xD, if XSAVE is supported); this must be done after the object
+ * allocator is set up.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void FPU::init()
+{
+	U32 cpuidBuffer[4];
+	U32 featuresECX, featuresEDX;
+
+	__cpuid(1, 0, cpuidBuffer);
+	featuresECX = cpuidBuffer[2];
+	featuresEDX = cpuidBuffer[3];
+
+	if(!(featuresEDX & CPUID_FEAT_EDX_FXSR))
+		return;
+
+	FPUSaveMode mode = FPU_FXSAVE;
+	unsigned long size = 512;
+	U32 cr4 = ReadCR4() | CR4_OSFXSR | CR4_OSXMMEXCPT;
+
+	if(featuresECX & CPUID_FEAT_ECX_XSAVE)
+		cr4 |= CR4_OSXSAVE;
+
+	WriteCR4(cr4);
+
+	if(featuresECX & CPUID_FEAT_ECX_XSAVE)
+	{
+		__cpuid(0xD, 0, cpuidBuffer);
+		asm volatile("xsetbv" : : "c"(0),
+				"a"(cpuidBuffer[0] & XSTATE_SWITCHED), "d"(0));
+
+		__cpuid(0xD, 0, cpuidBuffer);
+		size = cpuidBuffer[1];// size for the components in XCR0
+
+		__cpuid(0xD, 1, cpuidBuffer);
+		mode = (cpuidBuffer[0] & CPUID_XSAVEOPT) ? FPU_XSAVEOPT : FPU_XSAVE;
+	}
+
+	WriteCR0((ReadCR0() & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+	asm volatile("fninit");
+	WriteCR0(ReadCR0() | CR0_TS);
+
+	if(tFPUState == NULL)
+	{
+		saveMode = mode;
+		stateSize = size;
+		tFPUState = KiCreateType("HAL::FPU::State", size, XSTATE_ALIGN,
+						NULL, NULL);
+	}
+}
+
+/**
+ * Saves the extended-state of the task being switched out, if it used the
+ * FPU in its time-slice (i.e. CR0.TS is clear), and sets CR0.TS so that
+ * the next task's state is loaded when it uses the FPU. Called by the
+ * scheduler, with interrupts disabled.
+ *
+ * @param cpu - the current cpu
+ * @param prev - the task being switched out
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void FPU::switchOut(Processor *cpu, Task *prev)
+{
+	if(saveMode == FPU_NONE)
+		return;
+
+	U32 cr0 = ReadCR0();
+
+	if(cr0 & CR0_TS)
+		return;
+
+	if(prev != NULL && cpu->fpuOwner == prev && prev->fpuState != NULL)
+		save(prev->fpuState);
+
+	WriteCR0(cr0 | CR0_TS);
+}
+
+/**
+ * Handles the #NM exception by loading the extended-state of the current
+ * task, unless it is still in the registers of this cpu. A task using the
+ * FPU for the first time gets a new save-area in the initial state.
+ *
+ * @param cpu - the current cpu
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void FPU::loadState(Processor *cpu)
+{
+	Task *task = cpu->ctask;
+
+	asm volatile("clts");
+
+	if(task == NULL || (cpu->fpuOwner == task && task->fpuCpu == cpu))
+		return;
+
+	if(task->fpuState == NULL)
+		task->fpuState = newState();
+
+	if(task->fpuState != NULL)
+		restore(task->fpuState);
+	else
+		asm volatile("fninit");
+
+	cpu->fpuOwner = task;
+	task->fpuCpu = cpu;
+}
+
+/*
+ * Allocates a save-area in the initial state. With XSAVE, a zero header
+ * marks all components as initial; MXCSR is always loaded from the area,
+ * and so it is set like the x87 control-word.
+ */
+void *FPU::newState()
+{
+	U8 *state = (U8*) KNew(tFPUState, KM_SLEEP);
+
+	if(state == NULL)
+		return (NULL);
+
+	memsetf(state, 0, stateSize);
+	*(U16*) state = FCW_DEFAULT;
+	*(U32*) (state + MXCSR_OFFSET) = MXCSR_DEFAULT;
+
+	return (state);
+}
+
+void FPU::save(void *state)
+{
+	switch(saveMode)
+	{
+	case FPU_XSAVEOPT:
+		asm volatile("xsaveopt (%0)" : : "r"(state), "a"(-1), "d"(-1)
+				: "memory");
+		break;
+	case FPU_XSAVE:
+		asm volatile("xsave (%0)" : : "r"(state), "a"(-1), "d"(-1)
+				: "memory");
+		break;
+	default:
+		asm volatile("fxsave (%0)" : : "r"(state) : "memory");
+		break;
+	}
+}
+
+void FPU::restore(void *state)
+{
+	if(saveMode == FPU_FXSAVE)
+		asm volatile("fxrstor (%0)" : : "r"(state) : "memory");
+	else
+		asm volatile("xrstor (%0)" : : "r"(state), "a"(-1), "d"(-1)
+				: "memory");
+}
+
+/*
+ * Called by the #NM handler (DeviceNotAvailable in IntrHook.asm).
+ */
+decl_c void HandleNM()
+{
+	FPU::loadState(GetProcessorById(PROCESSOR_ID));
+}
@@ -60,7 +60,7 @@ extern "C" void SetupGDT(ArchCpu *processorInfo)
 	GDTEntry *pGDT = &(processorInfo->GDT[0]);
 	GDTPointer *pGDTPointer = &(processorInfo->GDTR);
 
-	pGDTPointer->Limit = (sizeof(GDTEntry) * 6) - 1;
+	pGDTPointer->Limit = (sizeof(GDTEntry) * 7) - 1;
 	pGDTPointer->Base = (unsigned int) pGDT;
 
 	SetGateOn(0, 0, 0, 0, 0, pGDT);
@@ -68,7 +68,7 @@ extern "C" void SetupGDT(ArchCpu *processorInfo)
 	SetGateOn(2, 0, 0xFFFFFFFF, 0x92, 0xCF, pGDT);
 	SetGateOn(3, 0, 0xFFFFFFFF, 0xFA, 0xCF, pGDT);
 	SetGateOn(4, 0, 0xFFFFFFFF, 0xF2, 0xCF, pGDT);
-	/* SetupTSS() will add the 6th entry */
+	/* SetupTSS() will add the 6th & 7th entries */
 
 	ExecuteLGDT(pGDTPointer);/* Load.asm */
 }
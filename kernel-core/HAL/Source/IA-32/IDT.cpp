@@ -48,6 +48,23 @@ decl_c void MapHandler(unsigned short handlerNo, unsigned int handlerAddress,
 	pIDT[handlerNo].offHigh = (unsigned short)(handlerAddress >> 16);
 }
 
+/*
+ * Maps a task-gate, which switches to the task whose TSS is at the given
+ * selector, in the GDT of the interrupted cpu.
+ */
+decl_c void MapTaskGate(unsigned short handlerNo, unsigned short tssSelector,
+				IDTEntry *pIDT)
+{
+	pIDT[handlerNo].offLow = 0;
+	pIDT[handlerNo].sel = tssSelector;
+	pIDT[handlerNo].rfield = 0;
+	pIDT[handlerNo].gateType = TASK_GATE_286;
+	pIDT[handlerNo].storageSegment = 0;
+	pIDT[handlerNo].dpl = 0;
+	pIDT[handlerNo].present = 1;
+	pIDT[handlerNo].offHigh = 0;
+}
+
 static inline void waitIO(void) {
 	/* Taken from OSDev Wiki. */
 	asm volatile("jmp 1f\n\t"
@@ -95,7 +112,8 @@ decl_c void MapIDT()
 	IDTEntry *pIDT = defaultIDT;
 	IDTPointer *pIDTPointer = &(defaultIDTPointer);
 
-	MapHandler(0x8, (unsigned int) &DoubleFault, pIDT);
+	MapHandler(0x7, (unsigned int) &DeviceNotAvailable, pIDT);
+	MapTaskGate(0x8, 0x30, pIDT);// double-fault TSS, see TSS.cpp
 	MapHandler(0xA, (unsigned int) &InvalidTSS, pIDT);
 	MapHandler(0xB, (unsigned int) &SegmentNotPresent, pIDT);
 	MapHandler(0xD, (unsigned int) &GeneralProtectionFault, pIDT);
@@ -8,6 +8,14 @@ DoubleFault:
 	call HandleDF
 	iret
 
+global DeviceNotAvailable
+extern HandleNM
+DeviceNotAvailable:
+	pushad
+	call HandleNM
+	popad
+	iret
+
 global InvalidTSS
 extern HandleIT
 InvalidTSS:
@@ -29,9 +37,14 @@ GeneralProtectionFault:
 global PageFault
 extern HandlePF
 PageFault:
+	pushad
 	mov eax, cr2
 	mov [regInfo], eax
+	push dword [esp + 32]	; pass the error-code
 	call HandlePF
+	add esp, 4
+	popad
+	add esp, 4		; the error-code isn't popped by iret
 	iret
 
 align 8
@@ -0,0 +1,211 @@
+/**
+ * @file LocalTimer.cpp
+ *
+ * Implements the local timer using the local APIC timer, and the system
+ * clock using the invariant TSC. Both are calibrated against the PIT on
+ * the boot-strap processor; as the APIC timers run off the bus clock, the
+ * rate is shared by all cpus.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <Executable/Scheduler.h>
+#include <HardwareAbstraction/CPUID.h>
+#include <HardwareAbstraction/LocalTimer.hpp>
+#include <HardwareAbstraction/Processor.h>
+#include <IA32/APIC.h>
+#include <IA32/IO.h>
+#include <KERNEL.h>
+
+using namespace HAL;
+
+bool oneShotTimerEnabled = false;
+SeqLock LocalTimer::clockLock;
+U64 LocalTimer::clockBase;
+U32 LocalTimer::clockRate;
+U32 LocalTimer::timerRate;
+
+/* PIT input frequency, and the ports used to gate its channel 2 */
+#define PIT_FREQUENCY 1193182
+#define PIT_CHANNEL_2 0x42
+#define PIT_COMMAND 0x43
+#define PIT_GATE_PORT 0x61
+
+/* CPUID.80000007H:EDX[8] - the TSC runs at a constant rate in all states */
+#define CPUID_INVARIANT_TSC (1 << 8)
+
+static inline U64 ReadTSC()
+{
+	U64 tsc;
+	asm volatile("rdtsc" : "=A"(tsc));
+	return (tsc);
+}
+
+/*
+ * Divides a 64-bit value by a 32-bit one, without the 64-bit division
+ * routines of libgcc (which the kernel doesn't link to).
+ */
+static inline U64 Divide64(U64 value, U32 divisor)
+{
+	U32 high = (U32) (value >> 32), low = (U32) value;
+	U32 quotHigh = high / divisor, quotLow, remainder = high % divisor;
+
+	asm("divl %4" : "=a"(quotLow), "=d"(remainder)
+			: "a"(low), "d"(remainder), "rm"(divisor));
+
+	return (((U64) quotHigh << 32) | quotLow);
+}
+
+/**
+ * Measures the rates of the TSC & the local APIC timer against the PIT,
+ * by gating its channel 2 for LOCAL_TIMER_CALIBRATION ms. The one-shot
+ * mode is enabled only if the TSC is invariant. Must be called on the
+ * boot-strap processor before the schedule-ticks are set up.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void LocalTimer::calibrate()
+{
+	U32 cpuidBuffer[4];
+
+	__cpuid(0x80000000, 0, cpuidBuffer);
+	if(cpuidBuffer[0] < 0x80000007)
+		return;
+
+	__cpuid(0x80000007, 0, cpuidBuffer);
+	if(!(cpuidBuffer[3] & CPUID_INVARIANT_TSC))
+		return;
+
+	U32 pitCount = PIT_FREQUENCY * LOCAL_TIMER_CALIBRATION / 1000;
+	U8 gate = ReadPort(PIT_GATE_PORT) & ~0x03;// gate off, speaker off
+
+	WritePort(PIT_GATE_PORT, gate);
+	WritePort(PIT_COMMAND, 0xB0);// channel 2, lo/hi byte, mode 0
+	WritePort(PIT_CHANNEL_2, pitCount & 0xFF);
+	WritePort(PIT_CHANNEL_2, pitCount >> 8);
+
+	APIC::setTimerDivider();
+	APIC::writeTimer(0xFFFFFFFF);
+	U64 tscStart = ReadTSC();
+	WritePort(PIT_GATE_PORT, gate | 0x01);// start counting down
+
+	while(!(ReadPort(PIT_GATE_PORT) & 0x20));// wait for the output
+
+	U32 timerElapsed = 0xFFFFFFFF - APIC::readTimer();
+	U64 tscElapsed = ReadTSC() - tscStart;
+
+	APIC::writeTimer(0);
+	WritePort(PIT_GATE_PORT, gate);
+
+	U32 tscRate = (U32) Divide64(tscElapsed, LOCAL_TIMER_CALIBRATION);
+	timerRate = timerElapsed / LOCAL_TIMER_CALIBRATION;
+
+	if(tscRate == 0 || timerRate == 0)
+		return;
+
+	/*
+	 * The clock continues from the ticks counted until now. It is read
+	 * by the timer interrupt, and so it is updated with interrupts off.
+	 */
+	__irq_save_func(
+		clockLock.enterAsWriter();
+		clockRate = tscRate;
+		clockBase = ReadTSC() - XMilliTime * tscRate;
+		clockLock.exitAsWriter();
+	)
+
+	oneShotTimerEnabled = true;
+}
+
+/**
+ * Reads the system clock, which is shared by all cpus.
+ *
+ * @return - milliseconds elapsed since the clock was calibrated
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+Time LocalTimer::readClock()
+{
+	unsigned long seq;
+	U64 base;
+	U32 rate;
+
+	do {
+		seq = clockLock.readBegin();
+		base = clockBase;
+		rate = clockRate;
+	} while(clockLock.readRetry(seq));
+
+	return (Divide64(ReadTSC() - base, rate));
+}
+
+/**
+ * Programs the local timer of the current cpu to fire once, at the given
+ * system-time. The timer is stopped if the expiry is LOCAL_TIMER_NEVER.
+ *
+ * @param cpu - the current cpu
+ * @param expiry - time at which the timer should fire; if it has passed,
+ * 			the timer fires immediately.
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void LocalTimer::fireAt(Processor *cpu, Time expiry)
+{
+	cpu->crolStatus.tickExpiry = expiry;
+
+	if(expiry == LOCAL_TIMER_NEVER)
+	{
+		APIC::writeTimer(0);
+		return;
+	}
+
+	Time now = readClock();
+
+	if(expiry <= now)
+		APIC::writeTimer(1);
+	else if(expiry - now >= 0xFFFFFFFF / timerRate)
+		APIC::writeTimer(0xFFFFFFFF);
+	else
+		APIC::writeTimer((U32) (expiry - now) * timerRate);
+}
+
+/**
+ * Makes the local timer of the current cpu fire within a millisecond, so
+ * that the scheduler can account for new tasks on its runqueue. If the
+ * timer is periodic, the next tick is made to run the scheduler instead of
+ * being skipped for the current task's quantum.
+ *
+ * @param cpu - the current cpu
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void LocalTimer::kick(Processor *cpu)
+{
+	if(!oneShotTimerEnabled)
+	{
+		cpu->crolStatus.needResched = 1;
+		return;
+	}
+
+	Time soon = readClock() + 1;
+
+	if(cpu->crolStatus.tickExpiry > soon)
+		fireAt(cpu, soon);
+}
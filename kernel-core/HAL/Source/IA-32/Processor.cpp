@@ -30,8 +30,12 @@
 #include <Executable/Scheduler.h>
 #include <Executable/RoundRobin.h>
 #include <Executable/RunqueueBalancer.hpp>
+#include <Executable/WaitQueue.hpp>
+#include <Executable/WorkQueue.hpp>
 #include <HardwareAbstraction/CPUID.h>
+#include <HardwareAbstraction/FPU.hpp>
 #include <HardwareAbstraction/IOAPIC.hpp>
+#include <HardwareAbstraction/LocalTimer.hpp>
 #include <HardwareAbstraction/Processor.h>
 #include <HardwareAbstraction/ProcessorTopology.hpp>
 #include <IA32/IO.h>
@@ -229,7 +233,22 @@ decl_c void ConstructProcessor(Processor *proc)
 			+ PROCESSOR_STACK_SIZE);
 	proc->lschedTable[0] = &proc->rrsched;
 	new ((void*) proc->lschedTable[0]) Executable::RoundRobin();
+	proc->lschedTable[Executable::COMPLETELY_FAIR] = &proc->cfsched;
+	new ((void*) &proc->cfsched) Executable::CompletelyFair();
+	proc->lschedTable[Executable::REAL_TIME] = &proc->rtsched;
+	new ((void*) &proc->rtsched) Executable::RealTime();
+	proc->lschedTable[Executable::EARLIEST_DEADLINE] = &proc->dlsched;
+	new ((void*) &proc->dlsched) Executable::EarliestDeadline();
 	proc->crolStatus.presRoll = proc->lschedTable[0];
+	proc->crolStatus.tickExpiry = LOCAL_TIMER_NEVER;
+	proc->crolStatus.nextEvent = LOCAL_TIMER_NEVER;
+	proc->crolStatus.wakeList = NULL;
+	proc->crolStatus.wakeLock = 0;
+	proc->crolStatus.leaveList = NULL;
+	proc->crolStatus.moveList = NULL;
+	proc->crolStatus.moveLock = 0;
+	new ((void*) &proc->workQueue) Executable::WorkQueue();
+	new ((void*) &proc->irqWorkQueue) Executable::WorkQueue();
 }
 
 ///
@@ -309,6 +328,8 @@ decl_c void SetupBSP()
 	Processor *cpu = GetProcessorById(PROCESSOR_ID);
 	Pager::use((ADDRESS) cpu, KF_NOINTR | FLG_NOCACHE,
 			KernelData | PageCacheDisable);
+	Pager::use((ADDRESS) cpu + 4096, KF_NOINTR | FLG_NOCACHE,
+			KernelData | PageCacheDisable);
 
 	unsigned long irt = (unsigned long) GetIRQTableById(PROCESSOR_ID);
 	Pager::use((ADDRESS) irt, FLG_NOCACHE, KernelData);
@@ -411,8 +432,10 @@ decl_c void APEarlyMain(ulong retAddr, ulong envBase)
 decl_c void APMain()
 {
 	SetupProcessor();
+	FPU::init();
 	ProcessorTopology::plug();
 	SetupRunqueue();
+	WorkQueue::startWorker();
 
 	unsigned long b[2];
 	extern void APWaitForPermit(unsigned long*);
@@ -451,6 +474,21 @@ decl_c void APMain()
 decl_c void Executable_ProcessorBinding_IPIRequest_Handler()
 {
 	Processor *tcpu = GetProcessorById(PROCESSOR_ID);
+
+	CPUDriver::acceptShootdown(tcpu);
+
+	if (tcpu->crolStatus.wakeList != null) {
+		FlushWakeups(tcpu);
+		LocalTimer::kick(tcpu);
+	}
+
+	/* Class-changes are done by the scheduler, as the task may be running */
+	if (tcpu->crolStatus.moveList != null)
+		LocalTimer::kick(tcpu);
+
+	tcpu->irqWorkQueue.poll(tcpu);
+	tcpu->workQueue.poll(tcpu);
+
 	IPIRequest *req = CPUDriver::readRequest(tcpu);
 
 	if (req == null)
@@ -459,10 +497,15 @@ decl_c void Executable_ProcessorBinding_IPIRequest_Handler()
 	switch (req->type) {
 	case ACCEPT_TASK_COLLECTION: {
 		RunqueueBalancer::Accept *acc = (RunqueueBalancer::Accept*) req;
+		tcpu->lschedTable[acc->type]->attachLoad(
+				(Executable::Task*) acc->taskList.lMain,
+				acc->taskList.count);
 		tcpu->lschedTable[acc->type]->recieve(
 				(Executable::Task*) acc->taskList.lMain,
 				(Executable::Task*) acc->taskList.lMain->last,
 				acc->taskList.count, acc->load);
+		tcpu->crolStatus.needResched = 1;// in case the cpu is idle
+		LocalTimer::kick(tcpu);
 		break;
 	}
 	case RENOUNCE_TASK_COLLECTION: {
@@ -482,7 +525,11 @@ decl_c void Executable_ProcessorBinding_IPIRequest_Handler()
 				new (tRunqueueBalancer_Accept) RunqueueBalancer::Accept(type,
 						ren->donor, ren->taker);
 
-		ren->src.lschedTable[type]->send(&ren->dst, reply->taskList, loadDelta);
+		ScheduleRoller *roller = ren->src.lschedTable[type];
+		SpinLock(&roller->lock);
+		roller->send(&ren->src, &ren->dst, reply->taskList, loadDelta);
+		roller->detachLoad(reply->taskList);
+		SpinUnlock(&roller->lock);
 		reply->load = loadDelta;
 		CPUDriver::writeRequest(*reply, &ren->dst);
 
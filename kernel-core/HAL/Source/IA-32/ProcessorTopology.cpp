@@ -21,6 +21,7 @@
 /// Copyright (C) 2017 - Shukant Pal
 ///
 #include <HardwareAbstraction/CPUID.h>
+#include <HardwareAbstraction/CpuSet.hpp>
 #include <HardwareAbstraction/Processor.h>
 #include <HardwareAbstraction/ProcessorTopology.hpp>
 #include <IA32/APIC.h>
@@ -29,6 +30,7 @@
 using namespace HAL;
 
 extern bool x2APICModeEnabled;
+CpuSet HAL::onlineCpus;
 Domain *ProcessorTopology::systemDomain;
 ObjectInfo *ProcessorTopology::tDomain;
 
@@ -45,7 +47,8 @@ void UpdateCoreCount(Domain *dom) // @suppress("Name convention for function")
 /// bottom is inserted into the tree automatically unless they already
 /// exist. After calling this, there is no need to use the apic-id to
 /// access the topological position of this cpu, as the topological-ids
-/// are written into the ArchCpu part of the per-cpu struct.
+/// are written into the ArchCpu part of the per-cpu struct. The cpu is then
+/// added to the online cpus, on which tasks can be placed.
 ///
 /// @version 1.0
 /// @since Silcos 2.05
@@ -133,30 +136,41 @@ void ProcessorTopology::plug()
 	cur->children.lMain = (CircularListNode*) tproc;
 	tproc->domlink = cur;
 	Iterator::ofEach(tproc, &UpdateCoreCount, 4);
+	onlineCpus.add(tproc->hw.APICID);
 }
 
 ///
-/// Performs an iteration from the bottom to the top of the topological-tree
-/// and toggles the load of each domain by the given magnitude.
+/// Folds the change in the cpu's load-average (for the given class), since
+/// it was last folded, into each domain from the bottom to the top of the
+/// topological-tree. The domains are written only when the load has
+/// changed, and not on every enqueue, so that their cache-lines are not
+/// dirtied all the time.
 ///
-/// @param initialCPU - the CPU from which iteration starts
-/// @param cls - scheduling-class for which the load is being toggled
-/// @param mag - magnitude by which load is to change (may be +ve or -ve)
-/// @version 1.0
+/// @param cpu - the CPU whose load is to be folded; must be the current one
+/// @param cls - scheduling-class for which the load is being folded
+/// @version 2.0
 /// @since Silcos 2.05
 /// @author Shukant Pal
 ///
-void ProcessorTopology::Iterator::toggleLoad(Processor *initialCPU,
-		Executable::ScheduleClass cls, long mag)
+void ProcessorTopology::Iterator::foldLoad(Processor *cpu,
+		Executable::ScheduleClass cls)
 {
-	if (!initialCPU) {
-		initialCPU = GetProcessorById(PROCESSOR_ID);
-	}
+	Executable::ScheduleRoller *roller = cpu->lschedTable[cls];
+
+	if (roller == NULL)
+		return;
+
+	long delta = (long) roller->loadAvg.runnableAvg
+			- (long) roller->foldedLoad;
 
-	Domain *domain = (Domain *) initialCPU->domlink;
+	if (delta == 0)
+		return;
+
+	roller->foldedLoad = roller->loadAvg.runnableAvg;
+
+	Domain *domain = (Domain *) cpu->domlink;
 	while (domain != NULL) {
-		domain->taskInfo[cls].load += mag;
-		__mfence
+		domain->taskInfo[cls].load.fetchAdd(delta, MEMORY_RELAXED);
 		domain = domain->parent;
 	}
 }
@@ -418,3 +432,28 @@ Domain *DomainBinding::findBusiestGroup(Executable::ScheduleClass cls,
 
 	return (bestFound);
 }
+
+///
+/// Gives the cost of migrating a task b/w the given cpus, which is that of
+/// the innermost domain containing both of them. All cpus are plugged at
+/// the same depth, so both paths reach that domain together.
+///
+/// @param from - cpu from which a task is to be migrated
+/// @param to - cpu to which the task is to be migrated
+/// @return - time (in ms) for which the task is assumed to be cache-hot
+/// @version 1.0
+/// @since Silcos 3.05
+/// @author Shukant Pal
+///
+Time DomainBinding::migrationCost(Processor *from, Processor *to)
+{
+	Domain *src = from->domlink, *dst = to->domlink;
+
+	while (src != dst && src != NULL && dst != NULL) {
+		src = src->parent;
+		dst = dst->parent;
+	}
+
+	return ((src == dst && src != NULL) ? src->migrationCost
+			: MIGRATION_COST_PACKAGE);
+}
@@ -22,9 +22,14 @@
 #include <ACPI/HPET.h>
 #include <IA32/APIC.h>
 #include <Executable/RunqueueBalancer.hpp>
+#include <Executable/Thread.h>
+#include <Executable/WorkQueue.hpp>
+#include <HardwareAbstraction/FPU.hpp>
 #include <HardwareAbstraction/IOAPIC.hpp>
+#include <HardwareAbstraction/LocalTimer.hpp>
 #include <HardwareAbstraction/Processor.h>
 #include <HardwareAbstraction/ProcessorTopology.hpp>
+#include <Synch/LockBenchmark.hpp>
 #include <KERNEL.h>
 #include <Math.hpp>
 
@@ -45,7 +50,15 @@ decl_c void ArchMain()
 
 	InitTTable();
 	RunqueueBalancer::init();
+	WorkQueue::init();
+	WorkQueue::startWorker();
+	FPU::init();
+	LocalTimer::calibrate();
 
 	SetupAPs();
 	APIC::setupScheduleTicks();
+
+#ifdef LOCK_BENCHMARK
+	KThreadCreate((void*) &LockBenchmarkThread);
+#endif
 }
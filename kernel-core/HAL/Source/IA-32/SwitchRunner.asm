@@ -1,7 +1,7 @@
 ; Copyright (C) - Shukant Pal
 ;
 ; provides the implementation for a scheduler-invoker on the ia32 arch, and
-; is called when ever the apic-timer 'ticks'.
+; is called when ever the apic-timer 'ticks' (or a task yields the cpu).
 ;
 
 SECTION .bss
@@ -12,7 +12,8 @@ SECTION .text
 
 extern VAPICBase
 extern BSP_ID
-extern XMilliTime
+extern KiTickClock
+extern oneShotTimerEnabled
 global KiClockRespond
 KiClockRespond:
 	MFENCE
@@ -31,12 +32,87 @@ KiClockRespond:
 	MOV EDX, [VAPICBase]
 	MOV EDX, [EDX + 0x20] 			; load PROCESSOR_ID << 24
 	SHR EDX, 24				; load APIC_ID
+	CMP BYTE [oneShotTimerEnabled], 0	; in one-shot mode, time is read from
+	JNE KiRunnerUpdate			; the clock-source and not counted here
 	CMP [BSP_ID], EDX 			; test if the cpu is the BSP
-	JNE KiScheduleEntry
+	JNE KiRunnerUpdate
 
-	LOCK INC DWORD [XMilliTime]
+	PUSH EDX
+	CALL KiTickClock			; 64-bit increment of XMilliTime
+	POP EDX
 
+;-F-F-F-F-F-
+;
+; skips the scheduler while the current task has quanta left, and no one has
+; asked for a reschedule. only the left-over quanta is decremented before
+; returning to the task (LeftQuanta is 0 in one-shot mode).
+;
 KiRunnerUpdate:
+	MOV EAX, EDX
+	SHL EAX, 15				; get the offset of the cpu-struct (32-kb)
+	ADD EAX, 0xc0000000 + 20 * 1024 * 1024	; load the address of cpu-struct
+
+	CMP DWORD [EAX + 32 + 52], 0		; test crolStatus.needResched
+	JNE KiPreemptCheck
+	CMP DWORD [EAX + 32 + 20], 0		; test crolStatus.LeftQuanta
+	JE KiPreemptCheck
+
+	DEC DWORD [EAX + 32 + 20]		; one more tick of the quantum is used
+	JMP KiRunnerReturn
+
+;-F-F-F-F-F-
+;
+; kernel code holding spinlocks (or running with preemption disabled) isn't
+; switched out. the reschedule is remembered in needResched, and done when
+; the preemption count drops to zero.
+;
+KiPreemptCheck:
+	CMP DWORD [EAX + 32 + 16], 0		; test crolStatus.preemptCount
+	JE KiScheduleEntry
+
+	MOV DWORD [EAX + 32 + 52], 1		; reschedule on the final unlock
+
+KiRunnerReturn:
+	CALL EOI
+	POP EBP
+	POP EDI
+	POP ESI
+	POP EDX
+	POP ECX
+	POP EBX
+	POP EAX
+	IRET
+
+;-F-F-F-F-F-
+;
+; switches away from the current task voluntarily (when it goes to sleep).
+; an interrupt-frame is built on the stack, so that the task is resumed just
+; like a preempted one - returning from here with interrupts enabled. must
+; be called with interrupts disabled, and no spinlock held.
+;
+global KiYield
+KiYield:
+	POP ECX					; pop the return eip
+	PUSHFD
+	OR DWORD [ESP], 1 << 9			; resume with IF=1
+	PUSH DWORD 0x8
+	PUSH ECX
+
+	PUSH EAX
+	PUSH EBX
+	PUSH ECX
+	PUSH EDX
+	PUSH ESI
+	PUSH EDI
+	PUSH EBP
+
+	MOV EBP, ESP
+	ADD EBP, 28				; go to the interrupt-frame built
+
+	MOV EDX, [VAPICBase]
+	MOV EDX, [EDX + 0x20] 			; load PROCESSOR_ID << 24
+	SHR EDX, 24				; load APIC_ID
+	JMP KiScheduleEntry
 
 ;-F-F-F-F-F-
 ;
@@ -66,6 +142,7 @@ KiScheduleEntry:
 		MOV [EDI + 4], EBP		; save the kernel-mode stack-pointer
 
 KiInvokeScheduler:
+	INC DWORD [EDX + 32 + 16]		; no preemption inside the scheduler
 	PUSH EDX				; save EDX (to avoid changes)
 	PUSH EDX				; pass cpu-argument
 	CALL Schedule
@@ -79,6 +156,7 @@ KiInvokeScheduler:
 KiScheduleExit:
 	ADD ESP, 4			; go to previous stack-frame (before args)
 	POP EDX				; restore the cpu-struct
+	DEC DWORD [EDX + 32 + 16]	; the next task runs preemptible
 
 	MOV EBX, [EDX + 24] 		; load the new-task
 	MOV EDI, [EBX + 32] 		; cache the task's kernel-stack struct
@@ -16,6 +16,7 @@
  *
  * Copyright (C) 2017 - Shukant Pal
  */
+#include <IA32/IntrHook.h>
 #include <IA32/Processor.h>
 #include "../../../Interface/Utils/CtPrim.h"
 
@@ -24,6 +25,33 @@ using namespace HAL;
 TSS SystemTSS;
 import_asm void ExecuteLTR(void);
 
+/*
+ * Sets up the task entered through the double-fault task-gate. A kernel
+ * stack overflow faults on a guard-page and then can't push the #PF frame;
+ * the double-fault must hence be handled on a stack of its own, which is
+ * only possible by a hardware task-switch on IA-32.
+ */
+static void SetupDoubleFaultTSS(ArchCpu *pinfo)
+{
+	TSS *dfTSS = &(pinfo->dfTSS);
+	unsigned int cr3;
+
+	SetGateOn(6, (unsigned int) dfTSS, sizeof(TSS) - 1, 0x89, 0,
+			&(pinfo->GDT[0]));
+	memsetf(dfTSS, 0, sizeof(TSS));
+
+	asm volatile("movl %%cr3, %0" : "=r"(cr3));
+	dfTSS->CR3 = cr3;
+	dfTSS->EIP = (unsigned int) &DoubleFault;
+	dfTSS->EFLAGS = 0x2;
+	dfTSS->ESP = (unsigned int) &(pinfo->DoubleFaultStack[512]);
+	dfTSS->ESP_0 = dfTSS->ESP;
+	dfTSS->CS = 0x8;
+	dfTSS->DS = dfTSS->ES = dfTSS->FS = dfTSS->GS = 0x10;
+	dfTSS->SS = dfTSS->SS_0 = 0x10;
+	dfTSS->IOMAP_BASE = 104;
+}
+
 extern "C" void SetupTSS(ArchCpu *pinfo)
 {
 	TSS *pTSS = &(pinfo->kTSS);
@@ -40,5 +68,6 @@ extern "C" void SetupTSS(ArchCpu *pinfo)
 	pTSS->ESP_0 = 0;
 	pTSS->IOMAP_BASE = 104;
 
+	SetupDoubleFaultTSS(pinfo);
 	ExecuteLTR();
 }
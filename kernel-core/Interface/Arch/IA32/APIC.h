@@ -29,6 +29,9 @@
 
 extern unsigned int VAPICBase;
 
+//! Divide-configuration of the local APIC timer for schedule-ticks
+#define APIC_TIMER_DIVIDER 32
+
 typedef U32 APIC_ID;
 typedef U8 APIC_VECTOR;
 
@@ -116,6 +119,23 @@ public:
 
 	static void setupEarlyTimer();
 	static void setupScheduleTicks();
+
+	/* Sets the divider used by the schedule-ticks, for calibration */
+	static inline void setTimerDivider()
+	{
+		xAPICDriver::write(DivideConfig, APIC_TIMER_DIVIDER);
+	}
+
+	/* Starts the timer counting down from the given count (0 stops it) */
+	static inline void writeTimer(U32 initialCount)
+	{
+		xAPICDriver::write(InitialCount, initialCount);
+	}
+
+	static inline U32 readTimer()
+	{
+		return (xAPICDriver::read(CurrentCount));
+	}
 	static void triggerIPI(U32 apicId, U8 vect);
 	static void wakeupSequence(U32 apicId, U8 page);
 private:
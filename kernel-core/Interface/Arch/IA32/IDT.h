@@ -50,5 +50,7 @@ struct IDTPointer {
 
 decl_c void MapHandler(unsigned short handlerNo, unsigned int handlerAddress,
 				IDTEntry *pIDT) kxhide;
+decl_c void MapTaskGate(unsigned short handlerNo, unsigned short tssSelector,
+				IDTEntry *pIDT) kxhide;
 
 #endif/* IA32/IDT.h */
@@ -7,6 +7,7 @@
 
 #include <TYPE.h>
 
+import_asm void DeviceNotAvailable();
 import_asm void DoubleFault();
 import_asm void InvalidTSS();
 import_asm void SegmentNotPresent();
@@ -89,6 +89,11 @@ public:
 			unsigned long tableCount, unsigned long allocFlags,
 			MemoryContext *cxt = null);
 
+	static PhysAddr allocPageTable(unsigned long allocFlags,
+			bool& zeroed);
+	static void freePageTable(PhysAddr tableFrame);
+	static bool reclaimPageTable(unsigned long tableIndice);
+
 	static U64 *remAllPagesTables(unsigned short tableIndice,
 			unsigned short tableCount, unsigned long allocFlags,
 			MemoryContext *cxt);
@@ -143,7 +148,7 @@ public:
 			KiFrameFree(*dirEnt & 0x00000FFFFFFFF000);
 		}
 
-		*dirEnt = KeFrameAllocate(9, allocFlags, ZONE_KERNEL) |
+		*dirEnt = KeFrameAllocate(9, ZONE_KERNEL, allocFlags) |
 				(attr) | (1 << 7);
 
 		FlushTLB((unsigned long) pageTableForOffset(dirEnt - (U64*)
@@ -11,6 +11,7 @@
 #define PageReadWrite 		(1 << 1)
 #define PageUserland 		(1 << 2)
 #define PageCacheDisable	(1 << 3)
+#define PagePromoting		(1 << 9)// write-protected while promoted (software bit)
 
 #ifdef NS_PMFLGS
 	#define PRESENT			(1 << 0)
@@ -82,6 +83,20 @@ struct PageTrans
 
 } PAGE_TRANSALATOR;
 
+//! Max. no. of zeroed page-table frames kept in a cpu's page-table cache
+#define PGTAB_CACHE_SIZE 8
+
+/*
+ * Per-cpu pool of page-table frames which are already zeroed, so that they
+ * can be put into a page-directory without clearing them again. Page-tables
+ * reclaimed by the pager are empty & hence go directly into this pool.
+ */
+struct PageTableCache
+{
+	unsigned long count;
+	PhysAddr frames[PGTAB_CACHE_SIZE];
+};
+
 static inline unsigned long getAddressFor(unsigned long pdptIndex,
 		unsigned long dirIndex, unsigned long tableIndex) {
 	return ((pdptIndex << 30) + (dirIndex << 21) + (tableIndex << 12));
@@ -95,9 +95,11 @@ struct ArchCpu
 	unsigned int CoreID;
 	unsigned int SMT_ID;
 	unsigned int ProcessorStack[256];
-	GDTEntry GDT[6] __attribute__((aligned(8)));
+	GDTEntry GDT[7] __attribute__((aligned(8)));
 	GDTPointer GDTR;
 	TSS kTSS;
+	TSS dfTSS;//!< Task entered on a double-fault (kernel-stack overflow)
+	unsigned int DoubleFaultStack[512];
 	IDTEntry IDT[256];//!< obselete @deprecated
 	IDTPointer IDTR;//!< obselete @deprecated
 	char brandString[64];//!< Brand-string extracted from CPUID
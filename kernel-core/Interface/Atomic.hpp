@@ -1,8 +1,10 @@
 ///
 /// @file Atomic.hpp
 ///
-/// This file provides high-level syntax atomic utility functions. You can
-/// use them instead of directly writing asm.
+/// Provides Atomic<T>, a wrapper over an 8, 16, 32 or 64-bit value which is
+/// read & modified only by atomic operations. Each operation takes the
+/// memory-ordering it requires, so that lock-free code can say what it
+/// needs instead of writing its own asm.
 /// -------------------------------------------------------------------
 /// This program is free software: you can redistribute it and/or modify
 /// it under the terms of the GNU General Public License as published by
@@ -25,148 +27,350 @@
 
 #include <TYPE.h>
 
-class Atomic
+///
+/// Ordering of an atomic operation w.r.t. the memory accesses around it.
+///
+/// On x86, loads aren't reordered with other loads, nor stores with other
+/// stores, and locked instructions are full barriers. So only the compiler
+/// must be stopped for acquire & release; a sequentially-consistent store
+/// is done by xchg, as a plain store may pass a later load.
+///
+enum MemoryOrder
 {
-public:
-	static void add(unsigned char delta, unsigned char *ptr)
+	MEMORY_RELAXED,//!< only the access itself is atomic
+	MEMORY_ACQUIRE,//!< later accesses stay after it
+	MEMORY_RELEASE,//!< earlier accesses stay before it
+	MEMORY_ACQ_REL,//!< both acquire & release
+	MEMORY_SEQ_CST//!< a total order, over all seq-cst operations
+};
+
+/* Stops the compiler from moving memory accesses across this point */
+static inline void CompilerBarrier()
+{
+	asm volatile("" : : : "memory");
+}
+
+/* Orders the memory accesses before this point w.r.t. those after it */
+static inline void AtomicFence(MemoryOrder order)
+{
+	if(order == MEMORY_SEQ_CST)
+		asm volatile("mfence" : : : "memory");
+	else if(order != MEMORY_RELAXED)
+		CompilerBarrier();
+}
+
+///
+/// Atomic primitives on a word of the given size (in bytes), used by
+/// Atomic<T>. All the read-modify-write operations are full barriers.
+///
+template<unsigned long size> struct AtomicWord;
+
+#define ATOMIC_WORD(size, type, suffix, reg)					\
+template<> struct AtomicWord<size>						\
+{										\
+	typedef type Word;							\
+										\
+	static inline Word load(const volatile Word *ptr)			\
+	{									\
+		return (*ptr);							\
+	}									\
+										\
+	static inline void store(volatile Word *ptr, Word value)		\
+	{									\
+		*ptr = value;							\
+	}									\
+										\
+	static inline Word exchange(volatile Word *ptr, Word value)		\
+	{									\
+		asm volatile("xchg" suffix " %0, %1"				\
+				: "+" reg(value), "+m"(*ptr) : : "memory");	\
+		return (value);							\
+	}									\
+										\
+	static inline Word fetchAdd(volatile Word *ptr, Word delta)		\
+	{									\
+		asm volatile("lock xadd" suffix " %0, %1"			\
+				: "+" reg(delta), "+m"(*ptr) : : "memory", "cc");\
+		return (delta);							\
+	}									\
+										\
+	static inline bool compareExchange(volatile Word *ptr, Word& expected,	\
+						Word desired)			\
+	{									\
+		U8 success;							\
+		asm volatile("lock cmpxchg" suffix " %3, %1; sete %0"		\
+				: "=q"(success), "+m"(*ptr), "+a"(expected)	\
+				: reg(desired) : "memory", "cc");		\
+		return (success);						\
+	}									\
+};
+
+ATOMIC_WORD(1, U8, "b", "q")
+ATOMIC_WORD(2, U16, "w", "r")
+ATOMIC_WORD(4, U32, "l", "r")
+
+#undef ATOMIC_WORD
+
+///
+/// 64-bit words are changed by cmpxchg8b on IA-32, and all the other
+/// operations are built on it - even loads, as two 32-bit loads may see
+/// halves of different values. EBX is saved by hand, as it holds the GOT
+/// in the position-independent modules. Words which only increase can be
+/// loaded without it (see loadRising).
+///
+template<> struct AtomicWord<8>
+{
+	typedef U64 Word;
+
+	static inline bool compareExchange(volatile Word *ptr, Word& expected,
+						Word desired)
 	{
-#if defined(IA32) || defined(IA64)
-		asm volatile("lock addb %1, %0" : "=m"(*ptr) : "r"(delta), "m"(*ptr));
+		U8 success;
+#if defined(IA32)
+		asm volatile("xchgl %%ebx, %%esi\n\t"
+				"lock cmpxchg8b (%%edi)\n\t"
+				"xchgl %%ebx, %%esi\n\t"
+				"sete %0"
+				: "=q"(success), "+A"(expected)
+				: "S"((U32) desired), "c"((U32) (desired >> 32)),
+					"D"(ptr)
+				: "memory", "cc");
+#else
+		asm volatile("lock cmpxchgq %3, %1; sete %0"
+				: "=q"(success), "+m"(*ptr), "+a"(expected)
+				: "r"(desired) : "memory", "cc");
 #endif
+		return (success);
 	}
 
-	static void add(unsigned short delta, unsigned short *ptr)
+	static inline Word load(const volatile Word *ptr)
 	{
-#if defined(IA32) || defined(IA64)
-		asm volatile("lock adds %1, %0" : "=m"(*ptr) : "r"(delta), "m"(*ptr));
-#endif
+		Word value = 0;
+
+		/* Fails (giving the value) unless it is zero, which is kept */
+		compareExchange(const_cast<volatile Word*>(ptr), value, 0);
+		return (value);
 	}
 
-	static void add(unsigned int delta, unsigned int *ptr)
+	/*
+	 * Loads a word which is never decreased, without a locked access. The
+	 * high half is read again after the low one; if it is unchanged, the
+	 * low half belongs to a value with that high half, as the word can't
+	 * have gone past it & come back.
+	 */
+	static inline Word loadRising(const volatile Word *ptr)
 	{
-#if defined(IA32) || defined(IA64)
-		asm volatile("lock addl %1, %0" : "=m"(*ptr) : "r"(delta), "m"(*ptr));
+#if defined(IA32)
+		const volatile U32 *half = (const volatile U32*) ptr;
+		U32 high, low;
+
+		do
+		{
+			high = half[1];
+			low = half[0];
+		} while(half[1] != high);
+
+		return (((Word) high << 32) | low);
+#else
+		return (*ptr);
 #endif
 	}
 
-	static void add(unsigned long delta, unsigned long *ptr)
+	static inline Word exchange(volatile Word *ptr, Word value)
 	{
-#if defined(IA32)
-		asm volatile("lock addl %1, %0" : "=m"(*ptr) : "r"(delta), "m"(*ptr));
-#elif
-		asm volatile("lock addq %1, %0" : "=m"(*ptr) : "r"(delta), "m"(*ptr));
-#endif
+		Word old = *ptr;
+
+		while(!compareExchange(ptr, old, value));
+		return (old);
 	}
 
-	static void dec(unsigned char *ptr)
+	static inline void store(volatile Word *ptr, Word value)
 	{
-#if defined(IA32) || defined(IA64)
-		asm volatile("lock decb %0" : "=m"(*ptr) : "m"(*ptr));
-#endif
+		(void) exchange(ptr, value);
 	}
 
-	static void dec(unsigned short *ptr)
+	static inline Word fetchAdd(volatile Word *ptr, Word delta)
 	{
-#if defined(IA32) || defined(IA64)
-		asm volatile("lock decs %0" : "=m"(*ptr) : "m"(*ptr));
-#endif
+		Word old = *ptr;
+
+		while(!compareExchange(ptr, old, old + delta));
+		return (old);
+	}
+};
+
+///
+/// Value of type T (an integer, enum or pointer of 1, 2, 4 or 8 bytes)
+/// which is accessed atomically. It is aligned to its size, so that no
+/// access is split across cache-lines. The arithmetic & bitwise operations
+/// are only meant for integers.
+///
+/// All read-modify-write operations are full barriers on x86, whatever the
+/// ordering asked for; it still tells the compiler, and the reader, what
+/// the code relies on.
+///
+/// @version 1.0
+/// @since Silcos 3.05
+/// @author Shukant Pal
+///
+template<class T>
+class Atomic
+{
+	typedef AtomicWord<sizeof(T)> Ops;
+	typedef typename Ops::Word Word;
+public:
+	constexpr Atomic() : value(0) {}
+	constexpr Atomic(T initial) : value(initial) {}
+
+	Atomic(const Atomic&) = delete;
+	Atomic& operator=(const Atomic&) = delete;
+
+	inline T load(MemoryOrder order = MEMORY_SEQ_CST) const
+	{
+		Word word = Ops::load(raw());
+
+		if(order != MEMORY_RELAXED)
+			CompilerBarrier();
+
+		return (toValue(word));
 	}
 
-	static void dec(unsigned int *ptr)
+	inline void store(T newValue, MemoryOrder order = MEMORY_SEQ_CST)
 	{
-#if defined(IA32) || defined(IA64)
-		asm volatile("lock decl %0" : "=m"(*ptr) : "m"(*ptr));
-#endif
+		if(order == MEMORY_SEQ_CST)
+		{
+			(void) Ops::exchange(raw(), toWord(newValue));
+			return;
+		}
+
+		if(order != MEMORY_RELAXED)
+			CompilerBarrier();
+
+		Ops::store(raw(), toWord(newValue));
 	}
 
-	static void dec(unsigned long *ptr)
+	inline T exchange(T newValue, MemoryOrder order = MEMORY_SEQ_CST)
 	{
-#if defined(IA32)
-		asm volatile("lock decl %0" : "=m"(*ptr) : "m"(*ptr));
-#elif defined(IA64)
-		asm volatile("lock decq %0" : "=m"(*ptr) : "m"(*ptr));
-#endif
+		(void) order;
+		return (toValue(Ops::exchange(raw(), toWord(newValue))));
 	}
 
-	static void oR(unsigned int *ptr, unsigned int op)
+	/*
+	 * Replaces the value with the desired one, only if it is equal to the
+	 * expected one; otherwise, the expected value is updated to the one
+	 * found, so that the caller can retry.
+	 */
+	inline bool compareExchange(T& expected, T desired,
+					MemoryOrder order = MEMORY_SEQ_CST)
 	{
-		asm volatile("lock or %1, %0" : "=m"(*ptr) : "r"(op), "m"(*ptr));
+		Word word = toWord(expected);
+		bool success = Ops::compareExchange(raw(), word,
+							toWord(desired));
+
+		(void) order;
+		expected = toValue(word);
+		return (success);
 	}
 
-	static void inc(unsigned char *ptr)
+	inline T fetchAdd(T delta, MemoryOrder order = MEMORY_SEQ_CST)
 	{
-#if defined(IA32) || defined(IA64)
-		asm volatile("lock incb %0" : "=m"(*ptr) : "m"(*ptr));
-#endif
+		(void) order;
+		return (toValue(Ops::fetchAdd(raw(), toWord(delta))));
 	}
 
-	static void inc(unsigned short *ptr)
+	inline T fetchSub(T delta, MemoryOrder order = MEMORY_SEQ_CST)
 	{
-#if defined(IA32) || defined(IA64)
-		asm volatile("lock incs %0" : "=m"(*ptr) : "m"(*ptr));
-#endif
+		(void) order;
+		return (toValue(Ops::fetchAdd(raw(), (Word) 0 - toWord(delta))));
 	}
 
-	static void inc(unsigned int *ptr)
+	inline T fetchOr(T mask, MemoryOrder order = MEMORY_SEQ_CST)
 	{
-#if defined(IA32) || defined(IA64)
-		asm volatile("lock incl %0" : "=m"(*ptr) : "m"(*ptr));
-#endif
+		Word old = Ops::load(raw());
+
+		(void) order;
+		while(!Ops::compareExchange(raw(), old, old | toWord(mask)));
+		return (toValue(old));
 	}
 
-	static void inc(unsigned long *ptr)
+	inline T fetchAnd(T mask, MemoryOrder order = MEMORY_SEQ_CST)
 	{
-#if defined(IA32)
-		asm volatile("lock incl %0" : "=m"(*ptr) : "m"(*ptr));
-#elif defined(IA64)
-		asm volatile("lock incq %0" : "=m"(*ptr) : "m"(*ptr));
-#endif
+		Word old = Ops::load(raw());
+
+		(void) order;
+		while(!Ops::compareExchange(raw(), old, old & toWord(mask)));
+		return (toValue(old));
 	}
 
-	static void sub(unsigned char delta, unsigned char *ptr)
+	inline operator T() const
 	{
-#if defined(IA32) || defined(IA64)
-		asm volatile("lock subb %1, %0" : "=m"(*ptr) : "r"(delta), "m"(*ptr));
-#endif
+		return (load());
 	}
 
-	static void sub(unsigned short delta, unsigned short *ptr)
+	inline T operator=(T newValue)
 	{
-#if defined(IA32) || defined(IA64)
-		asm volatile("lock subs %1, %0" : "=m"(*ptr) : "r"(delta), "m"(*ptr));
-#endif
+		store(newValue);
+		return (newValue);
 	}
+protected:
+	volatile T value __attribute__((aligned(sizeof(T))));
 
-	static void sub(unsigned int delta, unsigned int *ptr)
+	union Bits
 	{
-#if defined(IA32) || defined(IA64)
-		asm volatile("lock subl %1, %0" : "=m"(*ptr) : "r"(delta), "m"(*ptr));
-#endif
+		T typed;
+		Word word;
+	};
+
+	inline volatile Word *raw() const
+	{
+		return ((volatile Word*) &value);
 	}
 
-	static void sub(unsigned long delta, unsigned long *ptr)
+	static inline Word toWord(T typed)
 	{
-#if defined(IA32)
-		asm volatile("lock subl %1, %0" : "=m"(*ptr) : "r"(delta), "m"(*ptr));
-#elif defined(IA64)
-		asm volatile("lock subq %1, %0" : "=m"(*ptr) : "r"(delta), "m"(*ptr));
-#endif
+		Bits bits;
+		bits.typed = typed;
+		return (bits.word);
 	}
 
-	static void xchg(unsigned int val, unsigned int *ptr)
+	static inline T toValue(Word word)
 	{
-#if defined(IA32) || defined(IA64)
-		asm volatile("xchg %1, %0" : "=m"(*ptr) : "r"(val), "m"(*ptr));
-#endif
+		Bits bits;
+		bits.word = word;
+		return (bits.typed);
 	}
+};
 
-	static void xchg(unsigned long val, unsigned long *ptr)
+///
+/// 64-bit atomic value which is only ever increased, like a clock. It is
+/// loaded without a locked cmpxchg8b (see AtomicWord<8>::loadRising), so
+/// that frequent readers don't bounce its cache-line b/w cpus; the other
+/// operations are those of Atomic<T>.
+///
+/// @version 1.0
+/// @since Silcos 3.05
+/// @author Shukant Pal
+///
+template<class T>
+class MonotonicAtomic : public Atomic<T>
+{
+	typedef typename AtomicWord<8>::Word Word;
+public:
+	constexpr MonotonicAtomic() : Atomic<T>() {}
+	constexpr MonotonicAtomic(T initial) : Atomic<T>(initial) {}
+
+	inline T load(MemoryOrder order = MEMORY_SEQ_CST) const
 	{
-#if defined(IA32)
-		asm volatile("xchg %1, %0" : "=m"(*ptr) : "r"(val), "m"(*ptr));
-#elif defined(IA64)
-		asm volatile("xchg %1, %0" : "=m"(*ptr) : "r"(val), "m"(*ptr));
-#endif
+		Word word = AtomicWord<8>::loadRising(this->raw());
+
+		if(order != MEMORY_RELAXED)
+			CompilerBarrier();
+
+		return (this->toValue(word));
+	}
+
+	inline operator T() const
+	{
+		return (load());
 	}
 };
 
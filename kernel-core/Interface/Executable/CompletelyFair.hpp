@@ -0,0 +1,101 @@
+/**
+ * @file CompletelyFair.hpp
+ *
+ * CFS (or Completely Fair Scheduling) divides the cpu b/w runnable tasks in
+ * proportion to their weights, which are derived from their nice-values. A
+ * task's run-time is scaled inversely to its weight to get its virtual
+ * run-time, and the task with the least virtual run-time is run next.
+ * @see ExecutionManager/Wiki/CFS.md
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#ifndef EXEC_COMPLETELY_FAIR_HPP__
+#define EXEC_COMPLETELY_FAIR_HPP__
+
+#include <Executable/ScheduleRoller.h>
+#include "../Utils/CircularList.h"
+#include "../Utils/RBTree.hpp"
+#include "Task.hpp"
+
+#define NICE_MIN (-20)
+#define NICE_MAX 19
+
+//! Weight of a task with nice-value 0
+#define NICE_0_LOAD 1024
+
+//! Period (in ms) in which each runnable task should run at least once
+#define CFS_SCHED_LATENCY 20
+
+//! Least time (in ms) for which a task runs before it can be preempted
+#define CFS_MIN_GRANULARITY 4
+
+//! Tree-key (rqKey) of a task which is taken off the runqueue-tree
+#define CFS_UNQUEUED (~0UL)
+
+namespace Executable
+{
+
+/**
+ * Implements the completely-fair scheduling class. Runnable tasks are kept
+ * in a red-black tree keyed by their virtual run-time (relative to a base,
+ * as keys are only 32-bits wide), and the leftmost task is picked to run.
+ *
+ * Each task gets a time-slice of its share (by weight) in the scheduling
+ * latency, but never less than the minimum granularity. Tasks transferred
+ * b/w cpus carry their virtual run-time relative to the minimum in the
+ * source runqueue, so that they neither gain nor lose their position.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+class CompletelyFair final : public ScheduleRoller
+{
+public:
+	Task *add(Task *newTask);
+	Task *allocate(Time t, HAL::Processor *cpu);
+	Task *update(Time t, HAL::Processor *cpu);
+	void free(Time at, HAL::Processor *cpu);
+	bool remove(Task *tTask);
+	unsigned long quantum(Time t, HAL::Processor *cpu);
+	void send(HAL::Processor *from, HAL::Processor *to, CircularList& list,
+			unsigned long deltaLoad);
+	void recieve(Task *first, Task *last, unsigned long count, unsigned long load);
+	void renice(Task *task, long nice);
+	CompletelyFair();
+	~CompletelyFair();
+private:
+	RBTree *runqueue;// runnable tasks keyed by virtual run-time
+	CircularList allTasks;// all tasks in the runqueue (for migration)
+	Task *currentTask;// task last allocated from this roller
+	Time sliceStart;// time at which currentTask was allocated
+	Time minVruntime;// monotonic minimum virtual run-time
+	Time keyBase;// virtual run-time at which the tree-keys start
+	unsigned long totalWeight;// sum of weights of all tasks
+
+	void account(Task *task, Time t);
+	void enqueue(Task *task);
+	void dequeue(Task *task);
+	void insertKeyed(Task *task);
+	void rebase();
+	void updateMinVruntime();
+	Task *pickNext(Time t);
+	unsigned long timeSlice(Task *task);
+};
+
+}
+
+#endif/* Executable/CompletelyFair.hpp */
@@ -0,0 +1,104 @@
+/**
+ * @file EarliestDeadline.hpp
+ *
+ * The deadline scheduling class runs the task with the earliest deadline
+ * first (EDF), and takes precedence over all other classes. Each task
+ * reserves a budget of run-time in every period, which is enforced by a
+ * constant-bandwidth server (CBS), so that a task overrunning its budget
+ * can't make others miss their deadlines.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#ifndef EXEC_EARLIEST_DEADLINE_HPP__
+#define EXEC_EARLIEST_DEADLINE_HPP__
+
+#include <Executable/ScheduleRoller.h>
+#include "../Utils/CircularList.h"
+#include "../Utils/RBTree.hpp"
+#include "Task.hpp"
+
+//! Fixed-point scale for bandwidths (runtime/period)
+#define DL_BW_SHIFT 16
+#define DL_BW_UNIT (1UL << DL_BW_SHIFT)
+
+//! Max. bandwidth reserved for deadline tasks on a cpu (95%)
+#define DL_BW_LIMIT (DL_BW_UNIT * 95 / 100)
+
+//! Tree-key (rqKey) of a task which isn't on a runqueue
+#define DL_UNQUEUED (~0UL)
+
+//! Longest period (in ms) allowed, so that bandwidths don't overflow
+#define DL_PERIOD_MAX 0xFFFF
+
+namespace Executable
+{
+
+/**
+ * Implements earliest-deadline-first scheduling with a constant-bandwidth
+ * server for each task. Tasks are kept in a red-black tree keyed by their
+ * absolute deadline (relative to a base, as keys are only 32-bits wide).
+ *
+ * A task is admitted only if the sum of the bandwidths (runtime/period) of
+ * all tasks on the cpu stays under DL_BW_LIMIT; this guarantees that each
+ * task gets its runtime before each deadline. When a task exhausts its
+ * budget, its deadline is postponed by a period and its budget refilled.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+class EarliestDeadline final : public ScheduleRoller
+{
+public:
+	Task *add(Task *newTask);
+	Task *add(Task *newTask, unsigned long runtime, unsigned long period);
+	Task *allocate(Time t, HAL::Processor *cpu);
+	Task *update(Time t, HAL::Processor *cpu);
+	void free(Time at, HAL::Processor *cpu);
+	bool remove(Task *tTask);
+	unsigned long quantum(Time t, HAL::Processor *cpu);
+	void send(HAL::Processor *from, HAL::Processor *to, CircularList& list,
+			unsigned long deltaLoad);
+	void recieve(Task *first, Task *last, unsigned long count, unsigned long load);
+	EarliestDeadline();
+	~EarliestDeadline();
+
+	inline unsigned long getBandwidth()
+	{
+		return (totalBandwidth);
+	}
+private:
+	RBTree *runqueue;// tasks keyed by deadline
+	CircularList allTasks;// all tasks in the runqueue (for migration)
+	Task *currentTask;// task last allocated from this roller
+	Time keyBase;// deadline at which the tree-keys start
+	unsigned long totalBandwidth;// sum of bandwidths of all tasks
+
+	static inline unsigned long bandwidthOf(Task *task)
+	{
+		return ((task->dlRuntime << DL_BW_SHIFT) / task->dlPeriod);
+	}
+
+	void account(Task *task, Time t);
+	void enqueue(Task *task);
+	void dequeue(Task *task);
+	void rebase(Time t);
+	Task *pickNext(Time t);
+};
+
+}
+
+#endif/* Executable/EarliestDeadline.hpp */
@@ -22,6 +22,7 @@
 
 #include <Atomic.hpp>
 #include <Object.hpp>
+#include <Executable/WorkQueue.hpp>
 #include <Utils/ArrayList.hpp>
 
 namespace Executable
@@ -48,6 +49,49 @@ protected:
 	virtual ~IRQHandler();
 };
 
+///
+/// Result of the top-half of a threaded irq-handler.
+///
+enum IRQResult
+{
+	IRQ_NONE = 0,//!< the interrupt wasn't raised by this device
+	IRQ_HANDLED = 1,//!< the interrupt was handled completely
+	IRQ_WAKE_THREAD = 2//!< the bottom-half must run to finish handling it
+};
+
+///
+/// Irq-handler split into a top-half, which runs in the interrupt with
+/// interrupts disabled, and a bottom-half, which runs with interrupts
+/// enabled on the irq worker-thread of the same cpu (a real-time thread,
+/// see WorkQueue). The top-half should only acknowledge the device and
+/// pick up whatever state is lost otherwise; long handling belongs in the
+/// bottom-half, so that the timer and IPIs aren't held off on the cpu.
+///
+/// Interrupts coming before the bottom-half runs are batched into one
+/// pass, which is given the no. of top-halves that asked for it. If the
+/// irq is routed to more than one cpu, passes may run on them at once.
+///
+/// @version 1.0
+/// @since Silcos 3.05
+/// @author Shukant Pal
+///
+class ThreadedIRQHandler : public IRQHandler
+{
+public:
+	bool intrAction() final;
+protected:
+	ThreadedIRQHandler();
+	virtual ~ThreadedIRQHandler();
+
+	virtual IRQResult topHalf() = 0;
+	virtual void bottomHalf(unsigned long events) = 0;
+private:
+	Work bottomWork;// queued on the irq work-queue of the cpu
+	volatile unsigned long events;// top-halves since the last pass
+
+	static void runBottomHalf(void *handler);
+};
+
 /**
  * Holds different irq-handlers that shared the same hardware line
  * physically. Whenever an irq is triggered, each handler is called
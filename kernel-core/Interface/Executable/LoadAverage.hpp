@@ -0,0 +1,93 @@
+/**
+ * @file LoadAverage.hpp
+ *
+ * Load-averages track how busy a task (or a runqueue) has been recently,
+ * rather than just counting tasks. Each millisecond of history is weighed
+ * by y^n, where n is its age and y^32 = 1/2 - so the load of the last
+ * 32 ms counts twice as much as the load of the 32 ms before it.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#ifndef EXEC_LOAD_AVERAGE_HPP__
+#define EXEC_LOAD_AVERAGE_HPP__
+
+#include <TYPE.h>
+
+//! Value of an average for an entity that was always running/runnable
+#define LOAD_SCALE 1024
+
+//! Half-life (in ms) of the load-averages
+#define LOAD_HALF_LIFE 32
+
+//! Age (in ms) after which history has no weight (at the precision used)
+#define LOAD_DECAY_MAX (LOAD_HALF_LIFE * 32)
+
+//! Interval (in ms) at which a cpu folds its averages into its domains
+#define LOAD_FOLD_INTERVAL 16
+
+namespace Executable
+{
+
+unsigned long DecayLoad(unsigned long value, unsigned long periods);
+
+/**
+ * Exponentially decaying averages of the time an entity was running and
+ * runnable. For a task, both are b/w 0 & LOAD_SCALE; for a runqueue, the
+ * runnable average is scaled by the no. of runnable tasks.
+ *
+ * The averages are updated lazily - only when the state of the entity
+ * changes - as the history b/w two changes has a constant contribution,
+ * which is accounted for in closed form.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+struct LoadAverage
+{
+	Time lastUpdate;// time until which the averages are accounted
+	unsigned long utilAvg;// decaying average of time spent running
+	unsigned long runnableAvg;// decaying average of runnable entities
+
+	inline void init(Time now)
+	{
+		lastUpdate = now;
+		utilAvg = 0;
+		runnableAvg = 0;
+	}
+
+	/*
+	 * Accounts the time since the last update, in which the entity was
+	 * running (or not) & had the given no. of runnable entities.
+	 */
+	inline void update(Time now, bool running, unsigned long runnable)
+	{
+		if(now <= lastUpdate)
+			return;
+
+		unsigned long periods = (now - lastUpdate < LOAD_DECAY_MAX) ?
+				(unsigned long) (now - lastUpdate) : LOAD_DECAY_MAX;
+		unsigned long fill = LOAD_SCALE - DecayLoad(LOAD_SCALE, periods);
+
+		lastUpdate = now;
+		utilAvg = DecayLoad(utilAvg, periods) + ((running) ? fill : 0);
+		runnableAvg = DecayLoad(runnableAvg, periods) + runnable * fill;
+	}
+};
+
+}
+
+#endif/* Executable/LoadAverage.hpp */
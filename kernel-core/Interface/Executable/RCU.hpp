@@ -0,0 +1,127 @@
+/**
+ * @file RCU.hpp
+ *
+ * Read-copy-update, based on quiescent states. Readers of RCU-protected
+ * data take no lock and write to no shared memory - they only keep the
+ * scheduler out. Updaters publish a new version of the data, and free the
+ * old one after a grace period, i.e. once every cpu has passed through a
+ * quiescent state (a context switch, or the idle loop), as no reader can
+ * hold a reference across one.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#ifndef EXEC_RCU_HPP__
+#define EXEC_RCU_HPP__
+
+#include <Executable/WorkQueue.hpp>
+#include <HardwareAbstraction/CpuSet.hpp>
+#include <Synch/Spinlock.h>
+
+namespace Executable
+{
+
+struct RcuHead;
+
+typedef void (*RcuCallback)(RcuHead *head);
+
+/**
+ * Embedded in an object that is to be freed (or otherwise reclaimed) after
+ * a grace period, and passed to callRcu(). The callback usually recovers the
+ * object from the head, and frees it.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+struct RcuHead
+{
+	RcuHead *next;
+	RcuCallback callback;
+};
+
+/**
+ * Per-cpu state of RCU, kept in the Processor struct. Callbacks pass
+ * through three batches - those queued since the last grace period was
+ * requested, those waiting for the grace period waitGp to complete, and
+ * those ready to be invoked by the worker-thread. An all-zero state is
+ * valid, as the per-cpu data is zeroed when it is set up.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+struct RcuData
+{
+	unsigned long gpSeen;// last grace period noticed by this cpu
+	RcuHead *nextList;// callbacks without a grace period yet
+	RcuHead **nextTail;
+	RcuHead *waitList;// callbacks waiting for waitGp to complete
+	RcuHead **waitTail;
+	unsigned long waitGp;
+	RcuHead *doneList;// callbacks whose grace period has completed
+	RcuHead **doneTail;
+	Work work;// invokes the completed callbacks
+};
+
+/**
+ * Global state of the grace periods. A grace period is in progress while
+ * gpNumber is ahead of gpCompleted, and it completes when the last cpu in
+ * gpPending reports a quiescent state.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+struct RcuState
+{
+	volatile unsigned long gpNumber;// last grace period started
+	volatile unsigned long gpCompleted;// last grace period completed
+	bool gpRequested;// start another grace period after this one
+	HAL::CpuSet gpPending;// cpus yet to pass a quiescent state
+	Spinlock lock;
+};
+
+/*
+ * Read-side critical sections run with preemption disabled, and must not
+ * sleep. They can be nested, and used in interrupt handlers.
+ */
+static inline void rcuReadLock()
+{
+	PreemptDisable();
+}
+
+static inline void rcuReadUnlock()
+{
+	PreemptEnable();
+}
+
+/* Reads a pointer published by rcuAssign(), for use in a read section */
+#define rcuDereference(ptr) (*(__typeof__(ptr) volatile *) &(ptr))
+
+/* Publishes a pointer, after the object it points to has been set up */
+#define rcuAssign(ptr, value)				\
+{							\
+	asm volatile("" : : : "memory");		\
+	*(__typeof__(ptr) volatile *) &(ptr) = (value);	\
+}
+
+void callRcu(RcuHead *head, RcuCallback callback);
+void synchronizeRcu();
+void RcuQuiescent(HAL::Processor *cpu) kxhide;
+
+}
+
+#endif/* Executable/RCU.hpp */
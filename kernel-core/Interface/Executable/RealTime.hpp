@@ -0,0 +1,100 @@
+/**
+ * @file RealTime.hpp
+ *
+ * The real-time scheduling class runs tasks by fixed-priority, and takes
+ * precedence over the fair & round-robin classes. Tasks in this class are
+ * never run after a lower-priority task, which bounds their dispatch
+ * latency to one tick.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#ifndef EXEC_REAL_TIME_HPP__
+#define EXEC_REAL_TIME_HPP__
+
+#include <Executable/ScheduleRoller.h>
+#include "../Utils/CircularList.h"
+#include "Task.hpp"
+
+//! No. of real-time priorities (one for each bit in the bitmap)
+#define RT_PRIORITIES 32
+
+//! Ticks for which a RT_ROUND_ROBIN task runs before yielding to its peers
+#define RT_QUANTUM 10
+
+//! Queue-index (rqKey) of a task which isn't on a runqueue
+#define RT_UNQUEUED RT_PRIORITIES
+
+namespace Executable
+{
+
+enum RealTimePolicy
+{
+	RT_FIFO = 0,//!< runs until a higher-priority task comes
+	RT_ROUND_ROBIN = 1//!< also shares the cpu with same-priority tasks
+};
+
+/**
+ * Implements fixed-priority real-time scheduling. Each priority has its own
+ * queue of tasks, and a bitmap holds which queues are non-empty, so that
+ * the highest-priority task is found in constant time.
+ *
+ * A RT_FIFO task runs until a task of higher priority is added; a
+ * RT_ROUND_ROBIN task is also moved to the end of its queue after each
+ * quantum, so that tasks of the same priority share the cpu.
+ *
+ * The priority of a task may be raised while it holds a mutex wanted by a
+ * higher-priority task (priority-inheritance). A queued task is indexed by
+ * its rqKey, which holds the priority it was queued at.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+class RealTime final : public ScheduleRoller
+{
+public:
+	Task *add(Task *newTask);
+	Task *add(Task *newTask, unsigned long priority, RealTimePolicy policy);
+	Task *allocate(Time t, HAL::Processor *cpu);
+	Task *update(Time t, HAL::Processor *cpu);
+	void free(Time at, HAL::Processor *cpu);
+	bool remove(Task *tTask);
+	unsigned long quantum(Time t, HAL::Processor *cpu);
+	void send(HAL::Processor *from, HAL::Processor *to, CircularList& list,
+			unsigned long deltaLoad);
+	void recieve(Task *first, Task *last, unsigned long count, unsigned long load);
+	unsigned long urgency(Task *task);
+	void setUrgency(Task *task, unsigned long urgency);
+	RealTime();
+	~RealTime();
+private:
+	unsigned long queueBitmap;// bit n is set if queue n is not empty
+	CircularList queues[RT_PRIORITIES];// tasks for each priority
+	Task *currentTask;// task last allocated from this roller
+
+	void enqueue(Task *task);
+	void dequeue(Task *task);
+	Task *pickNext();
+
+	inline unsigned long highestPriority()
+	{
+		return (31 - __builtin_clz(queueBitmap));
+	}
+};
+
+}
+
+#endif/* Executable/RealTime.hpp */
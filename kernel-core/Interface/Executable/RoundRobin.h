@@ -13,6 +13,13 @@
 #include "../Utils/RBTree.hpp"
 #include "Task.hpp"
 
+//! Ticks for which a task runs before the next one in the ring
+#define RR_QUANTUM 10
+
+//! Ring-marker (rqKey) of a task in the ring, and of one which isn't
+#define RR_QUEUED 0
+#define RR_UNQUEUED 1
+
 namespace Executable
 {
 
@@ -34,17 +41,21 @@ public:
 	Task *allocate(Time t, HAL::Processor *cpu);
 	Task *update(Time t, HAL::Processor *cpu);
 	void free(Time at, HAL::Processor *cpu);
-	void remove(Task *tTask);
-	void send(HAL::Processor *to, CircularList& list, unsigned long deltaLoad);
+	bool remove(Task *tTask);
+	unsigned long quantum(Time t, HAL::Processor *cpu);
+	void send(HAL::Processor *from, HAL::Processor *to, CircularList& list,
+			unsigned long deltaLoad);
 	void recieve(Task *first, Task *last, unsigned long count, unsigned long load);
 	RoundRobin();
 	~RoundRobin();
 private:
 	Task *mainTask;// circular list -> main task
 	Task *mostRecent;// most recently run task
+	Task *currentTask;// task last allocated from this roller
 	unsigned long taskCount;// no. of tasks on this cpu
 	CircularList pausedTasks;// tasks that are paused without any timer
 
+	void forgetSent(CircularList& list);
 };
 
 }
@@ -33,6 +33,13 @@ extern ObjectInfo *tRunqueueBalancer_Renounce;
 
 namespace HAL { struct Processor; }
 
+//! Base interval (in ms) b/w periodic balancing of a domain, which is
+//! scaled by the square of (level + 1) for outer domains
+#define BALANCE_INTERVAL 64
+
+//! Max. no. of tasks stolen at once by an idle cpu
+#define STEAL_BATCH_MAX 4
+
 namespace Executable
 {
 
@@ -41,7 +48,8 @@ class RunqueueBalancer final
 public:
 	static void init();
 	static void balanceWork(ScheduleClass cls) kxhide;
-	static void balanceWork(ScheduleClass cls, HAL::Domain *dom) kxhide;
+	static bool balanceWork(ScheduleClass cls, HAL::Domain *dom) kxhide;
+	static bool steal(ScheduleClass cls) kxhide;
 
 	struct Accept : public HAL::IPIRequest
 	{
@@ -9,12 +9,21 @@
 #ifndef EXEC_SCHEDULECLASS_H
 #define EXEC_SCHEDULECLASS_H
 
+#include <Atomic.hpp>
+#include <Executable/LoadAverage.hpp>
 #include <Synch/Spinlock.h>
+#include "../Utils/CircularList.h"
 #include "../Utils/Stack.h"
 #include "Task.hpp"
 
 namespace HAL { struct Domain; struct Processor; }
 
+//! Max. no. of cache-hot tasks a runqueue holds back while sending tasks
+#define MIGRATION_HOT_MAX 8
+
+//! Max. ticks for which the timer interrupt may skip the scheduler
+#define SCHED_QUANTUM_MAX 32
+
 namespace Executable
 {
 class RunqueueBalancer;
@@ -24,7 +33,9 @@ enum
 {
 	ROUND_ROBIN = 0,
 	COMPLETELY_FAIR = 1,
-	SCHED_ROLLER_TYPES = 3
+	REAL_TIME = 2,
+	EARLIEST_DEADLINE = 3,
+	SCHED_ROLLER_TYPES = 4
 };
 
 /**
@@ -40,8 +51,17 @@ enum
  * allocate - get any task to run on the cpu
  * free - take-back a task after a time-interval of executing it
  * add - spawn a new task in the system
- * remove - destroy the task from the system
+ * remove - take the task off the runqueue, if it is queued there
+ * quantum - ticks for which the current task can run without an update
  * transfer - move tasks to the other roller with the loaded transfer-config
+ * urgency - priority of a task within the class, higher runs first
+ * setUrgency - change the priority of a task (for priority-inheritance)
+ *
+ * Locking:
+ * Other cpus may steal tasks from a roller, and so it is protected by its
+ * lock. add, remove & recieve take the lock themselves; allocate, update,
+ * free, quantum & send must be called with the lock held. The lock is always taken
+ * with interrupts off.
  *
  * Author: Shukant Pal
  */
@@ -58,13 +78,61 @@ public:
 		loadRequested = rload;
 	}
 
+	/* Moves the load-averages of migrating tasks out of this runqueue */
+	void detachLoad(CircularList& list)
+	{
+		Task *task = (Task*) list.lMain;
+
+		for(unsigned long idx = 0; idx < list.count; idx++)
+		{
+			loadAvg.runnableAvg -= (task->loadAvg.runnableAvg <
+					loadAvg.runnableAvg) ?
+					task->loadAvg.runnableAvg : loadAvg.runnableAvg;
+			task = task->next;
+		}
+	}
+
+	/* Moves the load-averages of migrated tasks into this runqueue */
+	void attachLoad(Task *first, unsigned long count)
+	{
+		for(unsigned long idx = 0; idx < count; idx++)
+		{
+			loadAvg.runnableAvg += first->loadAvg.runnableAvg;
+			first = first->next;
+		}
+	}
+
+	/*
+	 * Whether the task's cache-footprint is probably still hot, given the
+	 * cost (in ms) of migrating it b/w the cpus concerned.
+	 */
+	static inline bool isCacheHot(Task *task, Time now, Time cost)
+	{
+		return (now - task->lastRan < cost);
+	}
+
 	virtual Task *add(Task *newTask) = 0;
 	virtual Task *allocate(Time t, HAL::Processor *cpu) = 0;
 	virtual Task *update(Time t, HAL::Processor *cpu) = 0;
 	virtual void free(Time at, HAL::Processor *cpu) = 0;
-	virtual void remove(Task *tTask) = 0;
-	virtual void send(HAL::Processor *proc, CircularList &list, unsigned long delta) = 0;
+	virtual bool remove(Task *tTask) = 0;
+	virtual unsigned long quantum(Time t, HAL::Processor *cpu) = 0;
+	virtual void send(HAL::Processor *from, HAL::Processor *proc,
+			CircularList &list, unsigned long delta) = 0;
 	virtual void recieve(Task *first, Task *last, unsigned long count, unsigned long load) = 0;
+
+	/*
+	 * Classes without priorities don't take part in priority-inheritance,
+	 * and keep these defaults.
+	 */
+	virtual unsigned long urgency(Task *task)
+	{
+		return (0);
+	}
+
+	virtual void setUrgency(Task *task, unsigned long urgency)
+	{
+	}
 protected:
 	ScheduleRoller() kxhide;
 	virtual ~ScheduleRoller() kxhide;
@@ -72,6 +140,8 @@ public:
 	unsigned long load;// current load
 	unsigned long loadRequested;// requested-load for transfer
 	unsigned long transferDelta;// delta on transfer
+	LoadAverage loadAvg;// decaying load of this runqueue
+	unsigned long foldedLoad;// part of loadAvg folded into the domains
 	Stack transferBuffer;// buffer for incoming tasks
 	Spinlock lock;
 
@@ -80,12 +150,11 @@ public:
 
 struct ScheduleDomain
 {
-	long load;// task-load for the domain
+	Atomic<long> load;// task-load for the domain, folded in by all its cpus
 	Time balanceDelta;// timestamp for the next balance
 
-	ScheduleDomain()
+	ScheduleDomain() : load(0)
 	{
-		load = 0;
 		balanceDelta = 0;
 	}
 };
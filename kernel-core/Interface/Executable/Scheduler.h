@@ -20,19 +20,33 @@
 #ifndef EXEC_SCHEDULER_H
 #define EXEC_SCHEDULER_H
 
+#include <Atomic.hpp>
 #include <Executable/Task.hpp>
 #include <Executable/Thread.h>
+#include <HardwareAbstraction/LocalTimer.hpp>
 #include <HardwareAbstraction/Processor.h>
 #include <Synch/Spinlock.h>
 #include <KERNEL.h>
 
-extern Time XMilliTime;
+/*
+ * System time, in ms. With periodic timers, the BSP's tick counts it; but in
+ * one-shot mode, it is brought up to the clock only when a cpu schedules,
+ * and so it may lag behind by upto NOHZ_BUSY_DEFER ms (or more, if all cpus
+ * are idle). Code outside the scheduler should use getSystemTime().
+ */
+extern MonotonicAtomic<Time> XMilliTime;
 
 export_asm void WakeupExpiredWaiters(HAL::Processor *cpu) kxhide;
 export_asm void Schedule(HAL::Processor *cpu);
+export_asm void KiYield();
+export_asm void KiTickClock();
+void UpdateSystemTime();
 
 static inline Time getSystemTime()
 {
+	if(oneShotTimerEnabled)
+		UpdateSystemTime();
+
 	return (XMilliTime);
 }
 
@@ -11,7 +11,10 @@
 #define EXEC_EXEC_H
 
 #include <Executable/CPUStack.h>
+#include <Executable/LoadAverage.hpp>
+#include <HardwareAbstraction/CpuSet.hpp>
 #include <Memory/Pager.h>
+#include <Synch/Spinlock.h>
 #include <Types.h>
 #include <Memory/Pager.h>
 #include "../Utils/AVLTree.hpp"
@@ -34,9 +37,18 @@ enum
 };
 
 namespace HAL { struct Processor; }
+class Mutex;
+
+//! Value of Task::pinnedCpu when the task may run on more than one cpu
+#define CPU_UNPINNED 0xFFFFFFFF
+
+//! Words of class-parameters in a task (EarliestDeadline's are the most)
+#define SCHED_PARAMS (sizeof(Time) / sizeof(unsigned long) + 3)
 
 namespace Executable
 {
+class WaitQueue;
+
 enum TaskState
 {
 	Start,
@@ -84,6 +96,7 @@ struct Task
 	CONTEXT *mmu;/* Address space which the task is using */
 	Time startTime;/* K-Time start */
 	Time timeStamp;/* K-Time last executed */
+	Time lastRan;/* K-Time at which the task was last switched out */
 
 	union
 	{
@@ -97,11 +110,81 @@ struct Task
 		};
 	};
 
+	unsigned long rqKey;/* Key in a tree-based runqueue (CFS, EDF) */
+
+	union/* Parameters specific to the task's scheduling class */
+	{
+		struct/* CompletelyFair */
+		{
+			Time vruntime;/* Weighted run-time */
+			long niceValue;/* Nice-value, from NICE_MIN to NICE_MAX */
+		};
+		struct/* RealTime */
+		{
+			unsigned long rtPriority;/* Higher value runs first */
+			unsigned long rtPolicy;/* RT_FIFO or RT_ROUND_ROBIN */
+			unsigned long rtQuantum;/* Ticks left for RT_ROUND_ROBIN */
+		};
+		struct/* EarliestDeadline */
+		{
+			Time dlDeadline;/* Absolute deadline of current job */
+			unsigned long dlRuntime;/* Budget in each period (ms) */
+			unsigned long dlPeriod;/* Period & relative deadline (ms) */
+			unsigned long dlBudget;/* Budget left until deadline */
+		};
+		unsigned long schedParams[SCHED_PARAMS];/* Copied as a whole */
+	};
+
+	LoadAverage loadAvg;/* Recent utilization of the task */
+
+	WaitQueue *waitQueue;/* Wait-queue on which the task is sleeping */
+	Task *waitNext;/* Links in the wait-queue, or the wake-list of its cpu */
+	Task *waitLast;
+	bool timedOut;/* Whether the last timed sleep expired */
+
+	void *fpuState;/* Save-area for the x87/SSE/AVX state, if used */
+	HAL::Processor *fpuCpu;/* Cpu on which the state was last loaded */
+
+	HAL::CpuSet affinity;/* Cpus on which the task is allowed to run */
+	unsigned long pinnedCpu;/* The only allowed cpu, or CPU_UNPINNED */
+
+	Mutex *blockedOn;/* Mutex on which the task is blocked */
+	Mutex *piHeld;/* Contended mutexes held, lending their waiters' priority */
+	Spinlock piLock;/* Serializes piHeld & the inherited priority */
+	unsigned long piBase;/* Urgency in its class, without inheritance */
+	bool piBoosted;/* Whether it runs at an inherited urgency */
+	unsigned long piClass;/* Own class, while boosted into another */
+	unsigned long piParams[SCHED_PARAMS];/* Own class-parameters, meanwhile */
+	bool piMoving;/* Whether a class-change is pending on its cpu */
+	unsigned long piMoveClass;/* Class into which it is to be moved */
+	unsigned long piMoveUrgency;/* Urgency to be set after the move */
+	unsigned long piMoveParams[SCHED_PARAMS];
+	Task *piMoveNext;/* Link in the move-list of its cpu */
+
 	void kill();
 	void sleep(Time waitPeriod);
-	void wakeup();
+	bool wait(WaitQueue *queue, Time timeout);
+	void prepareWait(WaitQueue *queue, Time timeout);
+	bool commitWait();
+	bool wakeup();
+	bool setAffinity(const HAL::CpuSet& cpus);
+	void getAffinity(HAL::CpuSet& cpus);
+
+	/* Pinned tasks are checked without looking at the bitmap */
+	bool allowedOn(unsigned long cpuId)
+	{
+		if(pinnedCpu != CPU_UNPINNED)
+			return (cpuId == pinnedCpu);
+
+		return (affinity.contains(cpuId));
+	}
 }; // 28/56 + 16/32 byte header for Executable::KTask
 
+void EnforceAffinity(HAL::Processor *cpu) kxhide;
+void ChangeClass(Task *task, unsigned long cls, const unsigned long *params,
+		unsigned long urgency) kxhide;
+void FlushClassChanges(HAL::Processor *cpu) kxhide;
+
 }
 
 decl_c void AddTaskToTimeout();// called ONLY ON boot-strap processor
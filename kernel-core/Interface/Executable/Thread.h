@@ -5,6 +5,7 @@
 #define EXECUTABLE_THREAD_H__
 
 #include <Executable/CPUStack.h>
+#include <Executable/ScheduleRoller.h>
 #include <Executable/Task.hpp>
 #include <Memory/Pager.h>
 #include <Synch/Spinlock.h>
@@ -80,7 +81,11 @@ extern Thread *kInitThread;
 Thread *KeGetThread(ID threadID);
 
 void InitTTable(void);
+void Idle();
 void SetupRunqueue();
-Thread* KThreadCreate(void *entry);
+Thread* KThreadCreate(void *entry,
+		Executable::ScheduleClass cls = Executable::ROUND_ROBIN);
+Thread* KCpuThreadCreate(void *entry,
+		Executable::ScheduleClass cls = Executable::ROUND_ROBIN);
 
 #endif/* Executable/Thread.h */
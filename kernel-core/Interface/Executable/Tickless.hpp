@@ -0,0 +1,42 @@
+/**
+ * @file Tickless.hpp
+ *
+ * When the local timers work in one-shot mode, each cpu programs its timer
+ * for the next time its scheduler must run - after a tick, if tasks share
+ * the cpu; after a longer interval, if one task runs alone; or only for a
+ * requested event (or never), if the cpu is idle.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#ifndef EXEC_TICKLESS_HPP__
+#define EXEC_TICKLESS_HPP__
+
+#include <HardwareAbstraction/LocalTimer.hpp>
+#include <HardwareAbstraction/Processor.h>
+
+//! Max. interval (in ms) b/w ticks, when one task runs alone on the cpu;
+//! load-tracking & balancing are done on these ticks.
+#define NOHZ_BUSY_DEFER 32
+
+namespace Executable
+{
+
+void ProgramTick(HAL::Processor *cpu) kxhide;
+void RequestTickAt(HAL::Processor *cpu, Time at);
+
+}
+
+#endif/* Executable/Tickless.hpp */
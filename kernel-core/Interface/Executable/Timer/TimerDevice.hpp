@@ -22,6 +22,7 @@
 #include "Time.hpp"
 #include "Event.hpp"
 #include <HardwareAbstraction/Processor.h>
+#include <Atomic.hpp>
 #include <TYPE.h>
 
 include_kobject(ExecMgr_TimerOperation) // rather stored in HardwareTimer.cpp
@@ -137,7 +138,7 @@ protected:
 	
 	/* Timers can set this internal property to communicate the current
 	   state of the object. */
-	unsigned int invocationMode;
+	Atomic<unsigned int> invocationMode;
 	unsigned int intId;
 	Lockable externalInvocationLock;
 	
@@ -164,7 +165,7 @@ protected:
 		if(newMode == TDIM_LOCKED)
 			externalInvocationLock.lock();
 
-		Atomic::xchg(newMode, &invocationMode);
+		invocationMode.exchange(newMode);
 
 		if(newMode == TDIM_EXTERNAL)
 			externalInvocationLock.unlock();
@@ -0,0 +1,82 @@
+/**
+ * @file WaitQueue.hpp
+ *
+ * Tasks which must wait for an event sleep on a wait-queue, off their
+ * runqueues, until the event is signalled (or their timeout expires). A
+ * woken task is put back on the runqueue of the cpu it slept on, keeping
+ * the parameters of its scheduling class.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#ifndef EXEC_WAIT_QUEUE_HPP__
+#define EXEC_WAIT_QUEUE_HPP__
+
+#include <Executable/Task.hpp>
+#include <Synch/Spinlock.h>
+
+//! Timeout for sleeping until woken up explicitly
+#define WAIT_FOREVER 0
+
+namespace Executable
+{
+
+/**
+ * Holds the tasks waiting for an event, in the order they went to sleep.
+ * Tasks are linked through their own wait-links, as a task is put on the
+ * queue before it leaves its runqueue.
+ *
+ * A task sleeps on the queue using <tt>sleepOn</tt>, and is woken up by
+ * <tt>wakeOne</tt> or <tt>wakeAll</tt>. A timed sleep ends when the timeout
+ * expires, if not woken up before that.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+class WaitQueue final
+{
+public:
+	WaitQueue();
+
+	unsigned long getCount()
+	{
+		return (count);
+	}
+
+	void sleepOn();
+	bool sleepOn(Time timeout);
+	Task *wakeOne();
+	unsigned long wakeAll();
+private:
+	Task *head;// task sleeping the longest
+	Task *tail;// task which went to sleep last
+	unsigned long count;// no. of tasks sleeping on this queue
+	Spinlock lock;
+
+	void add(Task *task);
+	void detach(Task *task);
+	void unlink(Task *task);
+
+	friend struct Task;
+	friend bool WakeupTask(Task *task, bool timedOut);
+};
+
+bool WakeupTask(Task *task, bool timedOut) kxhide;
+void FlushWakeups(HAL::Processor *cpu);
+
+}
+
+#endif/* Executable/WaitQueue.hpp */
@@ -0,0 +1,142 @@
+/**
+ * @file WorkQueue.hpp
+ *
+ * Work which can't be done in interrupt context (or which is too long to be
+ * done with interrupts disabled) is deferred to the work-queue of a cpu.
+ * Each cpu has a kernel worker-thread, bound to it, which runs the work
+ * queued on that cpu in order. Delayed work is held by the cpu until it
+ * expires, and then queued.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#ifndef EXEC_WORK_QUEUE_HPP__
+#define EXEC_WORK_QUEUE_HPP__
+
+#include <Executable/WaitQueue.hpp>
+
+namespace Executable
+{
+
+typedef void (*WorkFunction)(void *argument);
+
+class WorkQueue;
+
+enum WorkState
+{
+	WORK_IDLE = 0,//!< not queued (it may be running, though)
+	WORK_PENDING = 1,//!< queued, waiting for the worker-thread
+	WORK_DELAYED = 2//!< held until its fire-time, and then queued
+};
+
+//! The work was allocated by the work-queue, and is freed after it runs
+#define WORK_AUTOFREE (1 << 0)
+
+/**
+ * An item of deferred work. It is owned by the user, and can be queued again
+ * once it has started running. It must not be freed while it is pending or
+ * delayed; its function may free it, though, as the worker doesn't touch it
+ * after calling the function.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+struct Work
+{
+	Work *next;
+	Work *last;
+	WorkFunction function;
+	void *argument;
+	Time fireTime;// time (in ms) at which delayed work is queued
+	WorkQueue *queue;// queue on which the work was last queued
+	WorkQueue *owner;// queue holding the work, while pending or delayed
+	volatile unsigned long state;// WorkState
+	unsigned long flags;
+
+	void init(WorkFunction function, void *argument)
+	{
+		this->next = null;
+		this->last = null;
+		this->function = function;
+		this->argument = argument;
+		this->fireTime = 0;
+		this->queue = null;
+		this->owner = null;
+		this->state = WORK_IDLE;
+		this->flags = 0;
+	}
+};
+
+/**
+ * Per-cpu queue of deferred work, run by the worker-thread of the cpu. Work
+ * may be queued on any cpu from any context, including interrupt handlers.
+ * Each cpu has two queues - one for general work, and one for the bottom
+ * halves of interrupt handlers, whose worker is a real-time thread.
+ *
+ * The worker-thread is only woken up on its own cpu - directly, if the work
+ * is queued there; otherwise, by the scheduler or the IPI handler of that
+ * cpu. As the worker checks for work and goes to sleep with interrupts
+ * disabled, a wakeup can't be lost in b/w.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+class WorkQueue final
+{
+public:
+	static bool queueWork(HAL::Processor *cpu, Work *work);
+	static bool queueWork(HAL::Processor *cpu, WorkFunction function,
+			void *argument);
+	static bool queueDelayedWork(HAL::Processor *cpu, Work *work,
+			Time delay);
+	static bool queueIRQWork(HAL::Processor *cpu, Work *work);
+	static bool cancel(Work *work);
+	static void flush(Work *work);
+	static void flushAll(HAL::Processor *cpu);
+
+	static void init();
+	static void startWorker();
+
+	WorkQueue();
+
+	bool hasWork()
+	{
+		return (head != null || delayed != null);
+	}
+
+	void poll(HAL::Processor *cpu) kxhide;
+private:
+	Work *head;// oldest pending work
+	Work *tail;// newest pending work
+	Work *delayed;// delayed work, sorted by fire-time
+	Work *volatile current;// work being run by the worker-thread
+	Task *worker;// worker-thread of this cpu
+	WaitQueue flushers;// tasks waiting for work to finish
+	Spinlock lock;
+
+	void enqueue(Work *work);
+	void unlink(Work *work);
+	bool wakeWorker();
+	static bool queueOn(WorkQueue *queue, HAL::Processor *cpu, Work *work);
+	static void drain(WorkQueue *queue);
+	static void run();
+	static void runIRQ();
+};
+
+}
+
+#endif/* Executable/WorkQueue.hpp */
@@ -0,0 +1,129 @@
+/**
+ * @file CpuSet.hpp
+ *
+ * Sets of cpus, used for restricting tasks to some cpus (their affinity).
+ * Cpus are identified by their APIC IDs, as are their per-cpu structs.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#ifndef HAL_CPU_SET_HPP__
+#define HAL_CPU_SET_HPP__
+
+#include <TYPE.h>
+
+//! No. of cpus which can be held in a set (one for each xAPIC ID)
+#define CPUSET_MAX 256
+
+#define CPUSET_WORD_BITS (sizeof(unsigned long) * 8)
+#define CPUSET_WORDS (CPUSET_MAX / CPUSET_WORD_BITS)
+
+namespace HAL
+{
+
+/**
+ * Bitmap of cpus, indexed by their APIC IDs. Cpus are added atomically, so
+ * that a set can be built by many cpus at once (like <tt>onlineCpus</tt>);
+ * other operations must be serialized by the user.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+struct CpuSet
+{
+	unsigned long bits[CPUSET_WORDS];
+
+	void clear()
+	{
+		for(unsigned long idx = 0; idx < CPUSET_WORDS; idx++)
+			bits[idx] = 0;
+	}
+
+	void fill()
+	{
+		for(unsigned long idx = 0; idx < CPUSET_WORDS; idx++)
+			bits[idx] = ~0UL;
+	}
+
+	void add(unsigned long cpuId)
+	{
+		if(cpuId < CPUSET_MAX)
+			__sync_fetch_and_or(&bits[cpuId / CPUSET_WORD_BITS],
+					1UL << (cpuId % CPUSET_WORD_BITS));
+	}
+
+	void remove(unsigned long cpuId)
+	{
+		if(cpuId < CPUSET_MAX)
+			__sync_fetch_and_and(&bits[cpuId / CPUSET_WORD_BITS],
+					~(1UL << (cpuId % CPUSET_WORD_BITS)));
+	}
+
+	bool contains(unsigned long cpuId) const
+	{
+		return (cpuId < CPUSET_MAX && (bits[cpuId / CPUSET_WORD_BITS] >>
+				(cpuId % CPUSET_WORD_BITS)) & 1);
+	}
+
+	bool intersects(const CpuSet& other) const
+	{
+		for(unsigned long idx = 0; idx < CPUSET_WORDS; idx++)
+			if(bits[idx] & other.bits[idx])
+				return (true);
+
+		return (false);
+	}
+
+	unsigned long count() const
+	{
+		unsigned long cpus = 0;
+
+		for(unsigned long idx = 0; idx < CPUSET_WORDS; idx++)
+			cpus += __builtin_popcountl(bits[idx]);
+
+		return (cpus);
+	}
+
+	/* Gives the lowest cpu-id in the set after 'from', or CPUSET_MAX */
+	unsigned long next(unsigned long from) const
+	{
+		unsigned long word, rest;
+
+		for(unsigned long cpuId = from + 1; cpuId < CPUSET_MAX;
+				cpuId = (word + 1) * CPUSET_WORD_BITS)
+		{
+			word = cpuId / CPUSET_WORD_BITS;
+			rest = bits[word] >> (cpuId % CPUSET_WORD_BITS);
+
+			if(rest != 0)
+				return (cpuId + __builtin_ctzl(rest));
+		}
+
+		return (CPUSET_MAX);
+	}
+
+	unsigned long first() const
+	{
+		return ((bits[0] & 1) ? 0 : next(0));
+	}
+};
+
+//! Cpus which have been plugged into the topology
+extern CpuSet onlineCpus;
+
+}// namespace HAL
+
+#endif/* HAL/CpuSet.hpp */
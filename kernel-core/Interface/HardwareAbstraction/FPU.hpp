@@ -0,0 +1,90 @@
+/**
+ * @file FPU.hpp
+ *
+ * The extended-state of a task (x87, SSE & AVX registers) is switched
+ * lazily. On a context-switch, the state of the previous task is saved only
+ * if it used the FPU in its time-slice, and CR0.TS is set; the state of the
+ * next task is loaded on its first FPU instruction, when the #NM exception
+ * occurs. If the task's state is still loaded on the cpu, it isn't loaded
+ * again.
+ *
+ * Kernel code may use SIMD instructions in task context, but not in
+ * interrupt handlers.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#ifndef HAL_FPU_HPP__
+#define HAL_FPU_HPP__
+
+#include <TYPE.h>
+
+//! Components of the extended-state switched for tasks - x87, SSE & AVX
+#define XSTATE_SWITCHED 0x7
+
+//! Alignment of the save-areas, as required by XSAVE
+#define XSTATE_ALIGN 64
+
+namespace Executable { struct Task; }
+
+namespace HAL
+{
+
+struct Processor;
+
+/**
+ * Instructions used to save & restore the extended-state, chosen by the
+ * features of the boot-strap processor.
+ */
+enum FPUSaveMode
+{
+	FPU_NONE,// no FXSAVE; the state isn't switched
+	FPU_FXSAVE,// x87 & SSE state only, in 512 bytes
+	FPU_XSAVE,// all components enabled in XCR0, sized by CPUID leaf 0xD
+	FPU_XSAVEOPT// same, but only modified components are written
+};
+
+/**
+ * Switches the extended-state of tasks lazily, using CR0.TS and the #NM
+ * exception (device-not-available).
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+class FPU final
+{
+public:
+	static void init();
+	static void switchOut(Processor *cpu, Executable::Task *prev);
+	static void loadState(Processor *cpu);
+
+	static unsigned long getStateSize()
+	{
+		return (stateSize);
+	}
+private:
+	FPU();
+	static FPUSaveMode saveMode kxhide;
+	static unsigned long stateSize kxhide;// size of each task's save-area
+
+	static void *newState() kxhide;
+	static void save(void *state) kxhide;
+	static void restore(void *state) kxhide;
+};
+
+}// namespace HAL
+
+#endif/* HAL/FPU.hpp */
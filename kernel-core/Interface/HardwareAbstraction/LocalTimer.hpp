@@ -0,0 +1,74 @@
+/**
+ * @file LocalTimer.hpp
+ *
+ * The local timer is the per-cpu timer which invokes the scheduler. In the
+ * one-shot mode, it is programmed for the next event required on its cpu
+ * (instead of ticking periodically), and the system-time is read from a
+ * clock-source which is shared by all cpus.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#ifndef HAL_LOCAL_TIMER_HPP__
+#define HAL_LOCAL_TIMER_HPP__
+
+#include <Synch/SeqLock.hpp>
+#include <TYPE.h>
+
+//! Expiry of a local timer which has been stopped
+#define LOCAL_TIMER_NEVER ((Time) -1)
+
+//! Duration (in ms) for which the clock-source is calibrated
+#define LOCAL_TIMER_CALIBRATION 10
+
+/**
+ * Whether the local timers are used in one-shot mode. This requires a
+ * clock-source that runs at a constant rate on all cpus (the invariant
+ * TSC); otherwise, the timers tick periodically & the boot-strap cpu
+ * counts the system-time.
+ */
+extern bool oneShotTimerEnabled;
+
+namespace HAL
+{
+
+struct Processor;
+
+/**
+ * Programs the local timer of the current cpu & reads the system clock.
+ * Expiries are given as an absolute system-time, in milliseconds.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+class LocalTimer final
+{
+public:
+	static void calibrate();
+	static Time readClock();
+	static void fireAt(Processor *cpu, Time expiry);
+	static void kick(Processor *cpu);
+private:
+	LocalTimer();
+	static SeqLock clockLock kxhide;// guards the clock's base & rate
+	static U64 clockBase kxhide;// clock-source count at boot
+	static U32 clockRate kxhide;// clock-source counts in one ms
+	static U32 timerRate kxhide;// local timer counts in one ms
+};
+
+}// namespace HAL
+
+#endif/* HAL/LocalTimer.hpp */
@@ -27,10 +27,18 @@
 
 #include <IA32/APIC.h>
 #include <ACPI/MADT.h>
+#include <Executable/CompletelyFair.hpp>
+#include <Executable/RCU.hpp>
+#include <Executable/EarliestDeadline.hpp>
+#include <Executable/RealTime.hpp>
 #include <Executable/RoundRobin.h>
+#include <Executable/WorkQueue.hpp>
 #include <HardwareAbstraction/ProcessorTopology.hpp>
 #include <Memory/Internal/CacheRegister.h>
 #include <Memory/KMemorySpace.h>
+#include <Memory/KernelStack.hpp>
+#include <Synch/BigReaderLock.hpp>
+#include <Synch/MCSLock.hpp>
 #include <Synch/Spinlock.h>
 #include <Utils/AVLTree.hpp>
 #include <Utils/CircularList.h>
@@ -45,8 +53,13 @@ namespace Executable
 {
 	class ScheduleRoller;
 	class RoundRobin;
+	class CompletelyFair;
+	class RealTime;
+	class EarliestDeadline;
 }
 
+struct MemoryContext;
+
 extern U32 BSP_HID;
 
 // legacy
@@ -66,10 +79,19 @@ struct ScheduleInfo
 	unsigned long Load;
 	unsigned long RunnerPopulation;
 	Executable::ScheduleRoller *presRoll;// presently running schedule-roller
-	unsigned long CurrentQuanta;// quanta given to current runner
-	unsigned long RunnerInterruptable;// if task is pre-emptible
-	unsigned long LeftQuanta;// quanta left-over
+	unsigned long CurrentQuanta;// ticks b/w the last & next scheduler runs
+	volatile unsigned long preemptCount;// no preemption while non-zero (spinlocks held)
+	unsigned long LeftQuanta;// ticks left to skip (in KiClockRespond)
 	unsigned long FlagSet;// runtime flags
+	Time loadFoldTime;// next time to fold load-averages into domains
+	Time tickExpiry;// time at which the local timer fires (one-shot mode)
+	Time nextEvent;// earliest timed-event requested on this cpu
+	volatile unsigned long needResched;// run scheduler on next tick; wakes idle task
+	Executable::Task *wakeList;// tasks woken up by other cpus, to be requeued
+	Spinlock wakeLock;
+	Executable::Task *leaveList;// tasks switched out to move off this cpu
+	Executable::Task *moveList;// tasks to be moved into another class
+	Spinlock moveLock;
 } KSCHEDINFO;
 
 #ifdef NAMESPACE_MEMORY_MANAGER
@@ -165,14 +187,29 @@ struct Processor
 	CHREG pageCache[2];//! cache for kernel-memory pages
 	CHREG slabCache;//! cache for slabs
 	Spinlock PageLock;
-	Executable::ScheduleRoller *lschedTable[3];//! table for sched-classes
+	Executable::ScheduleRoller *lschedTable[Executable::SCHED_ROLLER_TYPES];//! table for sched-classes
 	Executable::RoundRobin rrsched;//! round-robin scheduler state
+	Executable::CompletelyFair cfsched;//! completely-fair scheduler state
+	Executable::RealTime rtsched;//! real-time scheduler state
+	Executable::EarliestDeadline dlsched;//! deadline scheduler state
 	void *IdlerThread;//! idle-task for this cpu
 	void *SetupThread;//! initialization thread for this cpu
+	Executable::Task *fpuOwner;//! task whose extended-state was last loaded
 	HAL::Domain *domlink;//! link to topology-tree
 	CircularList actionRequests;//! group of ipi-requests pending
 	Spinlock migrlock;//! migration lock for tasks
 	AVLTree timeoutTree;//! contains tasks sleeping until a specific time
+	Executable::WorkQueue workQueue;//! work deferred to this cpu's worker-thread
+	Executable::WorkQueue irqWorkQueue;//! bottom-halves of interrupt handlers
+	PageTableCache ptCache;//! zeroed page-table frames for this cpu
+	KernelStackCache stackCache;//! free kernel-stacks for new threads
+	unsigned long mcsUsed;//! bitmap of the queue nodes in use
+	MCSNode mcsNodes[MCS_NODES];//! queue nodes for MCS locks
+	volatile unsigned long brReaders[BR_LOCKS];//! readers in big-reader locks
+	Executable::RcuData rcu;//! callbacks & grace period seen by this cpu
+	volatile unsigned long tlbShootdown;//! set until this cpu flushes the range being shot down
+	volatile unsigned long polling;//! set while idle() monitors needResched with MWAIT
+	MemoryContext *activeSpace;//! address-space last loaded, if not the boot one
 	ArchCpu hw;//!< This contains information about the CPU which directly
 	 	   //!< directly depends on the platform. @see IA32/Processor.h
 };
@@ -193,6 +230,10 @@ class CPUDriver
 public:
 	static IPIRequest *readRequest(Processor *proc);
 	static void writeRequest(IPIRequest& state, Processor *proc);
+	static void idle(volatile unsigned long *wakeFlag);
+	static void wakeup(Processor *proc);
+	static void shootdown(unsigned long base, unsigned long pageCount);
+	static void acceptShootdown(Processor *proc) kxhide;
 };
 
 }// namespace HAL
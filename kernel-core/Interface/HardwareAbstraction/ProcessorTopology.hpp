@@ -33,6 +33,15 @@
 
 namespace HAL { struct Processor; }
 
+//! Migration cost (in ms) b/w SMT siblings, which share all caches
+#define MIGRATION_COST_SMT 0
+
+//! Migration cost (in ms) b/w cores of a package, which share the LLC
+#define MIGRATION_COST_CORE 2
+
+//! Migration cost (in ms) b/w packages (and clusters), which share nothing
+#define MIGRATION_COST_PACKAGE 8
+
 namespace HAL
 {
 
@@ -53,6 +62,32 @@ enum DomainType
 	LogicalProcessor = 1//!< LogicalProcessor - logical cpu for kernel
 };
 
+///
+/// Gives the time for which a task is assumed to be cache-hot, when it is
+/// to be migrated b/w the children of a domain at the given level. Levels
+/// are numbered as in ProcessorTopology::plug - 1 for a core (whose
+/// children are SMT siblings), 2 for a package, 3 for a cluster.
+///
+/// @param level - level of the domain across whose children the migration
+/// 			occurs
+/// @return - the migration cost (in ms)
+/// @version 1.0
+/// @since Silcos 3.05
+/// @author Shukant Pal
+///
+static inline Time MigrationCostOf(unsigned int level)
+{
+	switch (level) {
+	case 0:
+	case 1:
+		return (MIGRATION_COST_SMT);
+	case 2:
+		return (MIGRATION_COST_CORE);
+	default:
+		return (MIGRATION_COST_PACKAGE);
+	}
+}
+
 ///
 /// Represents a topological domain present in the system. It contains a list
 /// of child domains but only one parent. Each domain has its own state and
@@ -83,7 +118,8 @@ struct Domain
 	unsigned int level;
 	unsigned int type;
 	unsigned int cpuCount;
-	Executable::ScheduleDomain taskInfo[3];
+	Time migrationCost;// cache-hot period for tasks moving b/w children
+	Executable::ScheduleDomain taskInfo[Executable::SCHED_ROLLER_TYPES];
 	Spinlock queueLock;// Lock for executing balance-routine with this domain
 	Spinlock searchLock;// Serializing searches for direct child-domains for balancing
 	Spinlock lock;// for changes to domain data
@@ -95,6 +131,7 @@ struct Domain
 		this->level = 0;
 		this->type = 0;
 		this->cpuCount = 0;
+		this->migrationCost = MIGRATION_COST_PACKAGE;
 		SpinUnlock(&queueLock);
 		SpinUnlock(&searchLock);
 		SpinUnlock(&lock);
@@ -108,6 +145,7 @@ struct Domain
 		this->level = level;
 		this->type = type;
 		this->cpuCount = 0;
+		this->migrationCost = MigrationCostOf(level);
 		SpinUnlock(&queueLock);
 		SpinUnlock(&searchLock);
 		SpinUnlock(&lock);
@@ -140,9 +178,8 @@ public:
 
 	struct Iterator
 	{
-		static void toggleLoad(Processor *initialCPU,
-					Executable::ScheduleClass cls,
-					long mag);
+		static void foldLoad(Processor *cpu,
+					Executable::ScheduleClass cls);
 		static void ofEach(Processor *initialCPU,
 				void (*domainUpdater)(Domain *),
 				unsigned long limit);
@@ -161,6 +198,7 @@ struct DomainBinding
 	static Processor *getBusiest(Executable::ScheduleClass cls, Domain *pdom);
 	static Domain *findIdlestGroup(Executable::ScheduleClass cls, Domain *client);
 	static Domain *findBusiestGroup(Executable::ScheduleClass cls, Domain *client);
+	static Time migrationCost(Processor *from, Processor *to);
 private:
 	DomainBinding();
 };
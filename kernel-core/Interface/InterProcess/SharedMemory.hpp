@@ -0,0 +1,115 @@
+/**
+ * @file SharedMemory.hpp
+ *
+ * Shared-memory segments allow processes to exchange bulk data without
+ * copying it through the kernel. A segment is a set of page-frames that
+ * is mapped into the MemoryImage of each attached process as a
+ * MemorySection::Shared region.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#ifndef RSMGR_INTERPROCESS_SHARED_MEMORY_HPP__
+#define RSMGR_INTERPROCESS_SHARED_MEMORY_HPP__
+
+#include "IPC.h"
+#include <Memory/KObjectManager.h>
+#include <Process/MemoryImage.hpp>
+#include <Synch/Spinlock.h>
+#include <Utils/LinkedList.h>
+#include <Utils/RBTree.hpp>
+
+namespace InterProcess
+{
+
+/**
+ * Records the mapping of a shared-memory segment in one memory-image. A
+ * segment may be attached more than once in the same image, at different
+ * addresses.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+struct SharedMemoryAttachment
+{
+	LinkedListNode liLinker;
+	Process::MemoryImage *image;
+	unsigned long address;
+	PAGE_ATTRIBUTES permissions;
+};
+
+/**
+ * A shared-memory segment, identified by a key, which holds the page-frames
+ * mapped into each attached memory-image. The segment is reference-counted
+ * - the creator holds one reference and each attachment holds another -
+ * and its page-frames are freed only when the last reference is dropped.
+ *
+ * Permissions are page-granular. The creator specifies the maximum access
+ * allowed to the segment, and each attachment (or any range of pages in it)
+ * can then be restricted further using protect().
+ *
+ * All operations that map or unmap pages work in the current address-space,
+ * and hence the memory-image given must be the current one.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+class SharedMemory final
+{
+public:
+	IPC_HEADER header;
+	const unsigned long key;
+	const unsigned long pageCount;
+	const PAGE_ATTRIBUTES maxPermissions;
+
+	static SharedMemory *create(unsigned long key, unsigned long size,
+			PAGE_ATTRIBUTES permissions, unsigned long ipcFlags);
+	static SharedMemory *get(unsigned long key);
+	static void init();
+
+	unsigned long attach(Process::MemoryImage *image, unsigned long address,
+				PAGE_ATTRIBUTES permissions);
+	bool detach(Process::MemoryImage *image, unsigned long address);
+	bool protect(Process::MemoryImage *image, unsigned long address,
+			unsigned long pageCount, PAGE_ATTRIBUTES permissions);
+	void release();
+
+	inline unsigned long attachCount()
+	{
+		return (attachments.count);
+	}
+private:
+	PhysAddr *frames;
+	unsigned long refCount;
+	LinkedList attachments;
+	Spinlock lock;
+
+	SharedMemory(unsigned long key, unsigned long pageCount,
+			PAGE_ATTRIBUTES permissions);
+	~SharedMemory();
+
+	SharedMemoryAttachment *findAttachment(Process::MemoryImage *image,
+				unsigned long address, unsigned long pageOffset = 0);
+	void acquire();
+
+	static SharedMemory *reuse(SharedMemory *segment,
+			unsigned long pageCount, unsigned long ipcFlags);
+};
+
+}
+
+#endif/* InterProcess/SharedMemory.hpp */
@@ -132,6 +132,21 @@ unsigned long HighestBitSet(unsigned long x){
 	__sti					\
 }
 
+/*
+ * Like __no_interrupt_func, but interrupts are enabled on return only if
+ * they were enabled on entry; used by functions which are also called with
+ * interrupts disabled.
+ */
+#define __irq_save_func(fcode)			\
+{						\
+	unsigned long __eflags;			\
+	asm volatile("pushfl; popl %0; cli"	\
+			: "=r"(__eflags) : : "memory");	\
+	fcode					\
+	asm volatile("pushl %0; popfl"		\
+			: : "r"(__eflags) : "memory", "cc");	\
+}
+
 /*
  * This macro should be used on the function which return a named
  * variable or any constant. This ensures __sti is called before
@@ -35,6 +35,9 @@
 	#define KTHREAD_TABLE (KERNEL_OFFSET + MB(128))
 	#define KDYNAMIC (KERNEL_OFFSET + MB(256))
 	#define KFRAMEMAP (KERNEL_OFFSET + MB(768))
+	#define KVMALLOC (KERNEL_OFFSET + MB(832)) // Used in VirtualArea.cpp
+	#define KSCRATCH (KERNEL_OFFSET + MB(960)) // Per-cpu scratch pages
+	#define KSTACKS (KERNEL_OFFSET + MB(962)) // Thread kernel-stacks (KernelStack.cpp)
 	#define PSTACKTOP (KERNEL_OFFSET)
 	#define PSTACKSIZE (KB(8))
 
@@ -44,6 +47,8 @@
 
 	#define KDYNAMIC_LOWER (MB(32))
 	#define KDYNAMIC_UPPER (MB(512))
+	#define KVMALLOC_SIZE (MB(128))
+	#define KSTACKS_SIZE (MB(52))
 	#define KPGSIZE (KB(4))
 	#define KPGOFFSET 12
 
@@ -22,6 +22,7 @@
 #include "KFrameManager.h"
 #include "Pager.h"
 #include <Synch/Spinlock.h>
+#include <Synch/TicketLock.hpp>
 #include <TYPE.h>
 #include <Utils/AVLTree.hpp>
 #include <Utils/LinkedList.h>
@@ -74,7 +75,7 @@ struct ObjectInfo
 	Slab *emptySlab;
 	CircularList partialList;
 	CircularList fullList;
-	Spinlock lock;
+	TicketLock lock;
 
 	ObjectInfo() // @suppress("Class members should be properly initialized")
 	{
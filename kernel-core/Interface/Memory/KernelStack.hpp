@@ -0,0 +1,99 @@
+///
+/// @file KernelStack.hpp
+/// @module KernelHost
+///
+/// Kernel-stacks for threads are allocated from a dedicated window of the
+/// kernel address space (KSTACKS), in fixed slots. The lowest page of each
+/// slot is never mapped, so that a stack overflow faults on this guard page
+/// instead of corrupting the memory below it. Stacks stay mapped once they
+/// are created, and freed stacks are cached per-cpu for the next thread.
+/// -------------------------------------------------------------------
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>
+///
+/// Copyright (C) 2017 - Shukant Pal
+///
+
+#ifndef KERNHOST_MEMORY_KERNEL_STACK_HPP__
+#define KERNHOST_MEMORY_KERNEL_STACK_HPP__
+
+#include "KMemorySpace.h"
+#include <Synch/Spinlock.h>
+
+//! No. of pages in the kernel-stack of each thread
+#define KSTACK_PAGES 8
+#define KSTACK_SIZE (KSTACK_PAGES * KPGSIZE)
+
+//! Each slot holds a guard-page, followed by the stack
+#define KSTACK_SLOT_SIZE (KSTACK_SIZE + KPGSIZE)
+#define KSTACK_SLOTS (KSTACKS_SIZE / KSTACK_SLOT_SIZE)
+
+//! Max. no. of free stacks cached by each cpu
+#define KSTACK_CACHE_SIZE 8
+
+//! No. of stacks moved b/w a cpu's cache & the global pool at once
+#define KSTACK_BATCH (KSTACK_CACHE_SIZE / 2)
+
+///
+/// Per-cpu cache of free kernel-stacks, which are already mapped. It is
+/// only used in task context, with preemption disabled.
+///
+struct KernelStackCache
+{
+	unsigned long count;
+	unsigned long stacks[KSTACK_CACHE_SIZE];
+};
+
+namespace Memory
+{
+
+///
+/// Allocates kernel-stacks of KSTACK_SIZE bytes for threads. Stacks are
+/// taken from the cache of the current cpu, which is refilled in batches
+/// from the global pool of free stacks; only when both are empty, a new
+/// slot is mapped. Hence, creating & destroying threads doesn't usually
+/// touch the frame allocator.
+///
+/// @version 1.0
+/// @since Silcos 3.05
+/// @author Shukant Pal
+///
+class KernelStack final
+{
+public:
+	static unsigned long allocate();
+	static void free(unsigned long stack);
+
+	///
+	/// Tells whether the given address lies in the guard-page of some
+	/// kernel-stack, i.e. if a fault on it is due to a stack overflow.
+	///
+	static inline bool isGuardPage(unsigned long address)
+	{
+		return (address >= KSTACKS && address < KSTACKS + KSTACKS_SIZE &&
+			(address - KSTACKS) % KSTACK_SLOT_SIZE < KPGSIZE);
+	}
+private:
+	static unsigned long poolHead;// free stacks, linked by their first word
+	static unsigned long nextSlot;// first slot which was never mapped
+	static Spinlock poolLock;
+
+	static unsigned long create();
+	static void refill(KernelStackCache *cache);
+	static void drain(KernelStackCache *cache);
+	KernelStack();
+};
+
+}
+
+#endif/* Memory/KernelStack.hpp */
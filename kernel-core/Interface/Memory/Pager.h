@@ -85,6 +85,8 @@ public:
 
 	static void map(VirtAddr vadr, PhysAddr padr,
 			unsigned allocFlags, PageAttributes attr);
+	static void protect(VirtAddr base, VirtAddr limit,
+			PageAttributes attr);
 	static void mapHuge(VirtAddr vadr, PhysAddr padr,
 			unsigned allocFlags, PageAttributes attr);
 	static void mapAll(VirtAddr base, PhysAddr pbase, unsigned size,
@@ -99,6 +101,9 @@ public:
 			PageAttributes attr);
 	static void useAll(VirtAddr base, VirtAddr limit,
 			unsigned allocFlags, PageAttributes attr);
+	static PhysAddr translate(VirtAddr vadr);
+	static bool promote(VirtAddr hugeBase, unsigned allocFlags);
+	static bool isPromoting(VirtAddr vadr);
 
 	static U64 *globalDirectory;
 	static U64 *globalTable;
@@ -0,0 +1,80 @@
+///
+/// @file VirtualArea.hpp
+/// @module KernelHost
+///
+/// Virtual areas are blocks of kernel memory which are contiguous only in
+/// the virtual address space. They are backed by individual page-frames,
+/// and hence large allocations don't depend on physically contiguous
+/// high-order blocks being available. All areas are placed in a dedicated
+/// window of the kernel address space (KVMALLOC).
+/// -------------------------------------------------------------------
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>
+///
+/// Copyright (C) 2017 - Shukant Pal
+///
+
+#ifndef KERNHOST_MEMORY_VIRTUAL_AREA_HPP__
+#define KERNHOST_MEMORY_VIRTUAL_AREA_HPP__
+
+#include "KMemorySpace.h"
+#include <Utils/LinkedList.h>
+
+//! Leave an unmapped guard-page after the area, to catch overflows
+#define VM_GUARD	(1 << 0)
+
+//! Don't turn on interrupts while allocating page-frames for the area
+#define VM_NOINTR	(1 << 1)
+
+namespace Memory
+{
+
+///
+/// Describes a range of pages in the KVMALLOC window. Allocated areas are
+/// kept in a red-black tree keyed by their base address, while the free
+/// ranges are kept in an address-sorted list which is searched first-fit.
+///
+/// @version 1.0
+/// @since Silcos 3.05
+/// @author Shukant Pal
+///
+struct VirtualArea
+{
+	LinkedListNode liLinker;/* Link in the free-range list */
+	unsigned long base;/* First address in the range */
+	unsigned long pageCount;/* No. of pages mapped in the area */
+	unsigned long spanCount;/* No. of pages reserved (including guard) */
+	unsigned long vmFlags;/* Flags the area was allocated with */
+};
+
+}
+
+void *vmalloc(unsigned long size, unsigned long vmFlags = VM_GUARD);
+bool vfree(void *vmem);
+unsigned long vsize(const void *vmem);
+
+///
+/// Tells whether the given memory lies in the virtual-area window, and
+/// hence should be freed using vfree().
+///
+/// @param memory - pointer to kernel memory
+///
+static inline bool isVirtualArea(const void *memory)
+{
+	return ((unsigned long) memory >= KVMALLOC &&
+			(unsigned long) memory < KVMALLOC + KVMALLOC_SIZE);
+}
+
+decl_c void SetupVirtualAreas();
+
+#endif/* Memory/VirtualArea.hpp */
@@ -24,6 +24,7 @@
 #define NAMESPACE_HPP_
 
 #include <Object.hpp>
+#include <Synch/BigReaderLock.hpp>
 #include <Utils/LinkedList.h>
 
 namespace Module
@@ -51,24 +52,30 @@ public:
 
 	Namespace *create(const char *name)
 	{
-		if (searchOnly(name, strlen(name)) == null) {
-			Namespace *newChild = new Namespace(name, this);
+		Namespace *newChild = null;
+
+		nsTreeLock.enterAsWriter();
+		if (findChild(name, strlen(name)) == null) {
+			newChild = new Namespace(name, this);
 			AddElement(newChild, &nsChildSet);
-			return (newChild);
-		} else {
-			return (null);
 		}
+		nsTreeLock.exitAsWriter();
+
+		return (newChild);
 	}
 
 	Namespace *create(const char *fromFile, const char *name)
 	{
-		if (searchOnly(name, strlen(name)) == null) {
-			Namespace *newChild = new Namespace(fromFile, name, this);
+		Namespace *newChild = null;
+
+		nsTreeLock.enterAsWriter();
+		if (findChild(name, strlen(name)) == null) {
+			newChild = new Namespace(fromFile, name, this);
 			AddElement(newChild, &nsChildSet);
-			return (newChild);
-		} else {
-			return (null);
 		}
+		nsTreeLock.exitAsWriter();
+
+		return (newChild);
 	}
 
 	Namespace *searchOnly(const char *dChildIdentBuffer, unsigned bytes);
@@ -90,10 +97,15 @@ protected:
 
 	void addToParent()
 	{
+		nsTreeLock.enterAsWriter();
 		AddElement(this, &nsOwner->nsChildSet);
+		nsTreeLock.exitAsWriter();
 	}
 private:
 	static Namespace nsRoot;
+	static BigReaderLock nsTreeLock;// guards the child-sets of the tree
+
+	Namespace *findChild(const char *dChildIdentBuffer, unsigned bytes);
 	Namespace();
 };
 
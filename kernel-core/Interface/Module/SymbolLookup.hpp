@@ -25,7 +25,7 @@
 #define KERNHOST_MODULE_SYMBOLLOOKUP_HPP_
 
 #include "Elf/ELF.h"
-#include <Synch/ReadWriteSerializer.h>
+#include <Synch/BigReaderLock.hpp>
 
 namespace Module
 {
@@ -80,7 +80,7 @@ private:
 	unsigned long currentThreshold;
 	unsigned long totalSymbols;
 	SymbolicDefinition **lookupBuckets;
-	ReadWriteSerializer rwl;
+	BigReaderLock rwl;
 	bool addDirect(unsigned long address, SymbolType type,
 			unsigned char *name, ModuleContainer *mcont);
 	void ensureCapacity(unsigned long newSize);
@@ -19,10 +19,14 @@
 #ifndef MEMORYIMAGE_HPP_
 #define MEMORYIMAGE_HPP_
 
+#include <Executable/WorkQueue.hpp>
 #include <Memory/KObjectManager.h>
 #include <Resource/ContextManager.hpp>
 #include <Utils/RBTree.hpp>
 
+//! Time (in ms) b/w two collapse passes over an image
+#define THP_COLLAPSE_INTERVAL 1000
+
 extern ObjectInfo *tProcess_MemoryImage;
 
 namespace Process
@@ -32,14 +36,18 @@ namespace Process
  * Class: MemoryImage
  *
  * Summary:
- * Manages the address-space for a general process and uses a faster-BST when
- * the number of regions exceeds a limit.
+ * Manages the address-space for a general process, keeping its regions in
+ * a sorted chain along with a red-black tree for O(log n) lookups.
  *
  * Function:
  * getImage - create a fresh image
  * deleteImage - try to dispose a address-space
  * findRegion - get the region containing a specific address
  * carveRegion - carve a child region from a larger region
+ * populateRegion - map a region, using huge-pages where possible
+ * collapseHugeRegions - promote populated 2-MB blocks to huge-pages
+ * startCollapsing - run the collapse pass periodically on a cpu
+ * stopCollapsing - stop the periodic collapse pass
  * MemoryImage - ctor for this
  *
  * Version: 1.2
@@ -56,7 +64,13 @@ public:
 
 	unsigned long includeInRegion(unsigned long initialAddress, unsigned long addressExtension);
 
-	Resource::MemorySection* validateRegion(unsigned long address);
+	void populateRegion(Resource::MemorySection *arena, unsigned long allocFlags);
+
+	unsigned long collapseHugeRegions(unsigned long allocFlags);
+
+	void startCollapsing(HAL::Processor *cpu, MemoryContext *space);
+
+	void stopCollapsing();
 
 	static MemoryImage* getImage();
 
@@ -67,15 +81,15 @@ public:
 
 	static void init();
 
-	inline void dub()
-	{
-		arenaTree->_dub();
-	}
-
 protected:
 	unsigned long pinnedPages;
 	unsigned long libraryCount;
+	unsigned long hugePages;// No. of 2-MB blocks mapped as huge-pages
 	unsigned long filterTable[8];// Keep track of count of all pages
+	Executable::Work collapser;// Periodic collapse pass
+	HAL::Processor *collapserCpu;// Cpu on which the collapser runs
+	MemoryContext *space;// Address-space in which the regions are mapped
+	volatile bool collapsing;// Whether the collapser should be re-queued
 
 	MemoryImage();
 	MemoryImage(unsigned long code[2], unsigned long data[2],
@@ -86,6 +100,18 @@ protected:
 	{
 		return (filterTable);
 	}
+
+	static void runCollapser(void *image);
+
+	/* Only anonymous regions large enough to hold a huge-page are backed
+	   transparently by huge-pages. */
+	static inline bool isHugeEligible(Resource::MemorySection *arena)
+	{
+		return ((arena->typeId == Resource::MemorySection::Heap ||
+				arena->typeId == Resource::MemorySection::BSS) &&
+				!(arena->ctlFlags & Resource::MemorySection::NoHugePages) &&
+				arena->pageCount >= 512);
+	}
 };
 
 }
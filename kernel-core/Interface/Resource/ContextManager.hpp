@@ -34,6 +34,7 @@
 #include <Memory/Pager.h>
 #include <Memory/KObjectManager.h>
 #include <Resource/MemorySection.hpp>
+#include <Utils/RBTree.hpp>
 
 namespace Resource
 {
@@ -121,7 +122,7 @@ public:
 //	virtual unsigned long includeInRegion(unsigned long initialAddress,
 //			unsigned long addressExtension) = 0;
 
-//	virtual MemorySection* validateRegion(unsigned long address) = 0;
+	virtual MemorySection* validateRegion(unsigned long address);
 
 	void printAll();
 protected:
@@ -133,7 +134,6 @@ protected:
 	unsigned long referCount;
 	unsigned long regionCount;
 
-	bool treePopulated;
 	MemorySection *firstArena;
 	MemorySection *lastArena;
 	RBTree *arenaTree;
@@ -144,10 +144,11 @@ protected:
 	RegionInsertionResult add(MemorySection *sec);
 	void carve(MemorySection *arena, unsigned long iaddr, unsigned long faddr);
 	void split(MemorySection *arena, unsigned long laddr, unsigned long raddr);
-	bool populateTree();
+	MemorySection *findArena(unsigned long address);
 	void remove(MemorySection *sec);
 	unsigned long removeAll(MemorySection *from, MemorySection *till,
-					unsigned short typeId, unsigned long &pageCount);
+					unsigned short typeId, unsigned long &pageCount,
+					MemorySection *&removed);
 
 	virtual unsigned long * getIDFilter()
 	{
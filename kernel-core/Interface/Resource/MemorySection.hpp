@@ -70,6 +70,12 @@ struct MemorySection
 		Boundary = 0x8
 	};
 
+	enum Control
+	{
+		NoHugePages = 0x1,// Never back this region with huge-pages
+		Populate = 0x2// Map all the pages when the region is inserted
+	};
+
 	MemorySection *next;
 	MemorySection *last;
 	unsigned long initialAddress;// Initial address of region (modulo 4-8k)
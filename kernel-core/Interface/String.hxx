@@ -31,6 +31,7 @@
 #ifndef __MDFRWK_STRING_HXX__
 #define __MDFRWK_STRING_HXX__
 
+#include <Atomic.hpp>
 #include <Memory/KObjectManager.h>
 #include <TYPE.h>
 #include "Object.hpp"
@@ -128,7 +129,7 @@ private:
 	unsigned int offset;// Offset from kmalloc-source to this value
 	StringPool *ownerPool;// Pool of strings in which this is registered, if any
 	unsigned int hash;// Cache of hash, nice rhyme
-	unsigned int referCount;// No. of references to this string
+	Atomic<unsigned int> referCount;// No. of references to this string
 	const char *source;// kmalloc-Source of memory for this value
 	const char *value;// Sequence of characters of this string
 
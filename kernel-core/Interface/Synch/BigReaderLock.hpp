@@ -0,0 +1,63 @@
+///
+/// @file BigReaderLock.hpp
+/// @module KernelHost
+///
+/// Per-cpu reader-writer lock, for data that is looked up on all cpus and
+/// rarely changed. Readers only touch a counter of their own cpu, and so
+/// they don't bounce any cache line b/w cpus; writers pay by sweeping the
+/// counters of all cpus.
+/// -------------------------------------------------------------------
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>
+///
+/// Copyright (C) 2017 - Shukant Pal
+///
+
+#ifndef SYNCH__BIG_READER_LOCK_HPP__
+#define SYNCH__BIG_READER_LOCK_HPP__
+
+#include "Spinlock.h"
+
+//! No. of big-reader locks that can exist, as each has a counter in every
+//! cpu's data
+#define BR_LOCKS 8
+
+///
+/// The reader counters live in the Processor struct (brReaders), and a
+/// lock is given its slot there on first use. Readers run with preemption
+/// disabled, and must not sleep; they may nest, but a reader can't become
+/// a writer. Writers exclude each other with a spinlock, and then wait
+/// until no cpu has a reader inside.
+///
+/// Before the per-cpu data is set up only the BSP runs, and so readers
+/// aren't counted then. An all-zero lock is unlocked.
+///
+/// @version 1.0
+/// @since Silcos 3.05
+/// @author Shukant Pal
+///
+struct BigReaderLock
+{
+	volatile unsigned long slot;// index of the reader counters + 1
+	volatile unsigned long writing;// set while a writer is inside
+	Spinlock writer;
+
+	constexpr BigReaderLock() : slot(0), writing(0), writer(0) {}
+
+	void enterAsReader();
+	void exitAsReader();
+	void enterAsWriter();
+	void exitAsWriter();
+};
+
+#endif/* Synch/BigReaderLock.hpp */
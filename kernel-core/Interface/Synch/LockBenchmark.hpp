@@ -0,0 +1,37 @@
+///
+/// @file LockBenchmark.hpp
+/// @module ExecutionManager
+///
+/// Measures the throughput of the spinlock types under contention from all
+/// online cpus. It is built into the kernel, but only run at boot if the
+/// kernel is compiled with LOCK_BENCHMARK defined.
+/// -------------------------------------------------------------------
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>
+///
+/// Copyright (C) 2017 - Shukant Pal
+///
+
+#ifndef SYNCH__LOCK_BENCHMARK_HPP__
+#define SYNCH__LOCK_BENCHMARK_HPP__
+
+//! No. of times each cpu takes the lock being measured
+#define LOCK_BENCH_ROUNDS 100000
+
+//! Time (in ms) given to the APs to come online, before the benchmark runs
+#define LOCK_BENCH_DELAY 1000
+
+void RunLockBenchmark();
+void LockBenchmarkThread();
+
+#endif/* Synch/LockBenchmark.hpp */
@@ -0,0 +1,70 @@
+///
+/// @file MCSLock.hpp
+/// @module KernelHost
+///
+/// Queued spinlock (Mellor-Crummey & Scott), for locks contended by many
+/// cpus. Each waiter spins on its own queue node, and so the lock's cache
+/// line isn't bounced b/w the waiters. It has the same interface as the
+/// Spinlock.
+/// -------------------------------------------------------------------
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>
+///
+/// Copyright (C) 2017 - Shukant Pal
+///
+
+#ifndef SYNCH__MCS_LOCK_HPP__
+#define SYNCH__MCS_LOCK_HPP__
+
+#include "Spinlock.h"
+
+//! Max. no. of MCS locks a cpu can hold (or wait for) at once, including
+//! those taken by interrupt handlers
+#define MCS_NODES 4
+
+//! Queue nodes are kept on separate cache lines
+#define MCS_NODE_ALIGN 64
+
+///
+/// Entry of a waiter in the queue of a MCS lock. Nodes are per-cpu, and a
+/// node is held from the time its cpu starts waiting for the lock until it
+/// unlocks it.
+///
+struct MCSNode
+{
+	MCSNode *volatile next;// waiter queued after this one
+	volatile unsigned long locked;// cleared when this waiter is served
+} __attribute__((aligned(MCS_NODE_ALIGN)));
+
+///
+/// The lock holds the tail of its queue of waiters - the holder's node is
+/// at the head, and is kept in the lock as the unlocking cpu needs it. An
+/// all-zero lock is unlocked.
+///
+/// @version 1.0
+/// @since Silcos 3.05
+/// @author Shukant Pal
+///
+struct MCSLock
+{
+	MCSNode *volatile tail;// last waiter, or the holder if none wait
+	MCSNode *holder;// node of the holder, written only by it
+
+	constexpr MCSLock() : tail(0), holder(0) {}
+};
+
+void SpinLock(MCSLock *lock);
+void SpinUnlock(MCSLock *lock);
+bool TestLock(MCSLock *lock);
+
+#endif/* Synch/MCSLock.hpp */
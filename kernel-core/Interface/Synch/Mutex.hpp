@@ -0,0 +1,98 @@
+///
+/// @file Mutex.hpp
+/// @module ExecutionManager
+///
+/// Sleeping lock for long critical sections, in task context. Unlike a
+/// spinlock, a contended mutex doesn't keep other cpus busy - its waiters
+/// spin only while the owner is running, and sleep otherwise.
+/// -------------------------------------------------------------------
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>
+///
+/// Copyright (C) 2017 - Shukant Pal
+///
+
+#ifndef SYNCH__MUTEX_HPP__
+#define SYNCH__MUTEX_HPP__
+
+#include "Spinlock.h"
+#include <Executable/Task.hpp>
+
+//! Set in the owner-word while tasks are sleeping on the mutex
+#define MUTEX_WAITERS 1
+
+//! Max. iterations for which a locker spins on a running owner
+#define MUTEX_SPIN_MAX 4096
+
+///
+/// Mutual-exclusion lock whose waiters sleep, ordered by their scheduling
+/// class & priority. On unlock, the mutex is handed over directly to the
+/// most urgent waiter.
+///
+/// Lockers first spin while the owner is running on another cpu, as it
+/// will probably unlock soon; they sleep once it is switched out, or if
+/// the spin takes too long.
+///
+/// A sleeping waiter lends its priority to the owner until the owner
+/// unlocks the mutex. An owner in a lower class is moved into the waiter's
+/// class for that time (see ChangeClass); in the same class, it takes the
+/// waiter's urgency (see ScheduleRoller::setUrgency). The priority is not
+/// passed on further, when the owner itself is blocked on another mutex.
+///
+/// An all-zero mutex is unlocked, so mutexes with static storage need no
+/// constructor. It must only be used by tasks - not in interrupt handlers,
+/// or with interrupts disabled.
+///
+/// @version 1.0
+/// @since Silcos 3.05
+/// @author Shukant Pal
+///
+class Mutex final
+{
+public:
+	Mutex()
+	{
+		ownerWord = 0;
+		waiters = null;
+		piNext = null;
+		topClass = 0;
+		topUrgency = 0;
+		waitLock = 0;
+	}
+
+	void lock();
+	bool tryLock();
+	void unlock();
+
+	Executable::Task *getOwner()
+	{
+		return ((Executable::Task*) (ownerWord & ~MUTEX_WAITERS));
+	}
+private:
+	volatile unsigned long ownerWord;// owning task, and MUTEX_WAITERS
+	Executable::Task *waiters;// sleeping tasks, most urgent first
+	Mutex *piNext;// next contended mutex held by the owner
+	unsigned long topClass;// scheduling class of the first waiter
+	unsigned long topUrgency;// urgency of the first waiter
+	Spinlock waitLock;
+
+	bool spinOnOwner(Executable::Task *self);
+	void addWaiter(Executable::Task *waiter);
+	Executable::Task *takeWaiter();
+	void refreshTop();
+	void lendPriority(Executable::Task *owner);
+	void attachTo(Executable::Task *owner);
+	void detachFrom(Executable::Task *owner);
+};
+
+#endif/* Synch/Mutex.hpp */
@@ -34,7 +34,9 @@
 /// means it won't miss anything :-)
 ///
 /// This type of lock is available in non-preemptive environments and is
-/// optimized when writers are minimal.
+/// optimized when writers are minimal. As every reader takes the internal
+/// spinlock, readers still serialize across cpus - read-mostly data should
+/// use the SeqLock or the BigReaderLock instead.
 ///
 /// @version 1.0
 /// @since Silcos 3.02
@@ -42,13 +44,11 @@
 ///
 struct ReadWriteSerializer
 {
-	unsigned long onlineReaders;
+	Atomic<unsigned long> onlineReaders;
 	Spinlock criticalSection;
 
-	ReadWriteSerializer()
+	ReadWriteSerializer() : criticalSection(0)
 	{
-		(void) Atomic::xchg(0, &onlineReaders);
-		(void) Atomic::xchg(0, (unsigned long*) &criticalSection);
 	}
 
 	~ReadWriteSerializer()
@@ -60,7 +60,7 @@ struct ReadWriteSerializer
 	void enterAsReader()
 	{
 		SpinLock(&criticalSection);
-		Atomic::inc(&onlineReaders);
+		onlineReaders.fetchAdd(1, MEMORY_ACQUIRE);
 		SpinUnlock(&criticalSection);
 	}
 
@@ -73,7 +73,7 @@ struct ReadWriteSerializer
 
 	void exitAsReader()
 	{
-		Atomic::dec(&onlineReaders);
+		onlineReaders.fetchSub(1, MEMORY_RELEASE);
 	}
 
 	void exitAsWriter()
@@ -0,0 +1,89 @@
+///
+/// @file SeqLock.hpp
+///
+/// Sequence lock, for small data which is read far more often than it is
+/// written. Readers never write to the lock - they retry if a writer ran
+/// while they were reading.
+/// -------------------------------------------------------------------
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>
+///
+/// Copyright (C) 2017 - Shukant Pal
+///
+
+#ifndef SYNCH__SEQ_LOCK_HPP__
+#define SYNCH__SEQ_LOCK_HPP__
+
+#include "Spinlock.h"
+
+///
+/// Writers serialize on a spinlock and bump the sequence before & after
+/// updating the data, so that it is odd while they run. A reader copies
+/// the data b/w readBegin() and readRetry(), and retries if the sequence
+/// changed. As readers may see torn data, they must only copy it, and not
+/// follow pointers in it.
+///
+///	do {
+///		seq = lock.readBegin();
+///		copy = data;
+///	} while(lock.readRetry(seq));
+///
+/// If the data is read in interrupt handlers, writers must disable
+/// interrupts; otherwise, a reader interrupting the writer on its own cpu
+/// would spin forever. An all-zero lock is unlocked.
+///
+/// @version 1.0
+/// @since Silcos 3.05
+/// @author Shukant Pal
+///
+struct SeqLock
+{
+	volatile unsigned long sequence;// odd while a writer is updating
+	Spinlock writer;
+
+	constexpr SeqLock() : sequence(0), writer(0) {}
+
+	inline unsigned long readBegin()
+	{
+		unsigned long seq;
+
+		while((seq = sequence) & 1)
+			asm volatile("pause");
+
+		/* x86 doesn't reorder loads with loads - only stop gcc */
+		asm volatile("" : : : "memory");
+		return (seq);
+	}
+
+	inline bool readRetry(unsigned long seq)
+	{
+		asm volatile("" : : : "memory");
+		return (sequence != seq);
+	}
+
+	inline void enterAsWriter()
+	{
+		SpinLock(&writer);
+		sequence = sequence + 1;
+		asm volatile("" : : : "memory");
+	}
+
+	inline void exitAsWriter()
+	{
+		asm volatile("" : : : "memory");
+		sequence = sequence + 1;
+		SpinUnlock(&writer);
+	}
+};
+
+#endif/* Synch/SeqLock.hpp */
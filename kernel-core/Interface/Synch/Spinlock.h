@@ -16,19 +16,30 @@
 
 typedef volatile unsigned int Spinlock;
 
+/*
+ * Kernel code is preempted by the timer interrupt only while the preemption
+ * count of its cpu is zero. Holding a spinlock keeps it non-zero - SpinLock
+ * and a successful TestLock count it up, and SpinUnlock counts it down. Data
+ * private to a cpu, which isn't touched by interrupt handlers, can be guarded
+ * by disabling preemption alone.
+ */
+extern "C" void PreemptDisable();
+extern "C" void PreemptEnable();
+
 extern "C" void SpinLock(volatile Spinlock *);
 extern "C" void SpinUnlock(volatile Spinlock *);
+extern "C" bool TestLock(volatile Spinlock *);
 
-static inline bool TestLock(volatile Spinlock *sl)
-{
-	return __sync_bool_compare_and_swap(sl, 0 ,1);
-}
+#define __no_preemption(fcode)	\
+	PreemptDisable();	\
+	fcode			\
+	PreemptEnable();
 
 class Lockable
 {
 public:
 	Lockable() {
-		SpinUnlock(&__lockstatus);
+		__lockstatus = 0;
 	}
 
 	inline void lock() {
@@ -0,0 +1,94 @@
+///
+/// @file TicketLock.hpp
+///
+/// Fair spinlock, which serves lockers in the order in which they arrive. It
+/// has the same interface as the Spinlock, so that a hot lock is switched by
+/// only changing its type.
+/// -------------------------------------------------------------------
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>
+///
+/// Copyright (C) 2017 - Shukant Pal
+///
+
+#ifndef SYNCH__TICKET_LOCK_HPP__
+#define SYNCH__TICKET_LOCK_HPP__
+
+#include "Spinlock.h"
+
+///
+/// Each locker takes the next ticket, and waits until it is served. Unlike
+/// the test-and-set Spinlock, waiters only read the lock while spinning, and
+/// no waiter can be starved by others. It is as large as a Spinlock, and an
+/// all-zero lock is unlocked.
+///
+/// @version 1.0
+/// @since Silcos 3.05
+/// @author Shukant Pal
+///
+struct TicketLock
+{
+	union
+	{
+		volatile unsigned long word;
+		struct
+		{
+			volatile unsigned short owner;// ticket being served
+			volatile unsigned short next;// ticket for the next locker
+		};
+	};
+
+	constexpr TicketLock() : word(0) {}
+};
+
+#define TICKET_NEXT (1UL << 16)
+
+static inline void SpinLock(TicketLock *lock)
+{
+	PreemptDisable();
+
+	unsigned short ticket = (unsigned short)
+			(__sync_fetch_and_add(&lock->word, TICKET_NEXT) >> 16);
+
+	while(lock->owner != ticket)
+		asm volatile("pause");
+
+	asm volatile("" : : : "memory");
+}
+
+static inline void SpinUnlock(TicketLock *lock)
+{
+	asm volatile("" : : : "memory");
+
+	/* Only the holder writes the owner, and so no locked op is needed */
+	lock->owner = lock->owner + 1;
+
+	PreemptEnable();
+}
+
+static inline bool TestLock(TicketLock *lock)
+{
+	PreemptDisable();
+
+	unsigned long word = lock->word;
+
+	if((word & 0xFFFF) == (word >> 16) &&
+			__sync_bool_compare_and_swap(&lock->word, word,
+					word + TICKET_NEXT))
+		return (true);
+
+	PreemptEnable();
+	return (false);
+}
+
+#endif/* Synch/TicketLock.hpp */
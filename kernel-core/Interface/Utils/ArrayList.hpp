@@ -19,7 +19,9 @@
 #ifndef MDFRWK_LIST_HPP__
 #define MDFRWK_LIST_HPP__
 
+#include <Atomic.hpp>
 #include <Synch/Spinlock.h>
+#include <Synch/TicketLock.hpp>
 #include <TYPE.h>
 
 struct LinkedList;
@@ -69,11 +71,11 @@ public:
 	ArrayList *subList(unsigned long start, unsigned long end);
 	void trimToSize();
 
-	Spinlock modl;
+	TicketLock modl;
 private:
 	unsigned long size;
 	unsigned long capacity;
-	unsigned long changeCount;
+	Atomic<unsigned long> changeCount;
 	void **elemData;
 	bool isValidIndex(unsigned long idx){ return (idx < size); }
 	void removeAt(unsigned long idx);
@@ -193,6 +193,7 @@ public:
 	void* getLowerBoundFor(unsigned long key);
 	void* getUpperBoundFor(unsigned long key);
 	void* getClosestOf(unsigned long key);
+	void* getMinimum();
 	void* getMaximum();
 
 	//virtual String& toString();
@@ -39,6 +39,7 @@
 #include <Memory/KMemoryManager.h>
 #include <Memory/KMemorySpace.h>
 #include <Memory/KObjectManager.h>
+#include <Memory/VirtualArea.hpp>
 #include <Module/ModuleLoader.h>
 #include <Module/Elf/ElfAnalyzer.hpp>
 #include <Module/SymbolLookup.hpp>
@@ -266,6 +267,7 @@ export_asm void Main(ulong bootTable, ulong bootKernelBase,
 	obSetupAllocator();
 	SetupPrimitiveObjects();
 	__initHeap();
+	SetupVirtualAreas();
 	MdSetupLoader();
 
 	ImportLinkerRaw(pmoduleEntries);
@@ -19,26 +19,119 @@ SwitchPaging:
 	MOV CR3, ECX
 	RET
 
+;
+; Spinlocks disable preemption on the current cpu while they are held, by
+; counting crolStatus.preemptCount in its cpu-struct up & down. The cpu-struct
+; isn't mapped until the BSP is setup (oballocNormaleUse), and no count is
+; kept before that.
+;
+		extern VAPICBase
+		extern oballocNormaleUse
+		extern oneShotTimerEnabled
+
+		; loads the address of the current cpu-struct in EAX, or 0
+		KiCurrentCpu:
+			XOR EAX, EAX
+			CMP BYTE [oballocNormaleUse], 0
+			JE KiCurrentCpuOver
+			MOV EAX, [VAPICBase]
+			MOV EAX, [EAX + 0x20]			; load PROCESSOR_ID << 24
+			SHR EAX, 24
+			SHL EAX, 15				; get the offset of the cpu-struct (32-kb)
+			ADD EAX, 0xc0000000 + 20 * 1024 * 1024
+		KiCurrentCpuOver:
+			RET
+
+		global PreemptDisable
+		PreemptDisable:
+			PUSHFD					; the task must not move b/w
+			CLI					; reading the cpu & counting
+			PUSH EAX
+			CALL KiCurrentCpu
+			TEST EAX, EAX
+			JZ PreemptDisableOver
+			INC DWORD [EAX + 32 + 16]		; crolStatus.preemptCount++
+			PreemptDisableOver:
+			POP EAX
+			POPFD
+			RET
+
+		;
+		; no task-switch can happen while the count is non-zero, and so the
+		; cpu doesn't change b/w reading it & counting down. on the final
+		; decrement, the tick deferred by KiClockRespond (if any) is run - the
+		; local timer is fired at once (in periodic mode, the next tick runs the
+		; scheduler itself).
+		;
+		global PreemptEnable
+		PreemptEnable:
+			PUSH EAX
+			CALL KiCurrentCpu
+			TEST EAX, EAX
+			JZ PreemptEnableOver
+			CMP DWORD [EAX + 32 + 16], 0		; lock taken before counting began
+			JE PreemptEnableOver
+			DEC DWORD [EAX + 32 + 16]		; crolStatus.preemptCount--
+			JNZ PreemptEnableOver
+			CMP DWORD [EAX + 32 + 52], 0		; test crolStatus.needResched
+			JE PreemptEnableOver
+			CMP BYTE [oneShotTimerEnabled], 0
+			JE PreemptEnableOver
+			MOV DWORD [EAX + 32 + 36], 0		; crolStatus.tickExpiry = 0
+			MOV DWORD [EAX + 32 + 40], 0
+			MOV EAX, [VAPICBase]
+			MOV DWORD [EAX + 0x380], 1		; fire the local timer at once
+			PreemptEnableOver:
+			POP EAX
+			RET
+
 		global SpinLock
 		SpinLock:
 			PUSH EAX
 			PUSH ECX
+			CALL PreemptDisable
 			MOV EAX, [ESP + 12]
 			SpinLoop:
 				MOV ECX, 1
-				XCHG [EAX], ECX
-				CMP ECX, 0
-				JE SpinLoop
-			MFENCE
+				XCHG [EAX], ECX				; take the lock if it was 0
+				TEST ECX, ECX
+				JZ SpinAcquired
+				SpinWait:
+					PAUSE
+					CMP DWORD [EAX], 0		; wait by only reading the
+					JNE SpinWait			; lock, until it is released
+				JMP SpinLoop
+			SpinAcquired:
 			POP ECX
 			POP EAX
 			RET
 
+		global TestLock
+		TestLock:
+			PUSH ECX
+			PUSH EDX
+			CALL PreemptDisable
+			MOV ECX, [ESP + 12]
+			MOV EDX, 1
+			XOR EAX, EAX
+			LOCK CMPXCHG [ECX], EDX			; take the lock only if it is 0
+			JNE TestLockFailed
+			MOV EAX, 1
+			POP EDX
+			POP ECX
+			RET
+			TestLockFailed:
+			CALL PreemptEnable
+			XOR EAX, EAX
+			POP EDX
+			POP ECX
+			RET
+
 		global SpinUnlock
 		SpinUnlock:
 			PUSH EAX
 			MOV EAX, [ESP + 8]
-			MOV DWORD [EAX], 0
-			MFENCE
+			MOV DWORD [EAX], 0			; a plain store releases on x86
+			CALL PreemptEnable
 			POP EAX
 			RET
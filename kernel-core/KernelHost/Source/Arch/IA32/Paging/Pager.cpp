@@ -29,6 +29,8 @@
  *
  * Copyright (C) 2017 - Shukant Pal
  */
+#include <Atomic.hpp>
+#include <HardwareAbstraction/Processor.h>
 #include <IA32/PageExplorer.h>
 #include <Memory/Address.h>
 #include <Memory/Pager.h>
@@ -129,6 +131,7 @@ void Pager::switchSpace(MemoryContext *ncxt)
 	// Implement physical-address locating. Right now, not required as
 	// user-space doesn't exist.
 	SwitchPaging(pae->physPDPTAddr);
+	GetProcessorById(PROCESSOR_ID)->activeSpace = ncxt;
 }
 
 /**
@@ -153,31 +156,52 @@ void Pager::dispose(VirtAddr address)
 
 /**
  * Ensures that all pages in the the range vaddr to +mapSize is unmapped
- * an accessing any address in it causes a page-fault. Support for huge pages
- * has not been yet given.
+ * an accessing any address in it causes a page-fault. Huge pages are only
+ * unmapped if they lie completely in the range.
  *
- * @param vaddr - virtual-address base
- * @param mapSize - bytes to unmap, should be multiple of page-size otherwise
+ * Page-tables which become empty are reclaimed into the page-table cache
+ * of this cpu, so that they can be reused without being cleared again.
+ *
+ * @param base - virtual-address base
+ * @param limit - end of the range to unmap, should be page-aligned otherwise
  * 			a (huge/small) page can be left out.
  * @author Shukant Pal
  */
 void Pager::disposeAll(VirtAddr base, VirtAddr limit)
 {
-	U64 *dirEnt = PageExplorer::getDirectory(base >> 30);
-	U64 *ptabEnt = PageExplorer::getPageTable(base >> 21, FLG_ATOMIC)
-			+ ((base & 0x1FFFFF) >> 12);
-	unsigned page = base >> 12, pagel = limit >> 12;
-
-	while (page < pagel) {
-		if (PageExplorer::hasPageTable(dirEnt)) {
-			do {
-				*(ptabEnt++) = 0;
-			} while ((page & ~511) != 0 && (page < pagel));
-		} else {
-			*(dirEnt++) = 0;
-			page = (page & ~0x1FFFFF) + HUGE_PAGE;
-			ptabEnt = PageExplorer::getPageTable(base >> 21, FLG_ATOMIC);
+	if (limit <= base)
+		return;
+
+	unsigned long ftable = base >> 21, ltable = (limit - 1) >> 21;
+
+	for (unsigned long table = ftable; table <= ltable; table++) {
+		U64 *dirEnt = PageExplorer::getDirectory(table >> 9) +
+				(table & 511);
+		unsigned long fidx = (table == ftable) ?
+				PageExplorer::getTableIndex(base) : 0;
+		unsigned long lidx = (table == ltable) ?
+				PageExplorer::getTableIndex(limit - 1) : 511;
+
+		if (!(*dirEnt & 1))
+			continue;
+
+		if (*dirEnt >> 7 & 1) {
+			if (fidx == 0 && lidx == 511) {
+				*dirEnt = 0;
+				FlushTLB(table << 21);
+			}
+			continue;
+		}
+
+		U64 *ptab = PageExplorer::pageTableForOffset(table);
+		for (unsigned long idx = fidx; idx <= lidx; idx++) {
+			if (ptab[idx]) {
+				ptab[idx] = 0;
+				FlushTLB((table << 21) + (idx << 12));
+			}
 		}
+
+		PageExplorer::reclaimPageTable(table);
 	}
 }
 
@@ -205,6 +229,37 @@ void Pager::map(VirtAddr vadr, PhysAddr padr, unsigned frFlags,
 	}
 }
 
+/**
+ * Changes the attributes of all the small pages mapped in the range
+ * [base, limit), keeping the page-frames they are mapped to. Pages that
+ * are not present (and huge-pages) are left as they are.
+ *
+ * @param base - page-aligned lower-bound of the range
+ * @param limit - page-aligned upper-bound of the range
+ * @param attr - the new attributes for the pages
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void Pager::protect(VirtAddr base, VirtAddr limit, PageAttributes attr)
+{
+	for (VirtAddr page = base; page < limit; page += KPGSIZE) {
+		U64 *dirEnt = PageExplorer::getDirectory(page >> 30) +
+				PageExplorer::getDirectoryIndex(page);
+
+		if (!(*dirEnt & 1) || (*dirEnt >> 7 & 1))
+			continue;
+
+		U64 *pte = PageExplorer::pageTableForOffset(page >> 21) +
+				PageExplorer::getTableIndex(page);
+
+		if (*pte & 1) {
+			*pte = (*pte & 0x00000FFFFFFFF000) | attr | PagePresent;
+			FlushTLB(page);
+		}
+	}
+}
+
 /**
  * Allows software to map huge-pages to physical memory blocks of the same
  * sizes. This increases space-efficiency and access overhead in the CPU,
@@ -354,10 +409,11 @@ void Pager::useAllHuge(VirtAddr base, VirtAddr limit, unsigned allocFlags,
 	U64 *pdlimit = pde + getPageTableScope(limit - base);
 
 	base >>= 21;
-	while (pde++ < pdlimit) {
+	while (pde < pdlimit) {
 		PageExplorer::setHugePage(pde, allocFlags, attr);
 		FlushTLB(base << 21);
 		++(base);
+		++(pde);
 	}
 }
 
@@ -415,6 +471,190 @@ void Pager::useAll(VirtAddr vBase, VirtAddr vLimit, unsigned allocFlags,
 		Pager::useAllSmall(hLimit, vLimit, allocFlags, attr);
 }
 
+/**
+ * Finds the physical address to which the given virtual address is mapped
+ * in the current context. Both small and huge pages are walked.
+ *
+ * @param vadr - virtual address to translate
+ * @return - the physical address mapped; 0, if the address is not mapped
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+PhysAddr Pager::translate(VirtAddr vadr)
+{
+	U64 *dirEnt = PageExplorer::getDirectory(vadr >> 30) +
+			PageExplorer::getDirectoryIndex(vadr);
+
+	if (!(*dirEnt & 1))
+		return (0);
+
+	if (*dirEnt >> 7 & 1)
+		return ((*dirEnt & 0x00000FFFFFE00000) | (vadr & 0x1FFFFF));
+
+	U64 pageEnt = PageExplorer::pageTableForOffset(vadr >> 21)
+			[PageExplorer::getTableIndex(vadr)];
+
+	if (!(pageEnt & 1))
+		return (0);
+
+	return ((pageEnt & 0x00000FFFFFFFF000) | (vadr & 0xFFF));
+}
+
+/*
+ * Copies the 2-MB block at the given address into a 2-MB page-frame, one
+ * page at a time through the scratch page of this cpu. Called with
+ * interrupts disabled, as the scratch page is per-cpu.
+ */
+static void CopyToHugeFrame(VirtAddr hugeBase, PhysAddr hframe,
+		unsigned allocFlags)
+{
+	VirtAddr scratch = KSCRATCH + (PROCESSOR_ID << KPGOFFSET);
+
+	for (unsigned long idx = 0; idx < PGTAB_SIZE; idx++) {
+		Pager::map(scratch, hframe + (idx << KPGOFFSET),
+				allocFlags | KF_NOINTR, KernelData);
+		memcpyf((void*) (hugeBase + (idx << KPGOFFSET)), (void*) scratch,
+				KPGSIZE);
+	}
+
+	Pager::dispose(scratch);
+}
+
+/*
+ * Frees the page-frames mapped by a page-table which is no longer in use,
+ * reading it through the scratch page of this cpu, and then zeroes it so
+ * that it can go into the page-table cache. Called with interrupts
+ * disabled.
+ */
+static void FreeTableFrames(PhysAddr tableFrame)
+{
+	VirtAddr scratch = KSCRATCH + (PROCESSOR_ID << KPGOFFSET);
+	U64 *ptab = (U64*) scratch;
+
+	Pager::map(scratch, tableFrame, FLG_ATOMIC | KF_NOINTR, KernelData);
+
+	for (unsigned long idx = 0; idx < PGTAB_SIZE; idx++) {
+		KeFrameFree(ptab[idx] & 0x00000FFFFFFFF000);
+		ptab[idx] = 0;
+	}
+
+	Pager::dispose(scratch);
+}
+
+/**
+ * Promotes the 2-MB block at the given address, which must be fully mapped
+ * by small pages with the same attributes, to a huge-page. The contents of
+ * the small pages are copied into a freshly allocated 2-MB page-frame, via
+ * the scratch page of this cpu. Once the huge-page is mapped & the stale
+ * translations are shot down on all cpus, the small page-frames & the
+ * page-table are freed.
+ *
+ * Threads using the block may keep running on other cpus - the small pages
+ * are write-protected (and marked PagePromoting) and shot down before the
+ * copy, so no write can be lost. A write in b/w faults, and is retried by
+ * the page-fault handler until the huge-page is mapped.
+ *
+ * The caller shouldn't hold any lock taken with interrupts off, due to the
+ * shootdowns.
+ *
+ * @param hugeBase - 2-MB aligned address of the block, in the current
+ * 			context
+ * @param allocFlags - flags for allocating the 2-MB page-frame
+ * @return - whether the block was promoted to a huge-page
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool Pager::promote(VirtAddr hugeBase, unsigned allocFlags)
+{
+	U64 *dirEnt = PageExplorer::getDirectory(hugeBase >> 30) +
+			PageExplorer::getDirectoryIndex(hugeBase);
+
+	if ((hugeBase & 0x1FFFFF) || !(*dirEnt & 1) || (*dirEnt >> 7 & 1))
+		return (false);
+
+	U64 *ptab = PageExplorer::pageTableForOffset(hugeBase >> 21);
+	U64 attr = ptab[0] & 0x1F;
+
+	for (unsigned long idx = 0; idx < PGTAB_SIZE; idx++) {
+		if (!(ptab[idx] & 1) || (ptab[idx] & 0x1F) != attr ||
+				(ptab[idx] & PagePromoting))
+			return (false);
+	}
+
+	PhysAddr hframe = KeFrameAllocate(9, ZONE_KERNEL, allocFlags);
+	if (!hframe)
+		return (false);
+
+	/* The hardware sets the accessed & dirty bits atomically too */
+	for (unsigned long idx = 0; idx < PGTAB_SIZE; idx++) {
+		volatile U32 *flags = (volatile U32*) &ptab[idx];
+
+		__sync_fetch_and_or(flags, PagePromoting);
+		__sync_fetch_and_and(flags, ~PageReadWrite);
+	}
+
+	HAL::CPUDriver::shootdown(hugeBase, PGTAB_SIZE);
+
+	__irq_save_func(
+		CopyToHugeFrame(hugeBase, hframe, allocFlags);
+	)
+
+	/*
+	 * The page-table can't be read through its recursive mapping once the
+	 * directory-entry points to the huge-page, and so it is read through
+	 * the scratch page after that. The entry is stored at once, as the
+	 * page-walk of another cpu may read it in b/w.
+	 */
+	PhysAddr tableFrame = *dirEnt & 0x00000FFFFFFFF000;
+	AtomicWord<8>::store(dirEnt, hframe | attr | (1 << 7));
+
+	HAL::CPUDriver::shootdown(hugeBase, PGTAB_SIZE);
+	HAL::CPUDriver::shootdown((unsigned long) ptab, 1);
+
+	__irq_save_func(
+		FreeTableFrames(tableFrame);
+	)
+
+	PageExplorer::freePageTable(tableFrame);
+	return (true);
+}
+
+/**
+ * Tells whether a write-fault at the given address was caused by the
+ * promotion of its 2-MB block, in which case the write should be retried
+ * - it succeeds once the huge-page is mapped. A fault through a stale TLB
+ * entry, just after the huge-page was mapped, is also retried.
+ *
+ * @param vadr - faulting address
+ * @return - whether the faulting write should be retried
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool Pager::isPromoting(VirtAddr vadr)
+{
+	volatile U64 *dirEnt = PageExplorer::getDirectory(vadr >> 30) +
+			PageExplorer::getDirectoryIndex(vadr);
+	U64 dirValue = *dirEnt;
+
+	if (!(dirValue & 1))
+		return (false);
+
+	if (dirValue >> 7 & 1)
+		return (dirValue & PageReadWrite);
+
+	U64 pageEnt = PageExplorer::pageTableForOffset(vadr >> 21)
+			[PageExplorer::getTableIndex(vadr)];
+
+	/* The block may have been remapped while its page-table was read */
+	if (*dirEnt != dirValue)
+		return (true);
+
+	return ((pageEnt & 1) && (pageEnt & PagePromoting));
+}
+
 decl_c void EraseIdentityPage()
 {
 	FlushTLB(0);
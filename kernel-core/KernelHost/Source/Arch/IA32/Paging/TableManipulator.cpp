@@ -35,6 +35,10 @@
  * excluding the KERNEL_CONTEXT (as only the 3rd entry is used there) to
  * optimize away page-directory access.
  *
+ * 3. Page-tables are taken from a per-cpu cache of zeroed page-frames,
+ * which is refilled by empty page-tables reclaimed by the pager. This
+ * avoids clearing a page-table each time it is allocated.
+ *
  * -------------------------------------------------------------------
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -52,6 +56,7 @@
  * Copyright (C) 2017 - Shukant Pal
  */
 
+#include <HardwareAbstraction/Processor.h>
 #include <IA32/PageExplorer.h>
 #include <Memory/KFrameManager.h>
 #include <Memory/KMemorySpace.h>
@@ -61,6 +66,124 @@
 #define pageTablePtr(dir, tbl)(KERNEL_OFFSET + \
 		HUGE_PAGES(507 + (dir)) + NORM_PAGES(tbl))
 
+extern bool oballocNormaleUse;
+
+/**
+ * Allocates a page-frame to be used as a page-table. It is taken from the
+ * page-table cache of this cpu, if any are available, in which case it is
+ * already zeroed. Otherwise, a fresh page-frame is entrapped and the caller
+ * should clear it after mapping.
+ *
+ * The per-cpu data isn't mapped until the BSP is setup, and hence the cache
+ * is bypassed before that.
+ *
+ * @param allocFlags - flags to allocate a fresh page-frame, if required
+ * @param zeroed - set to whether the page-frame returned is already zeroed
+ * @return - physical address of the page-frame for the page-table
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+PhysAddr PageExplorer::allocPageTable(unsigned long allocFlags, bool& zeroed)
+{
+	if(oballocNormaleUse)
+	{
+		PhysAddr tableFrame = 0;
+
+		/* The caller may have interrupts disabled, so they're restored */
+		__irq_save_func(
+			PageTableCache *ptc = &GetProcessorById(PROCESSOR_ID)->ptCache;
+
+			if(ptc->count)
+				tableFrame = ptc->frames[--(ptc->count)];
+		)
+
+		if(tableFrame)
+		{
+			zeroed = true;
+			return (tableFrame);
+		}
+	}
+
+	zeroed = false;
+	return (KiFrameEntrap(allocFlags));
+}
+
+/**
+ * Returns a page-table frame, which must be zeroed, to the page-table cache
+ * of this cpu. If the cache is full, the frame is freed to the frame
+ * allocator.
+ *
+ * @param tableFrame - physical address of a zeroed page-table
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void PageExplorer::freePageTable(PhysAddr tableFrame)
+{
+	if(oballocNormaleUse)
+	{
+		bool cached = false;
+
+		__irq_save_func(
+			PageTableCache *ptc = &GetProcessorById(PROCESSOR_ID)->ptCache;
+
+			if(ptc->count < PGTAB_CACHE_SIZE)
+			{
+				ptc->frames[(ptc->count)++] = tableFrame;
+				cached = true;
+			}
+		)
+
+		if(cached)
+			return;
+	}
+
+	KiFrameFree(tableFrame);
+}
+
+/**
+ * Unmaps the page-table at the given offset from its page-directory, if it
+ * doesn't contain any entries, and puts it into the page-table cache. This
+ * is used by the pager after unmapping a range of pages.
+ *
+ * Page-tables in kernel-memory are never reclaimed - the kernel directory
+ * is shared by all cpus, which may still have the table's entries cached
+ * in their TLBs, and it would be reused while they are.
+ *
+ * @param tableIndice - global offset of the page-table (vaddr >> 21)
+ * @return - whether the page-table was reclaimed
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool PageExplorer::reclaimPageTable(unsigned long tableIndice)
+{
+	if(tableIndice >= (KERNEL_OFFSET >> 21))
+		return (false);
+
+	U64 *dirEnt = PageExplorer::getDirectory(tableIndice >> 9) +
+			(tableIndice & 511);
+
+	if(!(*dirEnt & 1) || (*dirEnt >> 7 & 1))
+		return (false);
+
+	U64 *ptab = pageTableForOffset(tableIndice);
+	for(unsigned long idx = 0; idx < PGTAB_SIZE; idx++)
+	{
+		if(ptab[idx])
+			return (false);
+	}
+
+	PhysAddr tableFrame = *dirEnt & 0x00000FFFFFFFF000;
+	*dirEnt = 0;
+	FlushTLB((unsigned long) ptab);
+	FlushTLB(tableIndice << 21);
+
+	freePageTable(tableFrame);
+	return (true);
+}
+
 /**
  * Returns a ptr in kernel-memory to the page-table with the given
  * parameters. If none exists, one is allocated using KiFrameEntrap
@@ -87,9 +210,12 @@ U64 *PageExplorer::getPageTable(unsigned long tableIndice,
 
 	if(!pdir[tableIndice & 511] & 1)
 	{
-		pdir[tableIndice & 511] = (U64) KiFrameEntrap(allocFlags) | 3;
-		FlushTLB((unsigned long) pdir);
-		memsetf((void *) ptbl, 0, NORM_PAGES(1));
+		bool zeroed;
+		pdir[tableIndice & 511] = allocPageTable(allocFlags, zeroed) | 3;
+		FlushTLB(ptbl);
+
+		if(!zeroed)
+			memsetf((void *) ptbl, 0, NORM_PAGES(1));
 	}
 	else if(pdir[tableIndice & 511] >> 7 & 1)
 		return (null);
@@ -126,9 +252,12 @@ U64 *PageExplorer::getAllPageTables(unsigned long tableIndice,
 	{
 		if(!(*dirEnt) & 1)
 		{
-			*dirEnt = (U64) KiFrameEntrap(allocFlags) | 3;
-			FlushTLB((unsigned long) dirEnt);
-			memsetf(tablePtr, 0, PGTAB_SIZE * sizeof(U64));
+			bool zeroed;
+			*dirEnt = allocPageTable(allocFlags, zeroed) | 3;
+			FlushTLB((unsigned long) tablePtr);
+
+			if(!zeroed)
+				memsetf(tablePtr, 0, PGTAB_SIZE * sizeof(U64));
 		}
 		else if((*dirEnt >> 7) & 1)
 		{
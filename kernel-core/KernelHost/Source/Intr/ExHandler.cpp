@@ -3,6 +3,8 @@
  */
 
 #include <IA32/Processor.h>
+#include <Memory/KernelStack.hpp>
+#include <Memory/Pager.h>
 #include <Debugging.h>
 #include <Types.h>
 
@@ -10,9 +12,24 @@
 
 extern U32 regInfo;
 
+/*
+ * Runs in the double-fault task (see TSS.cpp), on its own stack. A fault on
+ * the guard-page of a kernel-stack is reported as a stack overflow.
+ */
 export_asm void HandleDF(U32 zero) {
+	U32 faultAddress;
+	asm volatile("movl %%cr2, %0" : "=r"(faultAddress));
+
+	if(Memory::KernelStack::isGuardPage(faultAddress)) {
+		Dbg("Kernel Stack Overflow - ");
+		DbgInt(faultAddress);
+		Dbg(", cpu ");
+		DbgInt(PROCESSOR_ID);
+		DbgLine("");
+	}
+
 	DbgLine("Double Fault - System Down");
-	//asm volatile("cli; hlt;");
+	asm volatile("cli; hlt;");
 }
 
 export_asm void HandleIT(U32 v) {
@@ -44,6 +61,13 @@ export_asm void HandlePF(U32 errorCode) {
 	//if(FixPF(regInfo))
 	//	return;
 
+	U32 faultAddress;
+	asm volatile("movl %%cr2, %0" : "=r"(faultAddress));
+
+	/* Writes to a block being promoted are retried once it is remapped */
+	if((errorCode & 3) == 3 && Pager::isPromoting(faultAddress))
+		return;
+
 	bool bitP = errorCode & 1;
 	bool bitW = errorCode & (1 << 1);
 	bool bitU = errorCode & (1 << 2);
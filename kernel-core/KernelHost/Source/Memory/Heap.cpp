@@ -21,6 +21,7 @@
 #include <Memory/Pager.h>
 #include <Memory/KMemoryManager.h>
 #include <Memory/MemoryTransfer.h>
+#include <Memory/VirtualArea.hpp>
 #include <KERNEL.h>
 
 using namespace Heap;
@@ -61,6 +62,10 @@ ObjectInfo* heapEngines[6];// slab-allocators for each allocation class
  * 256 DWORDs by returning whole blocks of pages directly from the
  * vmm, mapping them to physical kernel-memory.
  *
+ * Since Silcos 3.05, these allocations are taken from the virtual-area
+ * allocator (vmalloc), which doesn't require physically contiguous memory.
+ * The vmm is used only before vmalloc is online.
+ *
  * To keep track of usage and prevent dangling pointers, kmalloc()
  * provides a method to hold the no. of users of heap memory. The
  * memory cannot be freed (unless forced) until the no. of users drops
@@ -88,6 +93,16 @@ void* kmalloc(unsigned int memSize, unsigned int initialUsers)
 		if(memSize < KPGSIZE)
 			memSize = KPGSIZE;
 
+		BlockContainer *vmBlock = (BlockContainer*) vmalloc(memSize);
+		if(vmBlock != null) {
+			unsigned long vmSize = vsize(vmBlock);
+
+			vmBlock->magicNo = HEAP_MAGIC;
+			vmBlock->refCount = initialUsers;
+			vmBlock->blockOrder = HighestBitSet(vmSize);
+			return ((void*)(vmBlock + 1));
+		}
+
 		unsigned long pagesReq = NextPowerOf2(memSize) >> KPGOFFSET;
 		pagesReq = HighestBitSet(pagesReq);
 
@@ -141,6 +156,11 @@ bool kfree(void* memGiven, bool forceDelete)
 			KDelete((void*) memBlock,
 					heapEngines[memBlock->blockOrder - 5]);
 		return (true);
+	} else if(isVirtualArea(memBlock)) {
+		--(memBlock->refCount);
+		if(memBlock->refCount == 0 || forceDelete)
+			vfree((void*) memBlock);
+		return (true);
 	} else {
 		unsigned long vmBlockOrder = memBlock->blockOrder - KPGOFFSET;
 		MMFRAME *paddr = GetFrames((ADDRESS) memGiven, vmBlockOrder,
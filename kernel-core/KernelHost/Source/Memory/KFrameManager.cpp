@@ -34,7 +34,7 @@
 #include <Memory/KFrameManager.h>
 #include "../../../Interface/Utils/CtPrim.h"
 #include <Multiboot2.h>
-#include <Synch/Spinlock.h>
+#include <Synch/MCSLock.hpp>
 #include <Environment.h>
 #include <KERNEL.h>
 #include <Debugging.h>
@@ -56,7 +56,7 @@ unsigned long pgTotal;
 
 unsigned long memFrameTableSize;
 
-Spinlock kfLock;
+MCSLock kfLock;
 
 // Vector (bit-fields) for use by (buddy) allocator
 static unsigned short allocatorVectors[(1 + FRAME_VECTORS) * 5];
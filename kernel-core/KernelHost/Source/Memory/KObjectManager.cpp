@@ -333,6 +333,7 @@ decl_c ObjectInfo *KiCreateType(const char *tName, unsigned long tSize,
 	typeInfo->partialList.count = 0;
 	typeInfo->fullList.lMain = NULL;
 	typeInfo->fullList.count= 0;
+	typeInfo->lock.word = 0;
 	AddCElement((CircularListNode*) typeInfo, CLAST, &tList);
 
 	return (typeInfo);
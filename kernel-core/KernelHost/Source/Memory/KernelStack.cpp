@@ -0,0 +1,142 @@
+/**
+ * @file KernelStack.cpp
+ *
+ * Implements the allocator for kernel-stacks of threads, which hands out
+ * guarded stacks from the KSTACKS window.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <Memory/KernelStack.hpp>
+#include <Memory/Pager.h>
+#include <HardwareAbstraction/Processor.h>
+#include <KERNEL.h>
+
+using namespace HAL;
+using namespace Memory;
+
+unsigned long KernelStack::poolHead = 0;
+unsigned long KernelStack::nextSlot = 0;
+Spinlock KernelStack::poolLock = 0;
+
+/**
+ * Gives a kernel-stack of KSTACK_SIZE bytes, which is mapped & has an
+ * unmapped guard-page below it. Must be called with interrupts enabled, as
+ * a new stack may have to be mapped.
+ *
+ * @return - lowest address of the stack; 0, if the KSTACKS window is
+ * 			exhausted.
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+unsigned long KernelStack::allocate()
+{
+	unsigned long stack = 0;
+
+	PreemptDisable();
+	KernelStackCache *cache = &GetProcessorById(PROCESSOR_ID)->stackCache;
+
+	if(cache->count == 0)
+		refill(cache);
+
+	if(cache->count != 0)
+		stack = cache->stacks[--(cache->count)];
+	PreemptEnable();
+
+	return ((stack != 0) ? stack : create());
+}
+
+/**
+ * Puts the given kernel-stack into the cache of the current cpu, moving a
+ * batch of stacks to the global pool if the cache is full. The stack stays
+ * mapped. It must not be in use, i.e. its thread must have been switched
+ * out for the last time. Not to be called by interrupt handlers, as the
+ * cache is only guarded against preemption.
+ *
+ * @param stack - lowest address of the stack, as given by allocate()
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void KernelStack::free(unsigned long stack)
+{
+	PreemptDisable();
+	KernelStackCache *cache = &GetProcessorById(PROCESSOR_ID)->stackCache;
+
+	if(cache->count == KSTACK_CACHE_SIZE)
+		drain(cache);
+
+	cache->stacks[(cache->count)++] = stack;
+	PreemptEnable();
+}
+
+/*
+ * Maps the stack in the next unused slot, leaving its first page (the
+ * guard-page) unmapped.
+ */
+unsigned long KernelStack::create()
+{
+	unsigned long slot = __sync_fetch_and_add(&nextSlot, 1);
+
+	if(slot >= KSTACK_SLOTS)
+		return (0);
+
+	unsigned long stack = KSTACKS + slot * KSTACK_SLOT_SIZE + KPGSIZE;
+
+	for(unsigned long offset = 0; offset < KSTACK_SIZE; offset += KPGSIZE)
+		Pager::use(stack + offset, FLG_ATOMIC, KernelData);
+
+	return (stack);
+}
+
+/*
+ * Moves a batch of stacks from the global pool into the (empty) cache.
+ * Called with preemption disabled.
+ */
+void KernelStack::refill(KernelStackCache *cache)
+{
+	if(poolHead == 0)
+		return;
+
+	SpinLock(&poolLock);
+
+	while(poolHead != 0 && cache->count < KSTACK_BATCH)
+	{
+		cache->stacks[(cache->count)++] = poolHead;
+		poolHead = *(unsigned long*) poolHead;
+	}
+
+	SpinUnlock(&poolLock);
+}
+
+/*
+ * Moves a batch of stacks from the (full) cache into the global pool.
+ * Called with preemption disabled.
+ */
+void KernelStack::drain(KernelStackCache *cache)
+{
+	SpinLock(&poolLock);
+
+	while(cache->count > KSTACK_CACHE_SIZE - KSTACK_BATCH)
+	{
+		unsigned long stack = cache->stacks[--(cache->count)];
+
+		*(unsigned long*) stack = poolHead;
+		poolHead = stack;
+	}
+
+	SpinUnlock(&poolLock);
+}
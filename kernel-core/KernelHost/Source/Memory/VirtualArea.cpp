@@ -0,0 +1,330 @@
+/**
+ * @file VirtualArea.cpp
+ *
+ * Implements the virtual-area allocator (vmalloc), which hands out
+ * virtually contiguous blocks of kernel memory from the KVMALLOC window.
+ * Each page in an area is backed by an order-0 page-frame, so that large
+ * allocations don't fail (or fragment physical memory) when no
+ * high-order block is available in the frame allocator.
+ *
+ * The allocated areas are indexed by a red-black tree, which is created
+ * lazily once the ModuleFramework has initialized its node types. Until
+ * then, vmalloc() fails and the heap falls back to the buddy-managed
+ * KDYNAMIC range.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <HardwareAbstraction/Processor.h>
+#include <Memory/VirtualArea.hpp>
+#include <Memory/KFrameManager.h>
+#include <Memory/KObjectManager.h>
+#include <Memory/Pager.h>
+#include <Synch/Spinlock.h>
+#include <Utils/RBTree.hpp>
+#include <KERNEL.h>
+
+using namespace Memory;
+
+const char *nmVirtualArea = "Memory::VirtualArea";
+ObjectInfo *tVirtualArea;
+
+LinkedList vmFreeRanges;/* Free ranges in KVMALLOC, sorted by address */
+RBTree *vmAreaTree;/* Allocated areas keyed by their base address */
+Spinlock vmLock;
+
+/**
+ * Reserves a range of the given no. of pages in the KVMALLOC window, by
+ * carving it out of the first free range large enough. The caller must
+ * hold the vmLock.
+ *
+ * @param spanCount - no. of pages to reserve
+ * @return - base address of the range; 0, if the window is exhausted
+ */
+static unsigned long vmReserve(unsigned long spanCount)
+{
+	VirtualArea *range = (VirtualArea*) vmFreeRanges.head;
+
+	while(range != NULL)
+	{
+		if(range->spanCount >= spanCount)
+		{
+			unsigned long base = range->base;
+
+			range->base += spanCount << KPGOFFSET;
+			range->spanCount -= spanCount;
+
+			if(range->spanCount == 0)
+			{
+				RemoveElement(&range->liLinker, &vmFreeRanges);
+				KDelete(range, tVirtualArea);
+			}
+
+			return (base);
+		}
+
+		range = (VirtualArea*) range->liLinker.next;
+	}
+
+	return (0);
+}
+
+/**
+ * Returns the given range of pages to the free ranges, coalescing it with
+ * the ranges just before & after it. The caller must hold the vmLock.
+ *
+ * @param area - the area being released; it is either recycled as a free
+ * 			range or deleted.
+ */
+static void vmRelease(VirtualArea *area)
+{
+	VirtualArea *after = (VirtualArea*) vmFreeRanges.head;
+	VirtualArea *before = NULL;
+
+	while(after != NULL && after->base < area->base)
+	{
+		before = after;
+		after = (VirtualArea*) after->liLinker.next;
+	}
+
+	if(before && before->base + (before->spanCount << KPGOFFSET)
+			== area->base)
+	{
+		before->spanCount += area->spanCount;
+		KDelete(area, tVirtualArea);
+
+		if(after && before->base + (before->spanCount << KPGOFFSET)
+				== after->base)
+		{
+			before->spanCount += after->spanCount;
+			RemoveElement(&after->liLinker, &vmFreeRanges);
+			KDelete(after, tVirtualArea);
+		}
+	}
+	else if(after && area->base + (area->spanCount << KPGOFFSET)
+			== after->base)
+	{
+		after->base = area->base;
+		after->spanCount += area->spanCount;
+		KDelete(area, tVirtualArea);
+	}
+	else
+	{
+		area->pageCount = 0;
+		area->vmFlags = 0;
+
+		if(after)
+			InsertElementBefore(&after->liLinker, &area->liLinker,
+						&vmFreeRanges);
+		else
+			AddElement(&area->liLinker, &vmFreeRanges);
+	}
+}
+
+/*
+ * No. of pages unmapped before each shootdown in vmUnmapAll(); their frames
+ * are kept on the stack until the shootdown is over.
+ */
+#define VM_UNMAP_BATCH 32
+
+/**
+ * Unmaps the first pageCount pages of the area and frees the page-frames
+ * that were backing them. The frames are freed only after the stale
+ * translations are shot down on all cpus, as they could be written to
+ * otherwise after being reallocated.
+ *
+ * @param base - base address of the area
+ * @param pageCount - no. of pages that were mapped
+ */
+static void vmUnmapAll(unsigned long base, unsigned long pageCount)
+{
+	PhysAddr frames[VM_UNMAP_BATCH];
+	unsigned long batch, fidx, frameCount;
+
+	while(pageCount)
+	{
+		batch = (pageCount < VM_UNMAP_BATCH) ? pageCount : VM_UNMAP_BATCH;
+		frameCount = 0;
+
+		for(unsigned long pidx = 0; pidx < batch; pidx++)
+		{
+			unsigned long page = base + (pidx << KPGOFFSET);
+			PhysAddr frame = Pager::translate(page);
+
+			if(frame)
+			{
+				Pager::dispose(page);
+				frames[frameCount++] = frame;
+			}
+		}
+
+		HAL::CPUDriver::shootdown(base, batch);
+
+		for(fidx = 0; fidx < frameCount; fidx++)
+			KiFrameFree(frames[fidx]);
+
+		base += batch << KPGOFFSET;
+		pageCount -= batch;
+	}
+}
+
+/**
+ * Allocates a virtually contiguous block of kernel memory, backed by
+ * individual page-frames, from the KVMALLOC window. Unless VM_GUARD is
+ * cleared, an unmapped page is left after the block so that overflows
+ * fault instead of corrupting the next area.
+ *
+ * @param size - no. of bytes required
+ * @param vmFlags - VM_GUARD, VM_NOINTR
+ * @return - the allocated memory; null, if the window or physical memory
+ * 		was exhausted, or if called before the ModuleFramework was
+ * 		initialized.
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void *vmalloc(unsigned long size, unsigned long vmFlags)
+{
+	if(size == 0 || tRBTree == NULL)
+		return (null);
+
+	unsigned long pageCount = (size + KPGSIZE - 1) >> KPGOFFSET;
+	unsigned long spanCount = pageCount + ((vmFlags & VM_GUARD) ? 1 : 0);
+	unsigned long frFlags = FLG_ATOMIC |
+			((vmFlags & VM_NOINTR) ? KF_NOINTR : 0);
+
+	VirtualArea *area = new(tVirtualArea) VirtualArea;
+	if(area == NULL)
+		return (null);
+
+	SpinLock(&vmLock);
+
+	if(vmAreaTree == NULL)
+		vmAreaTree = new(tRBTree) RBTree();
+
+	unsigned long base = vmReserve(spanCount);
+	if(base)
+		vmAreaTree->insert(base, area);
+
+	SpinUnlock(&vmLock);
+
+	if(!base)
+	{
+		KDelete(area, tVirtualArea);
+		return (null);
+	}
+
+	area->base = base;
+	area->pageCount = pageCount;
+	area->spanCount = spanCount;
+	area->vmFlags = vmFlags;
+
+	PhysAddr frame;
+	for(unsigned long pidx = 0; pidx < pageCount; pidx++)
+	{
+		frame = KeFrameAllocate(0, ZONE_KERNEL, frFlags);
+
+		if(!frame)
+		{
+			vmUnmapAll(base, pidx);
+
+			SpinLock(&vmLock);
+			vmAreaTree->remove(base);
+			vmRelease(area);
+			SpinUnlock(&vmLock);
+
+			return (null);
+		}
+
+		Pager::map(base + (pidx << KPGOFFSET), frame, frFlags,
+				KernelData);
+	}
+
+	return ((void*) base);
+}
+
+/**
+ * Frees a block allocated by vmalloc(), unmapping it and releasing its
+ * page-frames & virtual range.
+ *
+ * @param vmem - the memory returned by vmalloc()
+ * @return - whether the memory was a valid virtual area & was freed
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool vfree(void *vmem)
+{
+	if(!isVirtualArea(vmem) || vmAreaTree == NULL)
+		return (false);
+
+	SpinLock(&vmLock);
+	VirtualArea *area = (VirtualArea*) vmAreaTree->remove(
+					(unsigned long) vmem);
+	SpinUnlock(&vmLock);
+
+	if(area == NULL)
+		return (false);
+
+	vmUnmapAll(area->base, area->pageCount);
+
+	SpinLock(&vmLock);
+	vmRelease(area);
+	SpinUnlock(&vmLock);
+
+	return (true);
+}
+
+/**
+ * Gives the no. of bytes usable in a block allocated by vmalloc(), which
+ * is the requested size rounded up to a page.
+ *
+ * @param vmem - the memory returned by vmalloc()
+ * @return - size of the area; 0, if vmem is not a valid area.
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+unsigned long vsize(const void *vmem)
+{
+	if(!isVirtualArea(vmem) || vmAreaTree == NULL)
+		return (0);
+
+	SpinLock(&vmLock);
+	VirtualArea *area = (VirtualArea*) vmAreaTree->get(
+					(unsigned long) vmem);
+	SpinUnlock(&vmLock);
+
+	return ((area) ? area->pageCount << KPGOFFSET : 0);
+}
+
+/**
+ * Creates the object-type for virtual areas and puts the whole KVMALLOC
+ * window into the free ranges. Called by the KernelHost during boot,
+ * after the heap has been setup.
+ */
+decl_c void SetupVirtualAreas()
+{
+	tVirtualArea = KiCreateType(nmVirtualArea, sizeof(VirtualArea),
+					sizeof(long), NULL, NULL);
+
+	VirtualArea *window = new(tVirtualArea) VirtualArea;
+	window->base = KVMALLOC;
+	window->pageCount = 0;
+	window->spanCount = KVMALLOC_SIZE >> KPGOFFSET;
+	window->vmFlags = 0;
+
+	AddElement(&window->liLinker, &vmFreeRanges);
+}
@@ -30,6 +30,7 @@
 #include <Module/Elf/ElfManager.hpp>
 #include <Module/Elf/ElfAnalyzer.hpp>
 #include <Module/Elf/ElfLinker.hpp>
+#include <Synch/Mutex.hpp>
 #include <Utils/Arrays.hpp>
 #include <KERNEL.h>
 
@@ -38,6 +39,9 @@ using namespace Module::Elf;
 
 extern "C" void elf_dbg() { Dbg("ELF PROGRAME CALLS MK");}
 
+/* Serializes bundle loads, which copy & link whole modules */
+static Mutex bundleLock;
+
 char nmElfManager[] = "Module::Elf::ElfManager";
 char nmDynamicLink[] = "Module::DynamicLink";
 
@@ -230,12 +234,17 @@ void ModuleLoader::loadFile(BlobRegister &blob)
  * registration of all modules, to avoid any inter-depedencies that would cause
  * a not-found linkage error.
  *
+ * Only one bundle is loaded at a time; other loaders sleep on a mutex, as
+ * the load is too long to spin for.
+ *
  * @param LinkedList& blobList - List of blob-registers
  * @since Circuit 2.03
  * @author Shukant Pal
  */
 void ModuleLoader::loadBundle(LinkedList &blobList)
 {
+	bundleLock.lock();
+
 	BlobRegister *blob = (BlobRegister*) blobList.head;
 
 	unsigned int ctr = 0;
@@ -264,6 +273,8 @@ void ModuleLoader::loadBundle(LinkedList &blobList)
 		ModuleLoader::linkFile(blob->abiFound, *blob);
 		blob = (BlobRegister*) blob->liLinker.next;
 	}
+
+	bundleLock.unlock();
 }
 
 /**
@@ -48,6 +48,13 @@ static bool initEnsured = false;
  */
 ::Module::Namespace Namespace::nsRoot;
 
+/*
+ * Namespaces are looked up on every module load, but created rarely. The
+ * lock is all-zero when unlocked, and so it too can be used before the
+ * global objects are constructed.
+ */
+BigReaderLock Namespace::nsTreeLock;
+
 /**
  * Default constructor for private use only, by root-of-tree
  * namespaces.
@@ -166,6 +173,19 @@ void Namespace::ensureInit()
  * 		if found; otherwise, a null-pointer is returned on exit.
  */
 Namespace *Namespace::searchOnly(const char *dChildIdentBuffer, unsigned bytes)
+{
+	nsTreeLock.enterAsReader();
+	Namespace *dChild = findChild(dChildIdentBuffer, bytes);
+	nsTreeLock.exitAsReader();
+
+	return (dChild);
+}
+
+/*
+ * Walks the child-set of this namespace, while the caller holds the tree
+ * lock (as a reader or writer).
+ */
+Namespace *Namespace::findChild(const char *dChildIdentBuffer, unsigned bytes)
 {
 	for (Namespace *dChild = static_cast<Namespace *>(nsChildSet.head);
 			dChild != null; dChild = static_cast<Namespace *>(dChild->next)) {
@@ -145,7 +145,10 @@ unsigned long SymbolLookup::lookup(char *symbolName, ModuleContainer* &owner)
 		{
 			if(owner)
 				owner = sdef->sandBox;
-			return (sdef->address);
+
+			unsigned long address = sdef->address;
+			rwl.exitAsReader();
+			return (address);
 		}
 
 		sdef = sdef->next;
@@ -0,0 +1,130 @@
+/**
+ * @file BigReaderLock.cpp
+ * @module KernelHost
+ *
+ * Implements the per-cpu reader-writer lock.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <HardwareAbstraction/CpuSet.hpp>
+#include <HardwareAbstraction/Processor.h>
+#include <Synch/BigReaderLock.hpp>
+#include <KERNEL.h>
+
+using namespace HAL;
+
+extern bool oballocNormaleUse;
+
+static unsigned long brSlotsUsed = 0;
+
+/*
+ * Gives the index of the reader counters of the lock, taking a free one
+ * if the lock hasn't been used yet. Racing cpus agree on a slot via the
+ * CAS, and the loser's slot is leaked (which happens only once per lock).
+ */
+static unsigned long SlotOf(BigReaderLock *lock)
+{
+	if(lock->slot != 0)
+		return (lock->slot - 1);
+
+	unsigned long slot = __sync_add_and_fetch(&brSlotsUsed, 1);
+
+	ASSERT(slot <= BR_LOCKS, (char*) "Big-reader locks exhausted - "
+			"raise BR_LOCKS");
+
+	__sync_bool_compare_and_swap(&lock->slot, 0, slot);
+	return (lock->slot - 1);
+}
+
+/**
+ * Enters the read-side of the lock, waiting only if a writer is inside.
+ * The counter of the current cpu is updated by a locked instruction, which
+ * orders it before the check for writers, and is atomic w.r.t. interrupt
+ * handlers on the same cpu. A nested reader doesn't wait, as the writer is
+ * already waiting for the outer one.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void BigReaderLock::enterAsReader()
+{
+	PreemptDisable();
+
+	if(!oballocNormaleUse)
+		return;
+
+	volatile unsigned long *readers =
+		&GetProcessorById(PROCESSOR_ID)->brReaders[SlotOf(this)];
+
+	while(__sync_fetch_and_add(readers, 1) == 0 && writing)
+	{
+		/* Back-off, so that the writer sees no readers on this cpu */
+		__sync_fetch_and_sub(readers, 1);
+
+		while(writing)
+			asm volatile("pause");
+	}
+}
+
+void BigReaderLock::exitAsReader()
+{
+	if(oballocNormaleUse)
+	{
+		volatile unsigned long *readers = &GetProcessorById(
+				PROCESSOR_ID)->brReaders[SlotOf(this)];
+
+		__sync_fetch_and_sub(readers, 1);
+	}
+
+	PreemptEnable();
+}
+
+/**
+ * Enters the write-side of the lock, waiting for other writers and then
+ * for the readers on all cpus to exit. New readers wait for the writer to
+ * exit, and so writers aren't starved.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void BigReaderLock::enterAsWriter()
+{
+	SpinLock(&writer);
+	(void) __sync_lock_test_and_set(&writing, 1);
+
+	if(!oballocNormaleUse)
+		return;
+
+	unsigned long slot = SlotOf(this);
+
+	for(unsigned long cpuId = onlineCpus.first(); cpuId < CPUSET_MAX;
+			cpuId = onlineCpus.next(cpuId))
+	{
+		Processor *cpu = GetProcessorById(cpuId);
+
+		while(cpu->brReaders[slot] != 0)
+			asm volatile("pause");
+	}
+}
+
+void BigReaderLock::exitAsWriter()
+{
+	asm volatile("" : : : "memory");
+	writing = 0;
+	SpinUnlock(&writer);
+}
@@ -43,11 +43,11 @@ decl_c void AddCElement(CircularListNode *clnNode,
 			clnMain->next = clnNode;
 		} else {
 			clnNode->next = clnMain;
-			clnMain->last = clnNode;
-			
 			clnNode->last = clnMain->last;
 			clnNode->last->next = clnNode;
 			// Make sure forward-linkage is correct!!! (ERR: Fixed)
+
+			clnMain->last = clnNode;
 		}
 	} else {
 		clnNode->next = clnNode;
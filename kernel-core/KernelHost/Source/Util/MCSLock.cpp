@@ -0,0 +1,182 @@
+/**
+ * @file MCSLock.cpp
+ * @module KernelHost
+ *
+ * Implements the MCS queued spinlock, using the per-cpu queue nodes.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#include <HardwareAbstraction/Processor.h>
+#include <Synch/MCSLock.hpp>
+#include <KERNEL.h>
+
+using namespace HAL;
+
+extern bool oballocNormaleUse;
+
+/*
+ * Until the per-cpu data is mapped (only the BSP is running then), the
+ * nodes are taken from here.
+ */
+static MCSNode bootNodes[MCS_NODES];
+static unsigned long bootUsed = 0;
+
+/*
+ * Takes a free queue node of the current cpu. Preemption must be disabled,
+ * so that the node is given back on the same cpu; interrupts are disabled
+ * only while the bitmap is changed, as interrupt handlers also take nodes.
+ */
+static MCSNode *TakeNode()
+{
+	MCSNode *nodes = bootNodes;
+	unsigned long *used = &bootUsed;
+	unsigned long idx;
+
+	if(oballocNormaleUse)
+	{
+		Processor *cpu = GetProcessorById(PROCESSOR_ID);
+
+		nodes = cpu->mcsNodes;
+		used = &cpu->mcsUsed;
+	}
+
+	__irq_save_func(
+		idx = __builtin_ctzl(~*used);
+		*used |= 1UL << idx;
+	)
+
+	ASSERT(idx < MCS_NODES, (char*) "MCS queue-nodes exhausted - more "
+			"locks are nested than MCS_NODES allows");
+
+	MCSNode *node = &nodes[idx];
+
+	node->next = null;
+	node->locked = 1;
+
+	return (node);
+}
+
+static void GiveNode(MCSNode *node)
+{
+	MCSNode *nodes = bootNodes;
+	unsigned long *used = &bootUsed;
+
+	if(node < bootNodes || node >= bootNodes + MCS_NODES)
+	{
+		Processor *cpu = GetProcessorById(PROCESSOR_ID);
+
+		nodes = cpu->mcsNodes;
+		used = &cpu->mcsUsed;
+	}
+
+	__irq_save_func(
+		*used &= ~(1UL << (node - nodes));
+	)
+}
+
+/**
+ * Acquires the MCS lock. The current cpu appends its node to the queue of
+ * waiters, and spins on that node until its predecessor passes the lock.
+ * Preemption is disabled until the lock is released.
+ *
+ * @param lock - the lock to acquire
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void SpinLock(MCSLock *lock)
+{
+	PreemptDisable();
+
+	MCSNode *node = TakeNode();
+	MCSNode *prev = __sync_lock_test_and_set(&lock->tail, node);
+
+	if(prev != null)
+	{
+		prev->next = node;
+
+		while(node->locked)
+			asm volatile("pause");
+	}
+
+	lock->holder = node;
+	asm volatile("" : : : "memory");
+}
+
+/**
+ * Releases the MCS lock, passing it to the next waiter. If no waiter has
+ * been linked yet, but one has already swapped itself into the tail, its
+ * link is waited for.
+ *
+ * @param lock - the lock to release, held by the current cpu
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void SpinUnlock(MCSLock *lock)
+{
+	asm volatile("" : : : "memory");
+
+	MCSNode *node = lock->holder;
+
+	if(node->next == null)
+	{
+		if(__sync_bool_compare_and_swap(&lock->tail, node, null))
+		{
+			GiveNode(node);
+			PreemptEnable();
+			return;
+		}
+
+		while(node->next == null)
+			asm volatile("pause");
+	}
+
+	node->next->locked = 0;
+
+	GiveNode(node);
+	PreemptEnable();
+}
+
+/**
+ * Acquires the MCS lock only if no one holds it, or waits for it.
+ *
+ * @param lock - the lock to acquire
+ * @return - whether the lock was acquired
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool TestLock(MCSLock *lock)
+{
+	if(lock->tail != null)
+		return (false);
+
+	PreemptDisable();
+
+	MCSNode *node = TakeNode();
+
+	if(__sync_bool_compare_and_swap(&lock->tail, (MCSNode*) null, node))
+	{
+		lock->holder = node;
+		return (true);
+	}
+
+	GiveNode(node);
+	PreemptEnable();
+
+	return (false);
+}
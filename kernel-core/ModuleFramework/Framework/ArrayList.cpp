@@ -92,7 +92,7 @@ unsigned long ArrayList::add(void *elem)
 {
 	ensureBuffer(size + 1);
 	elemData[size++] = elem;
-	Atomic::inc(&changeCount);
+	changeCount.fetchAdd(1, MEMORY_RELAXED);
 	return (size - 1);
 }
 
@@ -113,7 +113,7 @@ unsigned long ArrayList::add(void *elem, unsigned long index)
 		ensureBuffer(size + 1);
 		Arrays::copyFastFromBack(elemData + size, elemData + size + 1,
 						size - index);
-		Atomic::inc(&changeCount);
+		changeCount.fetchAdd(1, MEMORY_RELAXED);
 		return (index);
 	} else {
 		return (--index);
@@ -136,7 +136,7 @@ unsigned long ArrayList::addAll(LinkedList& elems)
 		elemData[size++] = (void *) lielem;
 		lielem = lielem->next;
 	}
-	Atomic::inc(&changeCount);
+	changeCount.fetchAdd(1, MEMORY_RELAXED);
 
 	return (size - elems.count);
 }
@@ -158,7 +158,7 @@ inline void ArrayList::ensureBuffer(unsigned long newCapacity)
 
 		if(newBuffer != elemData) {
 			Arrays::copy(elemData, newBuffer, capacity);
-			Atomic::inc(&changeCount);
+			changeCount.fetchAdd(1, MEMORY_RELAXED);
 		}
 
 		capacity = newCapacity;
@@ -193,6 +193,21 @@ void* BinaryTree::getClosestOf(unsigned long key)
 	return (!isNil(closestNode)) ? (closestNode->val()) : NULL;
 }
 
+/**
+ * Returns the value of the node in this tree, having the minimum
+ * key compared to all others.
+ */
+void *BinaryTree::getMinimum()
+{
+	BinaryNode *tNode = treeRoot;
+
+	while(!isNil(tNode->getLeftChild())) {
+		tNode = tNode->getLeftChild();
+	}
+
+	return (isNil(tNode)) ? NULL : tNode->val();
+}
+
 /**
  * Returns the value of the node in this tree, having the maximum
  * value compared to all others.
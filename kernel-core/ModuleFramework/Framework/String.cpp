@@ -555,3 +555,38 @@ String& String::toString()
 {
 	return (*this);
 }
+
+/**
+ * Adds a reference to the string, which keeps it alive until the reference
+ * is given up by dispose(). The caller must already hold a reference, and
+ * so no ordering is needed.
+ *
+ * @param str - the string being referred to
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void String::referTo(String& str)
+{
+	str.referCount.fetchAdd(1, MEMORY_RELAXED);
+}
+
+/**
+ * Gives up a reference to the string, freeing it when the last one goes.
+ * The release ordering keeps each holder's accesses before the free, and
+ * only applies to strings allocated as kernel objects (of tString).
+ *
+ * @param str - the string whose reference is given up
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void String::dispose(String& str)
+{
+	if(str.referCount.fetchSub(1, MEMORY_RELEASE) != 1)
+		return;
+
+	AtomicFence(MEMORY_ACQUIRE);
+	str.~String();
+	KDelete(&str, tString);
+}
@@ -43,13 +43,73 @@ ContextManager::ContextManager(const char *mgrName, const int typeIdt) : name(mg
 	this->recentCache = NULL;
 	this->firstArena = NULL;
 	this->lastArena = NULL;
-	this->arenaTree = NULL;
-	this->treePopulated = false;
+	this->arenaTree = new(tRBTree) RBTree();
 }
 
 ContextManager::~ContextManager()
 {
+	if(arenaTree)
+	{
+		arenaTree->~RBTree();
+		kobj_free((kobj*) arenaTree, tRBTree);
+	}
+}
+
+/**
+ * Function: ContextManager::findArena
+ *
+ * Summary:
+ * Searches the arena-tree for the region holding the given address. Only the
+ * tree is consulted here, the recent-cache is left to validateRegion.
+ *
+ * Args:
+ * unsigned long address - the address to look for
+ *
+ * Returns:
+ * the arena holding the address; NULL, if the address isn't in any region.
+ *
+ * Author: Shukant Pal
+ */
+MemorySection *ContextManager::findArena(unsigned long address)
+{
+	MemorySection *arena = (MemorySection*) arenaTree->getLowerBoundFor(address);
 
+	if(arena && arena->finalAddress > address)
+		return (arena);
+	else
+		return (NULL);
+}
+
+/**
+ * Function: ContextManager::validateRegion
+ *
+ * Summary:
+ * Validates the given address by finding the region that holds it. As
+ * page-faults & user-pointer checks tend to hit the same region again and
+ * again, the last region found is tried first (recentCache) before going
+ * through the arena-tree in O(log n) time.
+ *
+ * Args:
+ * unsigned long address - the address to validate
+ *
+ * Returns:
+ * the arena holding the address; NULL, if it isn't mapped in any region.
+ *
+ * Author: Shukant Pal
+ */
+MemorySection *ContextManager::validateRegion(unsigned long address)
+{
+	MemorySection *arena = recentCache;
+
+	if(arena && arena->initialAddress <= address &&
+			arena->finalAddress > address)
+		return (arena);
+
+	arena = findArena(address);
+	if(arena)
+		recentCache = arena;
+
+	return (arena);
 }
 
 /**
@@ -63,8 +123,8 @@ ContextManager::~ContextManager()
  * If a existing region was extended, then the subclass should free the newArena
  * or keep a pointer to it.
  *
- * If the chain-list is long and a binary tree is available then, the function
- * could use the red-black tree instead of sorted-list to insert the region.
+ * The neighbouring arenas are located using the red-black tree, which is
+ * always kept in sync with the sorted-list, in O(log n) time.
  *
  * Args:
  * MemorySection *newArena - the new-arena of memory to be inserted in the chain
@@ -94,39 +154,13 @@ RegionInsertionResult ContextManager::add(MemorySection *newArena)
 	MemorySection *arenaAfter = NULL;
 
 	/*
-	 * Here we are locating the arenas/regions before the one that is to
-	 * be inserted by sorted list or a red-black tree.
+	 * Here we are locating the arenas/regions around the one that is to
+	 * be inserted. The arena after is taken from the chain, so that an
+	 * arena starting at 'begin' is caught as an overlap below.
 	 */
 
-	if(!treePopulated)
-	{
-		MemorySection *tsec = firstArena;
-
-		while(tsec != NULL)
-		{
-			if(tsec->initialAddress >= end)
-			{
-				arenaBefore = tsec->last;
-				break;
-			}
-
-			tsec = tsec->next;
-		}
-
-		arenaAfter = tsec;
-		if(!tsec)
-		{
-			if(lastArena)
-				arenaBefore = lastArena;
-			else
-				arenaBefore = firstArena;
-		}
-	}
-	else
-	{
-		arenaBefore = (MemorySection*) arenaTree->getLowerBoundFor(begin);
-		arenaAfter = (MemorySection*) arenaTree->getUpperBoundFor(begin);
-	}
+	arenaBefore = (MemorySection*) arenaTree->getLowerBoundFor(begin);
+	arenaAfter = (arenaBefore) ? arenaBefore->next : firstArena;
 
 	/*
 	 * Here we really insert the new-arena into the chain/tree unless a
@@ -165,11 +199,14 @@ RegionInsertionResult ContextManager::add(MemorySection *newArena)
 				arenaBefore->next = arenaAfter->next;
 				if(arenaBefore->next)
 					arenaBefore->next->last = arenaBefore;
+				else
+					lastArena = arenaBefore;
+
+				arenaTree->remove(arenaAfter->initialAddress);
+				if(recentCache == arenaAfter)
+					recentCache = NULL;
 
-				if(treePopulated)
-				{
-					arenaTree->remove(arenaAfter->initialAddress);
-				}
+				--(regionCount);
 				delete arenaAfter;
 			}
 			else
@@ -177,6 +214,7 @@ RegionInsertionResult ContextManager::add(MemorySection *newArena)
 				arenaTree->remove(arenaAfter->initialAddress);
 				arenaAfter->initialAddress = begin;
 				arenaAfter->pageCount += (end - begin) >> KPGOFFSET;
+				arenaTree->insert(begin, arenaAfter);
 			}
 
 			return (RegionInsertionResult::Extension);
@@ -202,61 +240,18 @@ RegionInsertionResult ContextManager::add(MemorySection *newArena)
 		{
 			arenaAfter->last = newArena;
 		}
-		else if(arenaBefore)
+		else
 		{
 			lastArena = newArena;
 		}
 
 		++(regionCount);
-
-		/*
-		 * Check if we could build a good-hold tree over here
-		 */
-
-		if(!treePopulated)
-			populateTree();
-		else
-			arenaTree->insert(newArena->initialAddress, newArena);
+		arenaTree->insert(newArena->initialAddress, newArena);
 
 		return (RegionInsertionResult::InsertSuccess);
 	}
 }
 
-/**
- * Function: ContextManager::populateTree
- *
- * Summary:
- * Populates a new arena-tree for the image if not present, when the count of
- * arenas increases upto 32.
- *
- * Returns:
- * true, if a tree was newly allocated; false, if the tree was already present
- * or the count of arenas is small.
- *
- * Author: Shukant Pal
- */
-bool ContextManager::populateTree()
-{
-	if(regionCount >= 32)
-	{
-		arenaTree = new(tRBTree) RBTree();
-		MemorySection *arena = firstArena;
-
-		while(arena != NULL)
-		{
-			arenaTree->insert(arena->initialAddress, arena);
-			arena = arena->next;
-		}
-
-		treePopulated = true;
-		return (true);
-	}
-	else
-	{
-		return (false);
-	}
-}
-
 /**
  * Function: ContextManager::carve
  *
@@ -285,7 +280,7 @@ bool ContextManager::populateTree()
  */
 void ContextManager::carve(MemorySection *arena, unsigned long iaddr, unsigned long faddr)
 {
-	bool rinsert = treePopulated && (arena->initialAddress != iaddr);
+	bool rinsert = (arena->initialAddress != iaddr);
 
 	if(rinsert)
 	{
@@ -346,8 +341,8 @@ void ContextManager::split(MemorySection *arena, unsigned long laddr, unsigned l
 
 	MemorySection *rarena = new MemorySection(raddr, faddr, arena->typeId, arena->ctlFlags,
 							arena->pagerFlags);
-	if(treePopulated)
-		arenaTree->insert(raddr, rarena);
+	arenaTree->insert(raddr, rarena);
+	++(regionCount);
 
 	rarena->next = arena->next;
 	rarena->last = arena;
@@ -374,8 +369,11 @@ void ContextManager::remove(MemorySection *arena)
 	MemorySection *lower = arena->last;
 	MemorySection *upper = arena->next;
 
-	if(treePopulated)
-		arenaTree->remove(arena->initialAddress);
+	arenaTree->remove(arena->initialAddress);
+	--(regionCount);
+
+	if(recentCache == arena)
+		recentCache = NULL;
 
 	if(lower)
 		lower->next = upper;
@@ -397,14 +395,15 @@ void ContextManager::remove(MemorySection *arena)
  * linked like they were originally allowing the subclass to free or cache the
  * removed arenas.
  *
- * The first-arena->last & last-arena->next fields are undefined and have a
- * unique value on the stack. They should be stored as 'nil' values if iterating
- * the chain.
+ * The removed sub-chain is given back through 'removed', and is terminated
+ * by NULL on both ends, so that it can be walked without knowing which of the
+ * arenas were removed.
  *
  * Args:
  * MemorySection *from - first arena to remove
  * MemorySection *till - arena after the last arena to remove
  * unsigned short typeId - type of the regions to remove
+ * MemorySection *&removed - first arena of the removed sub-chain (or NULL)
  *
  * Returns:
  * the number of the regions that were unlinked from the main-chain of arena in
@@ -413,33 +412,37 @@ void ContextManager::remove(MemorySection *arena)
  * Author: Shukant Pal
  */
 unsigned long ContextManager::removeAll(MemorySection *from, MemorySection *till,
-						unsigned short typeId, unsigned long& pageCount)
+						unsigned short typeId, unsigned long& pageCount,
+						MemorySection *&removed)
 {
 	unsigned long removalCount = 0;
 	unsigned long *idFilt = getIDFilter();
 	pageCount = 0;
+	removed = NULL;
+
+	if(from == till)
+		return (0);
 
 	if(typeId == MemorySection::Type::Any)
 	{
-		if(treePopulated)
-		{
-			MemorySection *tarena = from;
+		MemorySection *tarena = from;
+		MemorySection *tail = NULL;// last arena in the sub-chain
 
-			while(tarena != till)
-			{
-				if(tarena->typeId == typeId)
-				{
-					arenaTree->remove(tarena->initialAddress);
+		while(tarena != till)
+		{
+			arenaTree->remove(tarena->initialAddress);
 
-					pageCount += tarena->pageCount;
-					idFilt[tarena->typeId] -= tarena->pageCount;
-					++(removalCount);
-				}
+			pageCount += tarena->pageCount;
+			idFilt[tarena->typeId] -= tarena->pageCount;
+			++(removalCount);
 
-				tarena = tarena->next;
-			}
+			tail = tarena;
+			tarena = tarena->next;
 		}
 
+		regionCount -= removalCount;
+		recentCache = NULL;
+
 		MemorySection *before = from->last;
 		MemorySection *after = till;
 
@@ -460,6 +463,10 @@ unsigned long ContextManager::removeAll(MemorySection *from, MemorySection *till
 		{
 			lastArena = before;
 		}
+
+		from->last = NULL;
+		tail->next = NULL;
+		removed = from;
 	}
 	else
 	{
@@ -493,8 +500,12 @@ unsigned long ContextManager::removeAll(MemorySection *from, MemorySection *till
 				arena = arena->next;
 		}
 
-		local->next = &nil;
+		local->next = NULL;
 		idFilt[typeId] -= pageCount;
+
+		removed = nil.next;
+		if(removed)
+			removed->last = NULL;
 	}
 
 	return (removalCount);
@@ -25,6 +25,7 @@
  */
 
 #include <KERNEL.h>
+#include <InterProcess/SharedMemory.hpp>
 #include <Process/MemoryImage.hpp>
 #include <Resource/ContextManager.hpp>
 
@@ -34,4 +35,5 @@ using namespace Resource;
 extern "C" void __init()
 {
 	MemoryImage::init();
+	InterProcess::SharedMemory::init();
 }
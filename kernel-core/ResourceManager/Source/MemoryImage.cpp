@@ -24,10 +24,14 @@
  * Copyright (C) 2017 - Shukant Pal
  */
 #include <KERNEL.h>
+#include <Executable/Task.hpp>
+#include <HardwareAbstraction/Processor.h>
 #include <Process/MemoryImage.hpp>
 
 using namespace Resource;
 using namespace Process;
+using namespace Executable;
+using namespace HAL;
 
 static const char *nmMemoryImage = "Process::MemoryImage";
 ObjectInfo *t_MemoryImage;
@@ -38,7 +42,9 @@ unsigned long NO_ENTRY = 0xDBDAFEFC;
  * Function: MemoryImage::insertRegion
  *
  * Summary:
- * Inserts a memory-region into the address-space with the given bounds.
+ * Inserts a memory-region into the address-space with the given bounds. If
+ * the region has the Populate control-flag, its pages are mapped too, which
+ * requires this image to be the current address-space.
  *
  * Author: Shukant Pal
  */
@@ -49,6 +55,10 @@ RegionInsertionResult MemoryImage::insertRegion(unsigned long initialAddress, un
 
 	RegionInsertionResult chainOutput = ContextManager::add(arena);
 
+	/* On an extension, arena still describes the (new) part to be mapped */
+	if(IsInserted(chainOutput) && (arena->ctlFlags & MemorySection::Populate))
+		populateRegion(arena, FLG_ATOMIC);
+
 	if(chainOutput != RegionInsertionResult::InsertSuccess)
 		delete arena;
 
@@ -83,41 +93,28 @@ RegionRemovalResult MemoryImage::removeRegion(unsigned long iaddr, unsigned long
 	unsigned long faddr = iaddr + (pageCount << KPGOFFSET);
 	MemorySection *first = NULL, *last = NULL;
 
-	if(treePopulated)
-	{
-		first = (MemorySection*) arenaTree->getLowerBoundFor(iaddr);
-		last = (MemorySection*) arenaTree->getLowerBoundFor(faddr);
-	}
-	else
-	{
-		MemorySection *tarena = firstArena;
+	/*
+	 * The first arena is the one holding iaddr (or the one just after it)
+	 * and the last arena is the one starting before faddr. Both are found
+	 * in O(log n) time through the arena-tree.
+	 */
 
-		while(tarena != NULL)
-		{
-			if(tarena->finalAddress > iaddr)
-			{
-				first = tarena;
-				break;
-			}
-			tarena = tarena->next;
-		}
+	first = (MemorySection*) arenaTree->getLowerBoundFor(iaddr);
+	if(!first)
+		first = firstArena;
+	else if(first->finalAddress <= iaddr)
+		first = first->next;
 
-		while(tarena != NULL)
-		{
-			if(tarena->finalAddress > faddr)
-			{
-				last = tarena;
-				break;
-			}
-			tarena = tarena->next;
-		}
+	if(first && first->initialAddress >= faddr)
+		first = NULL;
 
-		if(last && last->initialAddress >= faddr)
-			last = last->last;
-	}
+	if(first)
+		last = (MemorySection*) arenaTree->getLowerBoundFor(faddr - 1);
 
 	unsigned long pcount = 0;// no. of pages removed
 	unsigned long count = 0;
+	MemorySection *inner = NULL;// first arena after 'first', if any
+	bool freeFirst = false;
 
 	/*
 	 * Here, the first and last arenas in the chain are special cases as
@@ -127,12 +124,15 @@ RegionRemovalResult MemoryImage::removeRegion(unsigned long iaddr, unsigned long
 
 	if(first)
 	{
+		inner = first->next;
+
 		if(first->initialAddress >= iaddr)
 		{
 			if(first->finalAddress <= faddr)
 			{
 				pcount += first->pageCount;
 				remove(first);
+				freeFirst = true;
 				++(count);
 			}
 			else
@@ -157,12 +157,15 @@ RegionRemovalResult MemoryImage::removeRegion(unsigned long iaddr, unsigned long
 		}
 	}
 
-	if(last != first && last != first->next && last)
+	if(last != first && last != inner && last)
 	{
-		count = removeAll(first->next, last, typeId, pcount);
-		MemorySection *rarena = first, *local;
+		MemorySection *rarena, *local;
+		unsigned long rpcount;
 
-		while(rarena != last)
+		count += removeAll(inner, last, typeId, rpcount, rarena);
+		pcount += rpcount;
+
+		while(rarena != NULL)
 		{
 			local = rarena->next;
 			delete rarena;
@@ -170,12 +173,17 @@ RegionRemovalResult MemoryImage::removeRegion(unsigned long iaddr, unsigned long
 		}
 	}
 
+	if(freeFirst)
+		delete first;
+
 	if(last != first && last != NULL)
 	{
 		if(last->finalAddress <= faddr)
 		{
 			pcount += last->pageCount;
 			remove(last);
+			delete last;
+			++(count);
 		}
 		else
 		{
@@ -194,6 +202,182 @@ RegionRemovalResult MemoryImage::removeRegion(unsigned long iaddr, unsigned long
 	}
 }
 
+/**
+ * Function: MemoryImage::populateRegion
+ *
+ * Summary:
+ * Maps all the pages in the given region, which must be in this image. The
+ * 2-MB aligned part of anonymous & heap regions is backed by huge-pages,
+ * reducing TLB pressure for memory-intensive processes, while the edges
+ * (and all other regions) use small pages.
+ *
+ * This image must be the current address-space.
+ *
+ * Args:
+ * MemorySection *arena - the region to populate
+ * unsigned long allocFlags - flags for allocating the page-frames
+ *
+ * Author: Shukant Pal
+ */
+void MemoryImage::populateRegion(MemorySection *arena, unsigned long allocFlags)
+{
+	if(isHugeEligible(arena))
+	{
+		unsigned long hbase = (arena->initialAddress + 0x1FFFFF) & ~0x1FFFFF;
+		unsigned long hlimit = arena->finalAddress & ~0x1FFFFF;
+
+		if(hlimit > hbase)
+			hugePages += (hlimit - hbase) >> 21;
+
+		Pager::useAll(arena->initialAddress, arena->finalAddress, allocFlags,
+				arena->pagerFlags);
+	}
+	else
+	{
+		Pager::useAllSmall(arena->initialAddress, arena->finalAddress,
+					allocFlags, arena->pagerFlags);
+	}
+}
+
+/**
+ * Function: MemoryImage::collapseHugeRegions
+ *
+ * Summary:
+ * Collapse pass for transparent huge-pages - finds 2-MB aligned blocks in
+ * anonymous & heap regions that are fully populated with small pages and
+ * promotes them to huge-pages. Regions grow page by page (e.g. the heap) and
+ * hence are small-page mapped initially; this pass should be run in the
+ * background periodically.
+ *
+ * This image must be the current address-space. Its threads may keep running
+ * on other cpus, as writes to a block are held off while it is promoted.
+ * startCollapsing() runs this pass periodically.
+ *
+ * Args:
+ * unsigned long allocFlags - flags for allocating the 2-MB page-frames
+ *
+ * Returns:
+ * the no. of 2-MB blocks promoted to huge-pages.
+ *
+ * Author: Shukant Pal
+ */
+unsigned long MemoryImage::collapseHugeRegions(unsigned long allocFlags)
+{
+	unsigned long promoted = 0;
+	MemorySection *arena = firstArena;
+
+	while(arena != NULL)
+	{
+		if(isHugeEligible(arena))
+		{
+			unsigned long hblock = (arena->initialAddress + 0x1FFFFF) & ~0x1FFFFF;
+			unsigned long hlimit = arena->finalAddress & ~0x1FFFFF;
+
+			while(hblock < hlimit)
+			{
+				if(Pager::promote(hblock, allocFlags))
+					++(promoted);
+
+				hblock += 0x200000;
+			}
+		}
+
+		arena = arena->next;
+	}
+
+	hugePages += promoted;
+	return (promoted);
+}
+
+/**
+ * Function: MemoryImage::runCollapser
+ *
+ * Summary:
+ * Work function of the periodic collapse pass. The worker-thread borrows the
+ * image's address-space for the pass, and the scheduler restores it if the
+ * worker is preempted in b/w. The address-space used before the pass is
+ * loaded back after it. The work re-queues itself until the collapser
+ * is stopped.
+ *
+ * Args:
+ * void *image - the image to collapse
+ *
+ * Author: Shukant Pal
+ */
+void MemoryImage::runCollapser(void *imageArg)
+{
+	MemoryImage *image = (MemoryImage*) imageArg;
+
+	if(!image->collapsing)
+		return;
+
+	Task *worker = image->collapserCpu->ctask;
+	MemoryContext *previous = image->collapserCpu->activeSpace;
+
+	if(previous == NULL)
+		previous = KERNEL_CONTEXT;
+
+	worker->mmu = image->space;
+	Pager::switchSpace(image->space);
+	image->collapseHugeRegions(FLG_ATOMIC);
+
+	/*
+	 * Go back to the address-space the worker was lazily running on, as
+	 * the image's one may be torn down once the collapser is stopped.
+	 */
+	worker->mmu = previous;
+	Pager::switchSpace(previous);
+	worker->mmu = NULL;
+
+	if(image->collapsing)
+		WorkQueue::queueDelayedWork(image->collapserCpu, &image->collapser,
+						THP_COLLAPSE_INTERVAL);
+}
+
+/**
+ * Function: MemoryImage::startCollapsing
+ *
+ * Summary:
+ * Starts running the collapse pass over this image every
+ * THP_COLLAPSE_INTERVAL ms, on the worker-thread of the given cpu.
+ *
+ * Args:
+ * HAL::Processor *cpu - cpu on which the pass is run
+ * MemoryContext *space - address-space in which the image is mapped
+ *
+ * Author: Shukant Pal
+ */
+void MemoryImage::startCollapsing(Processor *cpu, MemoryContext *space)
+{
+	if(collapsing)
+		return;
+
+	this->collapserCpu = cpu;
+	this->space = space;
+	this->collapsing = true;
+
+	WorkQueue::queueDelayedWork(cpu, &collapser, THP_COLLAPSE_INTERVAL);
+}
+
+/**
+ * Function: MemoryImage::stopCollapsing
+ *
+ * Summary:
+ * Stops the periodic collapse pass, waiting for a running pass to finish.
+ * Must be called in task context, before the image is destroyed.
+ *
+ * Author: Shukant Pal
+ */
+void MemoryImage::stopCollapsing()
+{
+	if(!collapsing)
+		return;
+
+	collapsing = false;
+	WorkQueue::cancel(&collapser);
+	WorkQueue::flush(&collapser);
+}
+
 void MemoryImage::init()
 {
 	t_MemoryImage = KiCreateType(nmMemoryImage, sizeof(MemoryImage), sizeof(long), NULL, NULL);
@@ -210,6 +394,11 @@ MemoryImage::MemoryImage() : ContextManager(nmMemoryImage, TypeId::psmmManager)
 	this->mainStack = NULL;
 	this->pinnedPages = 0;
 	this->libraryCount = 0;
+	this->hugePages = 0;
+	this->collapser.init(&MemoryImage::runCollapser, this);
+	this->collapserCpu = NULL;
+	this->space = NULL;
+	this->collapsing = false;
 }
 
 MemoryImage::~MemoryImage()
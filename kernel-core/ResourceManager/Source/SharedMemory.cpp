@@ -0,0 +1,429 @@
+/**
+ * @file SharedMemory.cpp
+ *
+ * Implements shared-memory segments (IPC_SharedMemory). The segments are
+ * kept in a red-black tree keyed by their IPC key, so that processes can
+ * find a segment created by another one.
+ * -------------------------------------------------------------------
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ * Copyright (C) 2017 - Shukant Pal
+ */
+#define NAMESPACE_IPC_MANAGEMENT
+
+#include <InterProcess/SharedMemory.hpp>
+#include <HardwareAbstraction/Processor.h>
+#include <Memory/KFrameManager.h>
+#include <Memory/Pager.h>
+#include <Heap.hpp>
+#include <KERNEL.h>
+
+using namespace Resource;
+using namespace Process;
+using namespace InterProcess;
+
+static const char *nmSharedMemory = "InterProcess::SharedMemory";
+static const char *nmSharedMemoryAttachment =
+		"InterProcess::SharedMemoryAttachment";
+
+ObjectInfo *tSharedMemory;
+ObjectInfo *tSharedMemoryAttachment;
+
+RBTree *shmSegments;/* All segments, keyed by their IPC key */
+Spinlock shmLock;
+
+//! Bits of the page-attributes that control access to a page
+#define SHM_ACCESS_MASK (PageReadWrite | PageUserland)
+
+/**
+ * Clears a page-frame by mapping it at the scratch page of this cpu, so that
+ * a new segment doesn't leak the old contents of its frames.
+ */
+static void shmZeroFrame(PhysAddr frame)
+{
+	VirtAddr scratch = KSCRATCH + (PROCESSOR_ID << KPGOFFSET);
+
+	__irq_save_func(
+		Pager::map(scratch, frame, FLG_ATOMIC | KF_NOINTR, KernelData);
+		memsetf((void*) scratch, 0, KPGSIZE);
+		Pager::dispose(scratch);
+	)
+}
+
+/**
+ * Allocates the page-frames for a new segment. Each frame is allocated
+ * individually, as the segment need not be physically contiguous, and is
+ * zeroed before it can be mapped into a process.
+ *
+ * @param key - IPC key of the segment
+ * @param pageCount - no. of pages in the segment
+ * @param permissions - maximum access allowed to the segment
+ */
+SharedMemory::SharedMemory(unsigned long key, unsigned long pageCount,
+		PAGE_ATTRIBUTES permissions)
+		: key(key), pageCount(pageCount), maxPermissions(permissions)
+{
+	this->header.Signature = DefaultSignature;
+	this->header.OwnerUID = this->header.CreatorUID = 0;
+	this->header.OwnerGID = this->header.CreatorGID = 0;
+
+	this->frames = (PhysAddr*) kmalloc(sizeof(PhysAddr) * pageCount);
+	this->refCount = 1;
+	this->attachments.count = 0;
+	this->attachments.head = this->attachments.tail = NULL;
+	this->lock = 0;
+
+	if(this->frames != NULL)
+	{
+		for(unsigned long pidx = 0; pidx < pageCount; pidx++)
+		{
+			this->frames[pidx] = KeFrameAllocate(0, ZONE_KERNEL,
+								FLG_ATOMIC);
+
+			if(this->frames[pidx])
+				shmZeroFrame(this->frames[pidx]);
+		}
+	}
+}
+
+/**
+ * Frees all the page-frames held by the segment. It must not be attached
+ * in any memory-image.
+ */
+SharedMemory::~SharedMemory()
+{
+	if(frames == NULL)
+		return;
+
+	for(unsigned long pidx = 0; pidx < pageCount; pidx++)
+	{
+		if(frames[pidx])
+			KeFrameFree(frames[pidx]);
+	}
+
+	kfree(frames);
+}
+
+/**
+ * Creates a new shared-memory segment with the given key, and gives a
+ * reference to it to the caller. If a segment with the same key already
+ * exists, it is returned instead (with a new reference), unless IPC_EXCL
+ * is given.
+ *
+ * @param key - IPC key identifying the segment
+ * @param size - no. of bytes in the segment, rounded up to pages
+ * @param permissions - maximum access allowed to the segment's pages
+ * @param ipcFlags - IPC_CREAT or IPC_EXCL
+ * @return - the segment; null, if IPC_EXCL was given and the key is in use,
+ * 		if an existing segment is smaller than the size given, or if
+ * 		memory ran out.
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+SharedMemory *SharedMemory::create(unsigned long key, unsigned long size,
+		PAGE_ATTRIBUTES permissions, unsigned long ipcFlags)
+{
+	unsigned long pageCount = (size + KPGSIZE - 1) >> KPGOFFSET;
+
+	if(pageCount == 0)
+		return (null);
+
+	SpinLock(&shmLock);
+
+	SharedMemory *segment = (SharedMemory*) shmSegments->get(key);
+	if(segment != null)
+	{
+		segment = reuse(segment, pageCount, ipcFlags);
+		SpinUnlock(&shmLock);
+		return (segment);
+	}
+
+	SpinUnlock(&shmLock);
+
+	/*
+	 * The frames are allocated & zeroed without holding shmLock, so another
+	 * segment with the same key may be inserted in b/w.
+	 */
+	segment = new(tSharedMemory) SharedMemory(key, pageCount,
+				permissions | PagePresent);
+
+	if(segment == null)
+		return (null);
+
+	bool allocated = (segment->frames != NULL);
+	for(unsigned long pidx = 0; allocated && pidx < pageCount; pidx++)
+	{
+		if(!segment->frames[pidx])
+			allocated = false;
+	}
+
+	if(!allocated)
+	{
+		segment->~SharedMemory();
+		kobj_free((kobj*) segment, tSharedMemory);
+		return (null);
+	}
+
+	SpinLock(&shmLock);
+
+	SharedMemory *existing = (SharedMemory*) shmSegments->get(key);
+	if(existing != null)
+	{
+		existing = reuse(existing, pageCount, ipcFlags);
+		SpinUnlock(&shmLock);
+
+		segment->~SharedMemory();
+		kobj_free((kobj*) segment, tSharedMemory);
+		return (existing);
+	}
+
+	shmSegments->insert(key, segment);
+	SpinUnlock(&shmLock);
+
+	return (segment);
+}
+
+/**
+ * Gives a reference to an existing segment found by create(), if the
+ * caller allows it to be reused and it is large enough. The caller must
+ * hold shmLock.
+ */
+SharedMemory *SharedMemory::reuse(SharedMemory *segment,
+		unsigned long pageCount, unsigned long ipcFlags)
+{
+	if(ipcFlags == IPC_EXCL || segment->pageCount < pageCount)
+		return (null);
+
+	segment->acquire();
+	return (segment);
+}
+
+/**
+ * Finds the segment with the given key and gives a reference to it to the
+ * caller, which must be dropped using release().
+ *
+ * @param key - IPC key of the segment
+ * @return - the segment; null, if no segment has the given key
+ */
+SharedMemory *SharedMemory::get(unsigned long key)
+{
+	SpinLock(&shmLock);
+
+	SharedMemory *segment = (SharedMemory*) shmSegments->get(key);
+	if(segment != null)
+		segment->acquire();
+
+	SpinUnlock(&shmLock);
+	return (segment);
+}
+
+/**
+ * Maps the segment into the given memory-image (which must be the current
+ * address-space) at the given address, with the given permissions. The
+ * region is recorded as a MemorySection::Shared in the image. Each
+ * attachment holds a reference to the segment.
+ *
+ * @param image - the memory-image in which segment is to be mapped
+ * @param address - page-aligned address at which to map the segment
+ * @param permissions - access for the pages, which can't exceed the
+ * 			maximum permissions of the segment
+ * @return - the address at which the segment was attached; 0, if the
+ * 		permissions were not allowed or the region was already used.
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+unsigned long SharedMemory::attach(MemoryImage *image, unsigned long address,
+		PAGE_ATTRIBUTES permissions)
+{
+	permissions |= PagePresent;
+
+	if((address & (KPGSIZE - 1)) || (permissions & SHM_ACCESS_MASK &
+			~maxPermissions))
+		return (0);
+
+	RegionInsertionResult result = image->insertRegion(address, pageCount,
+			GetConfigFlags(MemorySection::Shared, 0), permissions);
+
+	if(!IsInserted(result))
+		return (0);
+
+	SharedMemoryAttachment *attachment = new(tSharedMemoryAttachment)
+						SharedMemoryAttachment;
+	attachment->image = image;
+	attachment->address = address;
+	attachment->permissions = permissions;
+
+	for(unsigned long pidx = 0; pidx < pageCount; pidx++)
+		Pager::map(address + (pidx << KPGOFFSET), frames[pidx],
+				FLG_ATOMIC, permissions);
+
+	/* Pager::map() always gives write-access; apply the real permissions */
+	Pager::protect(address, address + (pageCount << KPGOFFSET),
+			permissions);
+
+	SpinLock(&lock);
+	AddElement(&attachment->liLinker, &attachments);
+	++(refCount);
+	SpinUnlock(&lock);
+
+	return (address);
+}
+
+/**
+ * Unmaps the segment from the given memory-image (which must be the current
+ * address-space) and removes its region. The pages are shot down on all cpus
+ * before the reference held by the attachment is dropped, as that may free
+ * the segment's frames.
+ *
+ * @param image - the memory-image from which to detach
+ * @param address - address at which the segment was attached
+ * @return - whether the segment was attached at the given address
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool SharedMemory::detach(MemoryImage *image, unsigned long address)
+{
+	SpinLock(&lock);
+
+	SharedMemoryAttachment *attachment = findAttachment(image, address);
+	if(attachment == NULL || attachment->address != address)
+	{
+		SpinUnlock(&lock);
+		return (false);
+	}
+
+	RemoveElement(&attachment->liLinker, &attachments);
+	SpinUnlock(&lock);
+
+	/* Threads of the image on other cpus may still cache the pages */
+	Pager::disposeAll(address, address + (pageCount << KPGOFFSET));
+	HAL::CPUDriver::shootdown(address, pageCount);
+	image->removeRegion(address, pageCount, MemorySection::Shared);
+
+	kobj_free((kobj*) attachment, tSharedMemoryAttachment);
+	release();
+
+	return (true);
+}
+
+/**
+ * Changes the permissions for a range of pages in an attachment of the
+ * segment. The memory-image must be the current address-space.
+ *
+ * @param image - the memory-image in which the segment is attached
+ * @param address - page-aligned address of the first page to change
+ * @param pageCount - no. of pages to change
+ * @param permissions - new access for the pages, which can't exceed the
+ * 			maximum permissions of the segment
+ * @return - whether the range lies in an attachment and the permissions
+ * 		were applied
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+bool SharedMemory::protect(MemoryImage *image, unsigned long address,
+		unsigned long pageCount, PAGE_ATTRIBUTES permissions)
+{
+	permissions |= PagePresent;
+
+	if((address & (KPGSIZE - 1)) || (permissions & SHM_ACCESS_MASK &
+			~maxPermissions))
+		return (false);
+
+	SpinLock(&lock);
+	SharedMemoryAttachment *attachment = findAttachment(image, address,
+								pageCount);
+	SpinUnlock(&lock);
+
+	if(attachment == NULL)
+		return (false);
+
+	Pager::protect(address, address + (pageCount << KPGOFFSET),
+			permissions);
+	HAL::CPUDriver::shootdown(address, pageCount);
+	return (true);
+}
+
+/**
+ * Finds the attachment in the given image that holds all the pages from
+ * address to address + pageOffset. The caller must hold the lock.
+ */
+SharedMemoryAttachment *SharedMemory::findAttachment(MemoryImage *image,
+		unsigned long address, unsigned long pageOffset)
+{
+	SharedMemoryAttachment *attachment = (SharedMemoryAttachment*)
+							attachments.head;
+	unsigned long limit = address + (pageOffset << KPGOFFSET);
+
+	while(attachment != NULL)
+	{
+		if(attachment->image == image && attachment->address <= address &&
+				attachment->address + (this->pageCount << KPGOFFSET)
+						>= limit)
+			return (attachment);
+
+		attachment = (SharedMemoryAttachment*) attachment->liLinker.next;
+	}
+
+	return (NULL);
+}
+
+void SharedMemory::acquire()
+{
+	SpinLock(&lock);
+	++(refCount);
+	SpinUnlock(&lock);
+}
+
+/**
+ * Drops a reference to the segment. When the last reference is dropped,
+ * the segment is removed & its page-frames are freed.
+ *
+ * @version 1.0
+ * @since Silcos 3.05
+ * @author Shukant Pal
+ */
+void SharedMemory::release()
+{
+	SpinLock(&shmLock);
+	SpinLock(&lock);
+
+	if(--(refCount) != 0)
+	{
+		SpinUnlock(&lock);
+		SpinUnlock(&shmLock);
+		return;
+	}
+
+	shmSegments->remove(key);
+
+	SpinUnlock(&lock);
+	SpinUnlock(&shmLock);
+
+	this->~SharedMemory();
+	kobj_free((kobj*) this, tSharedMemory);
+}
+
+void SharedMemory::init()
+{
+	tSharedMemory = KiCreateType(nmSharedMemory, sizeof(SharedMemory),
+					sizeof(long), NULL, NULL);
+	tSharedMemoryAttachment = KiCreateType(nmSharedMemoryAttachment,
+				sizeof(SharedMemoryAttachment), sizeof(long),
+				NULL, NULL);
+	shmSegments = new(tRBTree) RBTree();
+}